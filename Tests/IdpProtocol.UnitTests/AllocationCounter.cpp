@@ -0,0 +1,183 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+bool AllocationCounter::s_counting = false;
+uint32_t AllocationCounter::s_allocations = 0;
+
+void AllocationCounter::Start ()
+{
+    s_allocations = 0;
+    s_counting = true;
+}
+
+uint32_t AllocationCounter::Stop ()
+{
+    s_counting = false;
+
+    return s_allocations;
+}
+
+void AllocationCounter::Count ()
+{
+    if (s_counting)
+    {
+        s_allocations++;
+    }
+}
+
+// Every replaceable allocation function is replaced, so whichever form the
+// library or the tests use, memory is allocated and freed consistently.
+
+static void* Allocate (std::size_t size) noexcept
+{
+    AllocationCounter::Count ();
+
+    return malloc (size == 0 ? 1 : size);
+}
+
+void* operator new (std::size_t size)
+{
+    auto result = Allocate (size);
+
+    if (result == nullptr)
+    {
+        throw std::bad_alloc ();
+    }
+
+    return result;
+}
+
+void* operator new[] (std::size_t size)
+{
+    return operator new (size);
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate (size);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate (size);
+}
+
+void operator delete (void* pointer) noexcept
+{
+    free (pointer);
+}
+
+void operator delete[] (void* pointer) noexcept
+{
+    free (pointer);
+}
+
+void operator delete (void* pointer, std::size_t) noexcept
+{
+    free (pointer);
+}
+
+void operator delete[] (void* pointer, std::size_t) noexcept
+{
+    free (pointer);
+}
+
+void operator delete (void* pointer, const std::nothrow_t&) noexcept
+{
+    free (pointer);
+}
+
+void operator delete[] (void* pointer, const std::nothrow_t&) noexcept
+{
+    free (pointer);
+}
+
+#ifdef __cpp_aligned_new
+static void* AllocateAligned (std::size_t size,
+                              std::align_val_t alignment) noexcept
+{
+    AllocationCounter::Count ();
+
+    auto align = (std::size_t) alignment;
+
+    if (align < sizeof (void*))
+    {
+        align = sizeof (void*);
+    }
+
+    void* result = nullptr;
+
+    if (posix_memalign (&result, align, size == 0 ? 1 : size) != 0)
+    {
+        return nullptr;
+    }
+
+    return result;
+}
+
+void* operator new (std::size_t size, std::align_val_t alignment)
+{
+    auto result = AllocateAligned (size, alignment);
+
+    if (result == nullptr)
+    {
+        throw std::bad_alloc ();
+    }
+
+    return result;
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment)
+{
+    return operator new (size, alignment);
+}
+
+void* operator new (std::size_t size, std::align_val_t alignment,
+                    const std::nothrow_t&) noexcept
+{
+    return AllocateAligned (size, alignment);
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment,
+                      const std::nothrow_t&) noexcept
+{
+    return AllocateAligned (size, alignment);
+}
+
+void operator delete (void* pointer, std::align_val_t) noexcept
+{
+    free (pointer);
+}
+
+void operator delete[] (void* pointer, std::align_val_t) noexcept
+{
+    free (pointer);
+}
+
+void operator delete (void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    free (pointer);
+}
+
+void operator delete[] (void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    free (pointer);
+}
+
+void operator delete (void* pointer, std::align_val_t,
+                      const std::nothrow_t&) noexcept
+{
+    free (pointer);
+}
+
+void operator delete[] (void* pointer, std::align_val_t,
+                        const std::nothrow_t&) noexcept
+{
+    free (pointer);
+}
+#endif
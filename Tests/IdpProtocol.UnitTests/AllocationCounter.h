@@ -0,0 +1,28 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+
+#pragma once
+#include <stdint.h>
+
+/**
+ * Counts heap allocations made by the test binary while counting is enabled,
+ * so tests can check a path does not allocate. The global allocation
+ * functions are replaced in AllocationCounter.cpp.
+ */
+class AllocationCounter
+{
+  public:
+    static void Start ();
+
+    /**
+     * Stops counting and returns the number of allocations made since Start.
+     */
+    static uint32_t Stop ();
+
+    static void Count ();
+
+  private:
+    static bool s_counting;
+    static uint32_t s_allocations;
+};
@@ -0,0 +1,283 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+
+#include "catch.hpp"
+
+#include "BulkReceiver.h"
+#include "BulkSender.h"
+#include "IdpRouter.h"
+#include "MasterNode.h"
+#include "SimpleAdaptor.h"
+#include "TestRuntime.h"
+#include <vector>
+
+static const Guid_t BulkTestGuid =
+    Guid_t ("3f1c2b7a-64d0-4e55-9a8b-0c7d2e1f4a63");
+
+/**
+ * Holds packets until they are delivered, so each delivery stands for half
+ * a round trip.
+ */
+class DelayingAdaptor : public SimpleAdaptor
+{
+  public:
+    DelayingAdaptor ()
+    {
+        Delay = false;
+        DropData = 0;
+        CorruptData = 0;
+        DataSent = 0;
+    }
+
+    bool Transmit (std::shared_ptr<IdpPacket> packet)
+    {
+        if (IsBulkData (packet))
+        {
+            DataSent++;
+
+            if (DataSent == DropData)
+            {
+                return true;
+            }
+
+            if (DataSent == CorruptData)
+            {
+                packet->Payload ()[packet->PayloadLength () - 1] ^= 0xFF;
+            }
+        }
+
+        if (Delay)
+        {
+            Queued.push_back (packet);
+
+            return true;
+        }
+
+        return SimpleAdaptor::Transmit (packet);
+    }
+
+    void Deliver ()
+    {
+        std::vector<std::shared_ptr<IdpPacket>> packets;
+        packets.swap (Queued);
+
+        for (auto& packet : packets)
+        {
+            SimpleAdaptor::Transmit (packet);
+        }
+    }
+
+    static bool IsBulkData (std::shared_ptr<IdpPacket> packet)
+    {
+        auto payload = packet->Payload ();
+
+        return packet->PayloadLength () >= 2 &&
+               ((payload[0] << 8) | payload[1]) ==
+                   static_cast<uint16_t> (NodeCommand::BulkData);
+    }
+
+    bool Delay;
+    uint32_t DropData;
+    uint32_t CorruptData;
+    uint32_t DataSent;
+    std::vector<std::shared_ptr<IdpPacket>> Queued;
+};
+
+struct BulkTestNetwork
+{
+    BulkTestNetwork ()
+        : Master (*new MasterNode ()),
+          Router1 (*new IdpRouter ()),
+          Router2 (*new IdpRouter ()),
+          Remote (*new IdpNode (BulkTestGuid, "Bulk.Receiver")),
+          Adaptor1 (*new DelayingAdaptor ()),
+          Adaptor2 (*new DelayingAdaptor ()),
+          Sender (Master),
+          Receiver (Remote)
+    {
+        Router1.AddNode (Master);
+        Router2.AddNode (Remote);
+
+        Router1.AddAdaptor (Adaptor1);
+        Router2.AddAdaptor (Adaptor2);
+
+        Adaptor1.SetRemote (Adaptor2);
+        Adaptor2.SetRemote (Adaptor1);
+
+        Master.EnumerateNetwork ();
+    }
+
+    /**
+     * Delivers queued traffic in both directions until nothing is left,
+     * returning the number of deliveries.
+     */
+    uint32_t Run (uint32_t limit = 1000)
+    {
+        uint32_t deliveries = 0;
+
+        while ((!Adaptor1.Queued.empty () || !Adaptor2.Queued.empty ()) &&
+               deliveries < limit)
+        {
+            Adaptor1.Deliver ();
+            Adaptor2.Deliver ();
+
+            deliveries++;
+        }
+
+        return deliveries;
+    }
+
+    MasterNode& Master;
+    IdpRouter& Router1;
+    IdpRouter& Router2;
+    IdpNode& Remote;
+    DelayingAdaptor& Adaptor1;
+    DelayingAdaptor& Adaptor2;
+    BulkSender Sender;
+    BulkReceiver Receiver;
+};
+
+TEST_CASE ("Bulk transfers keep a window of chunks in flight")
+{
+    TestRuntime::Initialise ();
+
+    BulkTestNetwork network;
+
+    REQUIRE_FALSE (network.Master.IsEnumerating ());
+
+    std::vector<uint8_t> image (64 * BulkSender::DefaultChunkSize - 100);
+
+    for (uint32_t i = 0; i < image.size (); i++)
+    {
+        image[i] = (uint8_t) (i * 31 + (i >> 8));
+    }
+
+    std::vector<uint8_t> received (image.size ());
+
+    auto receivedStatus = BulkTransferStatus::InProgress;
+    auto sentStatus = BulkTransferStatus::InProgress;
+
+    network.Receiver.Receive (
+        received.data (), received.size (),
+        [&](BulkTransferStatus status, uint32_t length) {
+            receivedStatus = status;
+        });
+
+    auto send = [&]() {
+        sentStatus = BulkTransferStatus::InProgress;
+
+        return network.Sender.Send (
+            network.Remote.Address (), 1, image.data (), image.size (),
+            [&](BulkTransferStatus status) { sentStatus = status; });
+    };
+
+    network.Adaptor1.Delay = true;
+    network.Adaptor2.Delay = true;
+
+    REQUIRE (send ());
+
+    auto deliveries = network.Run ();
+
+    // Stop and wait would take two deliveries per chunk.
+    REQUIRE (sentStatus == BulkTransferStatus::Complete);
+    REQUIRE (receivedStatus == BulkTransferStatus::Complete);
+    REQUIRE (deliveries <= 2 + 2 * 64 / BulkSender::DefaultWindow + 2);
+    REQUIRE (network.Sender.ChunksSent () == 64);
+    REQUIRE (received == image);
+
+    // A lost chunk is resent as soon as a later one is acknowledged.
+    std::fill (received.begin (), received.end (), 0);
+
+    network.Adaptor1.DataSent = 0;
+    network.Adaptor1.DropData = 10;
+
+    REQUIRE (send ());
+
+    network.Run ();
+
+    REQUIRE (sentStatus == BulkTransferStatus::Complete);
+    REQUIRE (network.Sender.Retransmissions () == 1);
+    REQUIRE (received == image);
+
+    // An interrupted transfer resumes from what the receiver holds.
+    network.Adaptor1.DropData = 0;
+
+    REQUIRE (send ());
+
+    network.Run (6);
+    network.Sender.Cancel ();
+    network.Run ();
+
+    REQUIRE (sentStatus == BulkTransferStatus::Cancelled);
+
+    auto held = network.Receiver.Received ();
+
+    REQUIRE (held > 0);
+    REQUIRE (held < image.size ());
+
+    REQUIRE (send ());
+
+    network.Run ();
+
+    REQUIRE (sentStatus == BulkTransferStatus::Complete);
+    REQUIRE (network.Sender.ChunksSent () ==
+             64 - held / BulkSender::DefaultChunkSize);
+    REQUIRE (received == image);
+
+    // Corruption is caught by the end to end CRC.
+    network.Adaptor1.DataSent = 0;
+    network.Adaptor1.CorruptData = 20;
+
+    REQUIRE (send ());
+
+    network.Run ();
+
+    REQUIRE (sentStatus == BulkTransferStatus::CrcMismatch);
+    REQUIRE (receivedStatus == BulkTransferStatus::CrcMismatch);
+}
+
+TEST_CASE ("Bulk transfers recover lost chunks after the round trip timeout")
+{
+    TestRuntime::Initialise ();
+
+    BulkTestNetwork network;
+
+    REQUIRE_FALSE (network.Master.IsEnumerating ());
+
+    std::vector<uint8_t> image (1000);
+
+    for (uint32_t i = 0; i < image.size (); i++)
+    {
+        image[i] = (uint8_t) i;
+    }
+
+    std::vector<uint8_t> received (image.size ());
+
+    network.Receiver.Receive (received.data (), received.size (),
+                              [](BulkTransferStatus status, uint32_t length) {
+                              });
+
+    auto sentStatus = BulkTransferStatus::InProgress;
+
+    // The last chunk has nothing after it to reveal its loss.
+    network.Adaptor1.DropData = 4;
+
+    REQUIRE (network.Sender.Send (
+        network.Remote.Address (), 7, image.data (), image.size (),
+        [&](BulkTransferStatus status) { sentStatus = status; }));
+
+    REQUIRE (sentStatus == BulkTransferStatus::InProgress);
+    REQUIRE (network.Sender.Acknowledged () == 3 * BulkSender::DefaultChunkSize);
+
+    for (uint32_t i = 0; i < RttEstimator::MaxTimeout &&
+                         sentStatus == BulkTransferStatus::InProgress;
+         i += IdpScheduler::Resolution)
+    {
+        TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+    }
+
+    REQUIRE (sentStatus == BulkTransferStatus::Complete);
+    REQUIRE (network.Sender.Retransmissions () == 1);
+    REQUIRE (received == image);
+}
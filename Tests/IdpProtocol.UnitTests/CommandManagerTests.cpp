@@ -4,11 +4,13 @@
 
 #include "catch.hpp"
 
+#include "AllocationCounter.h"
 #include "IStream.h"
 #include "IdpCommandManager.h"
 #include "IdpPacketParser.h"
 #include "TestRuntime.h"
 #include "TestStream.h"
+#include <map>
 
 static std::shared_ptr<IdpPacket> ProcessPayload (IdpCommandManager& manager,
                                                   uint8_t* buffer,
@@ -288,3 +290,517 @@ TEST_CASE ("Command can give invalid response")
     delete &manager;
     delete &idpResponse;
 }
+
+class FixedFunctionNode
+{
+  public:
+    IdpResponseCode HandleStart (std::shared_ptr<IncomingTransaction> incoming,
+                                 std::shared_ptr<OutgoingTransaction> outgoing)
+    {
+        Started++;
+        return IdpResponseCode::OK;
+    }
+
+    IdpResponseCode HandleStop (std::shared_ptr<IncomingTransaction> incoming,
+                                std::shared_ptr<OutgoingTransaction> outgoing)
+    {
+        return IdpResponseCode::InvalidParameters;
+    }
+
+    typedef StaticCommandTable<
+        StaticCommand<FixedFunctionNode, 0xB000,
+                      &FixedFunctionNode::HandleStart>,
+        StaticCommand<FixedFunctionNode, 0xB001,
+                      &FixedFunctionNode::HandleStop>>
+        Commands;
+
+    int Started = 0;
+};
+
+TEST_CASE ("Command Manager dispatches commands from a static command table")
+{
+    TestRuntime::Initialise ();
+
+    static_assert (FixedFunctionNode::Commands::Contains (0xB001),
+                   "Static command tables are usable at compile time.");
+
+    uint8_t start[] = { 0xB0, 0x00, 0x00, 0x00, 0x00, 0x01,
+                        (uint8_t) IdpCommandFlags::ResponseExpected };
+    uint8_t stop[] = { 0xB0, 0x01, 0x00, 0x00, 0x00, 0x02,
+                       (uint8_t) IdpCommandFlags::ResponseExpected };
+    uint8_t dynamic[] = { 0xA0, 0x01, 0x00, 0x00, 0x00, 0x03,
+                          (uint8_t) IdpCommandFlags::ResponseExpected };
+
+    FixedFunctionNode node;
+
+    auto& manager = GetManager ();
+
+    manager.RegisterStaticCommands<FixedFunctionNode::Commands> (&node);
+
+    bool dynamicCalled = false;
+
+    manager.RegisterCommand (
+        0xA001, [&](std::shared_ptr<IncomingTransaction> incomingTransaction,
+                    std::shared_ptr<OutgoingTransaction> outgoingTransaction) {
+            dynamicCalled = true;
+            return IdpResponseCode::OK;
+        });
+
+    auto& startResponse = TestTransaction (manager, start, sizeof (start));
+
+    REQUIRE (node.Started == 1);
+    REQUIRE ((IdpResponseCode) startResponse.Read<uint8_t> () ==
+             IdpResponseCode::OK);
+    REQUIRE (startResponse.Read<uint16_t> () == 0xB000);
+
+    auto& stopResponse = TestTransaction (manager, stop, sizeof (stop));
+
+    REQUIRE ((IdpResponseCode) stopResponse.Read<uint8_t> () ==
+             IdpResponseCode::InvalidParameters);
+
+    auto& dynamicResponse = TestTransaction (manager, dynamic, sizeof (dynamic));
+
+    REQUIRE (dynamicCalled);
+    REQUIRE ((IdpResponseCode) dynamicResponse.Read<uint8_t> () ==
+             IdpResponseCode::OK);
+
+    delete &manager;
+    delete &startResponse;
+    delete &stopResponse;
+    delete &dynamicResponse;
+}
+
+TEST_CASE ("Command Manager dispatches one way commands without allocating")
+{
+    TestRuntime::Initialise ();
+
+    uint8_t data[] = { 0xB0, 0x10, 0x00, 0x00, 0x00, 0x01,
+                       (uint8_t) IdpCommandFlags::None, 0x55 };
+
+    auto packet = std::shared_ptr<IdpPacket> (
+        new IdpPacket (sizeof (data), IdpFlags::None));
+
+    packet->Write (data, sizeof (data));
+    packet->Seal ();
+
+    auto& manager = GetManager ();
+
+    uint32_t received = 0;
+
+    manager.RegisterCommand (
+        0xB010, [&](std::shared_ptr<IncomingTransaction> incomingTransaction,
+                    std::shared_ptr<OutgoingTransaction> outgoingTransaction) {
+            if (incomingTransaction->Read<uint8_t> () == 0x55)
+            {
+                received++;
+            }
+
+            return IdpResponseCode::OK;
+        });
+
+    // Warm the transaction pools.
+    REQUIRE (manager.ProcessPayload (0, packet) == nullptr);
+
+    AllocationCounter::Start ();
+
+    for (int i = 0; i < 100; i++)
+    {
+        manager.ProcessPayload (0, packet);
+    }
+
+    REQUIRE (AllocationCounter::Stop () == 0);
+    REQUIRE (received == 101);
+
+    delete &manager;
+}
+
+TEST_CASE ("Command Manager completes requests without allocating")
+{
+    TestRuntime::Initialise ();
+
+    const uint32_t requests = 100;
+
+    std::vector<std::shared_ptr<IdpPacket>> responses;
+
+    for (uint32_t i = 0; i < requests; i++)
+    {
+        uint8_t data[] = { 0xA0,
+                           0x00,
+                           0x00,
+                           0x00,
+                           0x00,
+                           (uint8_t) i,
+                           (uint8_t) IdpCommandFlags::None,
+                           (uint8_t) IdpResponseCode::OK,
+                           0xB0,
+                           0x10 };
+
+        auto packet = std::shared_ptr<IdpPacket> (
+            new IdpPacket (sizeof (data), IdpFlags::None));
+
+        packet->Write (data, sizeof (data));
+        packet->Seal ();
+
+        responses.push_back (packet);
+    }
+
+    auto& manager = GetManager ();
+
+    uint16_t address = 2;
+    uint16_t routerAddress = 3;
+    uint64_t completed = 0;
+
+    auto round = [&]() {
+        for (uint32_t i = 0; i < requests; i++)
+        {
+            // Captures as much as the enumeration handlers do.
+            manager.RegisterOneTimeResponseHandler (
+                i, [&, address, routerAddress,
+                    i](std::shared_ptr<IdpResponse> response) {
+                    if (response != nullptr &&
+                        response->TransactionId () == i &&
+                        address != routerAddress)
+                    {
+                        completed++;
+                    }
+                });
+        }
+
+        for (auto& response : responses)
+        {
+            REQUIRE (manager.ProcessPayload (0, response) == nullptr);
+        }
+    };
+
+    // Warm the handler table, timers and transaction pools.
+    round ();
+
+    AllocationCounter::Start ();
+
+    round ();
+
+    REQUIRE (AllocationCounter::Stop () == 0);
+    REQUIRE (completed == 2 * requests);
+
+    delete &manager;
+}
+
+TEST_CASE ("Response handler table keeps entries reachable across removals")
+{
+    ResponseHandlerTable table;
+    std::map<uint32_t, uint32_t> expected;
+
+    uint32_t seed = 1;
+
+    for (uint32_t i = 0; i < 5000; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+
+        // A small id range forces collisions and long probe runs.
+        uint32_t transactionId = (seed >> 16) % 256;
+
+        ResponseHandlerTimeout removed;
+
+        if (table.Remove (transactionId, removed))
+        {
+            REQUIRE (removed.timer == expected[transactionId]);
+            expected.erase (transactionId);
+        }
+        else
+        {
+            REQUIRE (expected.count (transactionId) == 0);
+
+            table.Insert (transactionId).timer = i;
+            expected[transactionId] = i;
+        }
+
+        REQUIRE (table.Count () == expected.size ());
+    }
+
+    for (auto& entry : expected)
+    {
+        auto found = table.Find (entry.first);
+
+        REQUIRE (found != nullptr);
+        REQUIRE (found->timer == entry.second);
+    }
+}
+
+static std::shared_ptr<IdpPacket> CreateRequest (uint16_t source,
+                                                 uint8_t transactionId)
+{
+    uint8_t data[] = { 0xB0,
+                       0x20,
+                       0x00,
+                       0x00,
+                       0x00,
+                       transactionId,
+                       (uint8_t) IdpCommandFlags::ResponseExpected };
+
+    auto packet = std::shared_ptr<IdpPacket> (
+        new IdpPacket (sizeof (data), IdpFlags::None, source, 1));
+
+    packet->Write (data, sizeof (data));
+    packet->Seal ();
+
+    return packet;
+}
+
+TEST_CASE ("Command Manager answers retried requests from the replay cache")
+{
+    TestRuntime::Initialise ();
+
+    auto& manager = GetManager ();
+
+    uint8_t invocations = 0;
+
+    manager.RegisterCommand (
+        0xB020, [&](std::shared_ptr<IncomingTransaction> incomingTransaction,
+                    std::shared_ptr<OutgoingTransaction> outgoingTransaction) {
+            outgoingTransaction->Write (++invocations);
+
+            return IdpResponseCode::OK;
+        });
+
+    manager.EnableReplayCache (0xB020);
+    manager.Replays ().Capacity (2);
+
+    auto first = manager.ProcessPayload (1, CreateRequest (5, 1));
+    auto retried = manager.ProcessPayload (1, CreateRequest (5, 1));
+
+    REQUIRE (invocations == 1);
+    REQUIRE (retried->Destination () == 5);
+    REQUIRE (retried->PayloadLength () == first->PayloadLength ());
+    REQUIRE (memcmp (retried->Payload (), first->Payload (),
+                     first->PayloadLength ()) == 0);
+
+    // The same transaction id from another node is a different request.
+    manager.ProcessPayload (1, CreateRequest (6, 1));
+    REQUIRE (invocations == 2);
+
+    // Source 5 is now the least recently used and gets evicted.
+    manager.ProcessPayload (1, CreateRequest (6, 1));
+    manager.ProcessPayload (1, CreateRequest (7, 1));
+    manager.ProcessPayload (1, CreateRequest (5, 1));
+
+    REQUIRE (invocations == 4);
+    REQUIRE (manager.Replays ().Hits () == 2);
+    REQUIRE (manager.Replays ().Misses () == 4);
+
+    delete &manager;
+}
+
+TEST_CASE ("Command Manager replays deferred responses once they are sent")
+{
+    TestRuntime::Initialise ();
+
+    auto& manager = GetManager ();
+
+    uint8_t invocations = 0;
+    std::shared_ptr<OutgoingTransaction> deferred;
+
+    manager.RegisterCommand (
+        0xB020, [&](std::shared_ptr<IncomingTransaction> incomingTransaction,
+                    std::shared_ptr<OutgoingTransaction> outgoingTransaction) {
+            invocations++;
+            deferred = outgoingTransaction;
+
+            return IdpResponseCode::Deferred;
+        });
+
+    manager.EnableReplayCache (0xB020);
+
+    REQUIRE (manager.ProcessPayload (1, CreateRequest (5, 1)) == nullptr);
+
+    // Retries while the handler is still running are dropped.
+    REQUIRE (manager.ProcessPayload (1, CreateRequest (5, 1)) == nullptr);
+    REQUIRE (invocations == 1);
+
+    deferred->Write ((uint8_t) 0x77)->WithResponseCode (IdpResponseCode::OK);
+
+    manager.StoreDeferredResponse (5, *deferred, *deferred->ToPacket (1, 5));
+
+    auto retried = manager.ProcessPayload (1, CreateRequest (5, 1));
+
+    REQUIRE (invocations == 1);
+    REQUIRE (retried != nullptr);
+    REQUIRE (retried->Destination () == 5);
+
+    auto& response = GetTransaction (retried);
+
+    REQUIRE (response.Read<uint8_t> () == (uint8_t) IdpResponseCode::OK);
+    REQUIRE (response.Read<uint16_t> () == 0xB020);
+    REQUIRE (response.Read<uint8_t> () == 0x77);
+
+    // A NotReady response is not kept, the retry runs the handler again.
+    REQUIRE (manager.ProcessPayload (1, CreateRequest (5, 2)) == nullptr);
+
+    deferred->WithResponseCode (IdpResponseCode::NotReady);
+    manager.StoreDeferredResponse (5, *deferred, *deferred->ToPacket (1, 5));
+
+    REQUIRE (manager.ProcessPayload (1, CreateRequest (5, 2)) == nullptr);
+    REQUIRE (invocations == 3);
+
+    // A handler that never answers only holds up retries until the pending
+    // timeout.
+    REQUIRE (manager.ProcessPayload (1, CreateRequest (5, 3)) == nullptr);
+
+    TestRuntime::IterateRuntime (ReplayCache::DefaultPendingTimeout / 2);
+
+    REQUIRE (manager.ProcessPayload (1, CreateRequest (5, 3)) == nullptr);
+    REQUIRE (invocations == 4);
+
+    TestRuntime::IterateRuntime (ReplayCache::DefaultPendingTimeout / 2);
+
+    REQUIRE (manager.ProcessPayload (1, CreateRequest (5, 3)) == nullptr);
+    REQUIRE (invocations == 5);
+
+    delete &response;
+    delete &manager;
+}
+
+TEST_CASE ("Command Manager rejects batched responses too long to prefix")
+{
+    TestRuntime::Initialise ();
+
+    auto& manager = GetManager ();
+
+    manager.RegisterCommand (
+        0xB030, [&](std::shared_ptr<IncomingTransaction> incomingTransaction,
+                    std::shared_ptr<OutgoingTransaction> outgoingTransaction) {
+            std::vector<uint8_t> block (UINT16_MAX);
+
+            outgoingTransaction->Write (block.data (), block.size ());
+
+            return IdpResponseCode::OK;
+        });
+
+    manager.RegisterCommand (
+        0xB031, [&](std::shared_ptr<IncomingTransaction> incomingTransaction,
+                    std::shared_ptr<OutgoingTransaction> outgoingTransaction) {
+            outgoingTransaction->Write ((uint8_t) 0x55);
+
+            return IdpResponseCode::OK;
+        });
+
+    auto batch =
+        OutgoingTransaction::Create (IdpCommandManager::BatchCommand, 1);
+
+    batch->WriteTransaction (OutgoingTransaction::Create (0xB030, 2));
+    batch->WriteTransaction (OutgoingTransaction::Create (0xB031, 3));
+
+    auto response = manager.ProcessPayload (1, batch->ToPacket (5, 1));
+
+    REQUIRE (response != nullptr);
+
+    IncomingTransaction incoming (response);
+
+    REQUIRE (incoming.Read<uint8_t> () == (uint8_t) IdpResponseCode::OK);
+    REQUIRE (incoming.Read<uint16_t> () == IdpCommandManager::BatchCommand);
+
+    // Only the header of the oversized response comes back.
+    REQUIRE (incoming.Read<uint16_t> () ==
+             OutgoingTransaction::ResponseHeaderLength);
+
+    auto rejected =
+        incoming.ConsumeSpan (OutgoingTransaction::ResponseHeaderLength);
+
+    REQUIRE (rejected[6] == (uint8_t) IdpCommandFlags::None);
+    REQUIRE (rejected[7] == (uint8_t) IdpResponseCode::InvalidParameters);
+    REQUIRE (rejected[8] == 0xB0);
+    REQUIRE (rejected[9] == 0x30);
+
+    // The rest of the batch is unaffected.
+    REQUIRE (incoming.Read<uint16_t> () ==
+             OutgoingTransaction::ResponseHeaderLength + 1);
+
+    auto accepted =
+        incoming.ConsumeSpan (OutgoingTransaction::ResponseHeaderLength + 1);
+
+    REQUIRE (accepted[7] == (uint8_t) IdpResponseCode::OK);
+    REQUIRE (accepted[10] == 0x55);
+    REQUIRE (incoming.BytesRemaining () == 0);
+
+    delete &manager;
+}
+
+TEST_CASE ("Incoming transactions read views without copying")
+{
+    auto outgoing = OutgoingTransaction::Create (0xB040, 1);
+
+    outgoing->Write ((void*) "Node.Name", 10);
+    outgoing->Write ((uint16_t) 0x1234);
+    outgoing->Write ((uint16_t) 0xABCD);
+    outgoing->Write ((uint8_t) 0x01);
+    outgoing->Write ((uint8_t) 0x02);
+
+    auto packet = outgoing->ToPacket (1, 2);
+
+    IncomingTransaction incoming (packet);
+
+    auto name = incoming.ReadStringView ();
+
+    REQUIRE (name.Equals ("Node.Name"));
+    REQUIRE (name.Length () == 9);
+    REQUIRE (name.Data ()[9] == '\0');
+    REQUIRE ((const uint8_t*) name.Data () > packet->Data ());
+    REQUIRE ((const uint8_t*) name.Data () < packet->Data () + packet->Length ());
+
+    auto words = incoming.ReadArrayView<uint16_t> (2);
+
+    REQUIRE (words.Count () == 2);
+    REQUIRE (words[0] == 0x1234);
+    REQUIRE (words[1] == 0xABCD);
+
+    auto bytes = incoming.ConsumeSpan (2);
+
+    REQUIRE (bytes.Count () == 2);
+    REQUIRE (bytes[1] == 0x02);
+    REQUIRE (incoming.BytesRemaining () == 0);
+}
+
+TEST_CASE ("Outgoing transactions write into a pre-sized reusable buffer")
+{
+    uint8_t block[4096];
+
+    for (uint32_t i = 0; i < sizeof (block); i++)
+    {
+        block[i] = (uint8_t) i;
+    }
+
+    auto outgoing =
+        OutgoingTransaction::Create (0xB042, 1, IdpCommandFlags::None,
+                                     sizeof (block));
+
+    AllocationCounter::Start ();
+
+    outgoing->Write (block, sizeof (block));
+
+    REQUIRE (AllocationCounter::Stop () == 0);
+    REQUIRE (outgoing->Length () ==
+             OutgoingTransaction::HeaderLength + sizeof (block));
+
+    // Writing past the end extends the transaction.
+    outgoing->WriteAt ((uint16_t) 0xCAFE, outgoing->Length ());
+
+    IncomingTransaction incoming (outgoing->ToPacket (1, 2));
+
+    REQUIRE (incoming.CommandId () == 0xB042);
+    REQUIRE (incoming.BytesRemaining () == sizeof (block) + 2);
+    REQUIRE (memcmp (incoming.ConsumeSpan (sizeof (block)).Data (), block,
+                     sizeof (block)) == 0);
+    REQUIRE (incoming.Read<uint16_t> () == 0xCAFE);
+
+    AllocationCounter::Start ();
+
+    outgoing->Reset (0xB043, 2, IdpCommandFlags::None)
+        ->Write (block, sizeof (block));
+
+    REQUIRE (AllocationCounter::Stop () == 0);
+
+    IncomingTransaction reused (outgoing->ToPacket (1, 2));
+
+    REQUIRE (reused.CommandId () == 0xB043);
+    REQUIRE (reused.TransactionId () == 2);
+    REQUIRE (reused.BytesRemaining () == sizeof (block));
+}
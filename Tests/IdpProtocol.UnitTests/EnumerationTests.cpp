@@ -0,0 +1,486 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include <stdint.h>
+
+#include "IdpRouter.h"
+#include "MasterNode.h"
+#include "SimpleAdaptor.h"
+#include "TestRuntime.h"
+#include "TestStream.h"
+#include "catch.hpp"
+#include <deque>
+#include <vector>
+
+static const Guid_t TestGuid = Guid_t ("dfda0b6f-7ee4-4906-8b1c-15f455fbb77c");
+
+/**
+ * Link that delivers packets a fixed time after they were sent.
+ */
+class LatencyAdaptor : public SimpleAdaptor
+{
+  public:
+    LatencyAdaptor (uint32_t latency)
+    {
+        Latency = latency;
+    }
+
+    bool Transmit (std::shared_ptr<IdpPacket> packet)
+    {
+        QueuedPacket queued;
+        queued.DueAt = Application::GetApplicationTime () + Latency;
+        queued.Packet = packet;
+
+        Queued.push_back (queued);
+
+        return true;
+    }
+
+    void Deliver ()
+    {
+        auto now = Application::GetApplicationTime ();
+
+        // Delivering can send more packets onto this link.
+        while (!Queued.empty () && Queued.front ().DueAt <= now)
+        {
+            auto packet = Queued.front ().Packet;
+
+            Queued.pop_front ();
+
+            SimpleAdaptor::Transmit (packet);
+        }
+    }
+
+    struct QueuedPacket
+    {
+        uint64_t DueAt;
+        std::shared_ptr<IdpPacket> Packet;
+    };
+
+    uint32_t Latency;
+    std::deque<QueuedPacket> Queued;
+};
+
+/**
+ * A master on a hub router with a tree of routers below it, each carrying
+ * a few nodes. Every link between routers has the same latency.
+ */
+class EnumerationTestNetwork
+{
+  public:
+    EnumerationTestNetwork (uint32_t branches, uint32_t depth,
+                            uint32_t nodesPerRouter, uint32_t latency)
+    {
+        TestRuntime::Initialise ();
+
+        Master = new MasterNode ();
+
+        auto& hub = *new IdpRouter ();
+
+        hub.AddNode (*Master);
+
+        Nodes = 1;
+
+        AddBranches (hub, branches, depth, nodesPerRouter, latency);
+    }
+
+    /**
+     * Enumerates the network and returns how long it took, in ms.
+     */
+    uint64_t Enumerate (uint8_t concurrency)
+    {
+        Master->EnumerationConcurrency (concurrency);
+
+        auto start = Application::GetApplicationTime ();
+
+        Master->EnumerateNetwork ();
+
+        for (uint32_t i = 0; i < 100000 && Master->IsEnumerating (); i++)
+        {
+            TestRuntime::IterateRuntime (1);
+
+            for (auto adaptor : Adaptors)
+            {
+                adaptor->Deliver ();
+            }
+        }
+
+        return Application::GetApplicationTime () - start;
+    }
+
+    uint32_t Discovered ()
+    {
+        return Count (*Master->NetworkTree ());
+    }
+
+    MasterNode* Master;
+    std::vector<LatencyAdaptor*> Adaptors;
+
+    // Routers and nodes, including the hub and the master.
+    uint32_t Nodes;
+
+  private:
+    void AddBranches (IdpRouter& parent, uint32_t branches, uint32_t depth,
+                      uint32_t nodesPerRouter, uint32_t latency)
+    {
+        Nodes++;
+
+        for (uint32_t i = 0; i < nodesPerRouter; i++)
+        {
+            parent.AddNode (*new IdpNode (TestGuid, "Test.Node"));
+
+            Nodes++;
+        }
+
+        if (depth == 0)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < branches; i++)
+        {
+            auto& router = *new IdpRouter ();
+            auto& up = *new LatencyAdaptor (latency);
+            auto& down = *new LatencyAdaptor (latency);
+
+            parent.AddAdaptor (down);
+            router.AddAdaptor (up);
+
+            down.SetRemote (up);
+            up.SetRemote (down);
+
+            Adaptors.push_back (&down);
+            Adaptors.push_back (&up);
+
+            AddBranches (router, branches, depth - 1, nodesPerRouter, latency);
+        }
+    }
+
+    static uint32_t Count (NodeInfo& node)
+    {
+        uint32_t result = 1;
+
+        for (auto child : node.Children)
+        {
+            result += Count (*child);
+        }
+
+        return result;
+    }
+};
+
+TEST_CASE ("Concurrent enumeration discovers the same network sooner")
+{
+    EnumerationTestNetwork serial (4, 1, 2, 20);
+
+    auto serialTime = serial.Enumerate (1);
+
+    REQUIRE_FALSE (serial.Master->IsEnumerating ());
+    REQUIRE (serial.Discovered () == serial.Nodes);
+
+    EnumerationTestNetwork concurrent (4, 1, 2, 20);
+
+    auto concurrentTime = concurrent.Enumerate (4);
+
+    REQUIRE_FALSE (concurrent.Master->IsEnumerating ());
+    REQUIRE (concurrent.Discovered () == concurrent.Nodes);
+
+    REQUIRE (concurrentTime < serialTime);
+
+    // A second pass finds nothing new and ends with nothing in flight.
+    concurrent.Enumerate (4);
+
+    REQUIRE_FALSE (concurrent.Master->IsEnumerating ());
+    REQUIRE (concurrent.Discovered () == concurrent.Nodes);
+}
+
+TEST_CASE ("Node info is fetched while enumeration carries on")
+{
+    const uint32_t roundTrip = 40;
+
+    // One router behind a 20 ms link, with 8 nodes.
+    EnumerationTestNetwork network (1, 1, 8, roundTrip / 2);
+
+    auto time = network.Enumerate (1);
+
+    REQUIRE (network.Discovered () == network.Nodes);
+
+    // Waiting for GetNodeInfo would cost each of them a second round trip.
+    REQUIRE (time < 8 * 2 * roundTrip);
+}
+
+/**
+ * Counts the enumeration requests the master sends across a link.
+ */
+class EnumerationCountingAdaptor : public SimpleAdaptor
+{
+  public:
+    EnumerationCountingAdaptor ()
+    {
+        Requests = 0;
+    }
+
+    bool Transmit (std::shared_ptr<IdpPacket> packet)
+    {
+        auto payload = packet->Payload ();
+        switch (static_cast<NodeCommand> ((payload[0] << 8) | payload[1]))
+        {
+            case NodeCommand::RouterEnumerateNode:
+            case NodeCommand::RouterPrepareToEnumerateAdaptors:
+            case NodeCommand::RouterEnumerateAdaptor:
+                Requests++;
+                break;
+
+            default:
+                break;
+        }
+
+        return SimpleAdaptor::Transmit (packet);
+    }
+
+    uint32_t Requests;
+};
+
+TEST_CASE ("Only routers whose generation moved are enumerated again")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router1 = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+    auto& router3 = *new IdpRouter ();
+
+    router1.AddNode (masterNode);
+    router2.AddNode (*new IdpNode (TestGuid, "Remote.Node.1"));
+    router3.AddNode (*new IdpNode (TestGuid, "Remote.Node.2"));
+
+    auto& toRouter2 = *new EnumerationCountingAdaptor ();
+    auto& fromRouter1 = *new EnumerationCountingAdaptor ();
+    auto& toRouter3 = *new EnumerationCountingAdaptor ();
+    auto& fromRouter1Too = *new EnumerationCountingAdaptor ();
+
+    router1.AddAdaptor (toRouter2);
+    router2.AddAdaptor (fromRouter1);
+    router1.AddAdaptor (toRouter3);
+    router3.AddAdaptor (fromRouter1Too);
+
+    toRouter2.SetRemote (fromRouter1);
+    fromRouter1.SetRemote (toRouter2);
+    toRouter3.SetRemote (fromRouter1Too);
+    fromRouter1Too.SetRemote (toRouter3);
+
+    auto iterate = [](uint32_t timeMs) {
+        for (uint32_t i = 0; i < timeMs; i += IdpScheduler::Resolution)
+        {
+            TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+        }
+    };
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE (masterNode.HasNode (router3.Address ()));
+
+    // Routers are enumerated until their first Ping reports a generation.
+    iterate (3000);
+
+    toRouter2.Requests = 0;
+    toRouter3.Requests = 0;
+
+    iterate (5000);
+
+    REQUIRE (toRouter2.Requests == 0);
+    REQUIRE (toRouter3.Requests == 0);
+
+    auto& newNode = *new IdpNode (TestGuid, "Remote.Node.3");
+
+    router3.AddNode (newNode);
+
+    iterate (2000);
+
+    REQUIRE (newNode.Address () != UnassignedAddress);
+    REQUIRE (masterNode.HasNode (newNode.Address ()));
+    REQUIRE (toRouter2.Requests == 0);
+    REQUIRE (toRouter3.Requests > 0);
+
+    // A node that resets is found again the same way.
+    toRouter3.Requests = 0;
+
+    newNode.OnReset ();
+
+    iterate (3000);
+
+    REQUIRE (newNode.Address () != UnassignedAddress);
+    REQUIRE (toRouter2.Requests == 0);
+    REQUIRE (toRouter3.Requests > 0);
+}
+
+TEST_CASE ("A restarted master takes over the network from a snapshot")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router1 = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+    auto& router3 = *new IdpRouter ();
+    auto& node1 = *new IdpNode (TestGuid, "Remote.Node.1");
+    auto& node2 = *new IdpNode (TestGuid, "Remote.Node.2");
+
+    router1.AddNode (masterNode);
+    router2.AddNode (node1);
+    router3.AddNode (node2);
+
+    auto& toRouter2 = *new EnumerationCountingAdaptor ();
+    auto& fromRouter1 = *new EnumerationCountingAdaptor ();
+    auto& toRouter3 = *new EnumerationCountingAdaptor ();
+    auto& fromRouter1Too = *new EnumerationCountingAdaptor ();
+
+    router1.AddAdaptor (toRouter2);
+    router2.AddAdaptor (fromRouter1);
+    router1.AddAdaptor (toRouter3);
+    router3.AddAdaptor (fromRouter1Too);
+
+    toRouter2.SetRemote (fromRouter1);
+    fromRouter1.SetRemote (toRouter2);
+    toRouter3.SetRemote (fromRouter1Too);
+    fromRouter1Too.SetRemote (toRouter3);
+
+    auto iterate = [](uint32_t timeMs) {
+        for (uint32_t i = 0; i < timeMs; i += IdpScheduler::Resolution)
+        {
+            TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+        }
+    };
+
+    masterNode.EnumerateNetwork ();
+
+    iterate (3000);
+
+    auto node1Address = node1.Address ();
+    auto node2Address = node2.Address ();
+
+    REQUIRE (masterNode.HasNode (node1Address));
+    REQUIRE (masterNode.HasNode (node2Address));
+
+    TestStream file (4096);
+    auto reader = file.GetEndpoint ();
+
+    REQUIRE (masterNode.SaveTopology (file));
+
+    // Restart the master.
+    router1.RemoveNode (masterNode);
+    masterNode.Enabled (false);
+
+    auto& restarted = *new MasterNode ();
+
+    router1.AddNode (restarted);
+
+    toRouter2.Requests = 0;
+    toRouter3.Requests = 0;
+
+    node2.Enabled (false);
+
+    // Held until node2 fails to answer.
+    REQUIRE (restarted.LoadTopology (*reader));
+    REQUIRE (restarted.IsEnumerating ());
+
+    iterate (3000);
+
+    // Taken over without resetting any node that answered.
+    REQUIRE_FALSE (restarted.IsEnumerating ());
+    REQUIRE (restarted.HasNode (router2.Address ()));
+    REQUIRE (restarted.HasNode (node1Address));
+    REQUIRE (node1.Address () == node1Address);
+    REQUIRE (toRouter2.Requests == 0);
+    REQUIRE_FALSE (restarted.HasNode (node2Address));
+
+    // Only the router of the node that did not answer is walked again, and
+    // finds it once it resets.
+    REQUIRE (toRouter3.Requests > 0);
+
+    node2.Enabled (true);
+
+    iterate (6000);
+
+    REQUIRE (node2.Address () != UnassignedAddress);
+    REQUIRE (restarted.HasNode (node2.Address ()));
+    REQUIRE (node1.Address () == node1Address);
+    REQUIRE (toRouter2.Requests == 0);
+}
+
+TEST_CASE ("Incomplete topology snapshots are not loaded")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router = *new IdpRouter ();
+
+    router.AddNode (masterNode);
+    router.AddNode (*new IdpNode (TestGuid, "Remote.Node"));
+
+    masterNode.EnumerateNetwork ();
+
+    TestStream file (4096);
+    auto reader = file.GetEndpoint ();
+
+    REQUIRE (masterNode.SaveTopology (file));
+
+    auto length = reader->BytesReceived ();
+    std::vector<uint8_t> snapshot (length);
+
+    reader->Read (snapshot.data (), length);
+
+    auto original = snapshot;
+
+    // Truncated.
+    file.Write (snapshot.data (), length - 1);
+
+    REQUIRE_FALSE (masterNode.LoadTopology (*reader));
+
+    // Drops what the truncated load left behind.
+    reader->Read (snapshot.data (), length);
+
+    // A name that is not terminated.
+    snapshot = original;
+    snapshot[length - 1] = 'x';
+    file.Write (snapshot.data (), length);
+
+    REQUIRE_FALSE (masterNode.LoadTopology (*reader));
+    REQUIRE (masterNode.HasNode (2));
+
+    // Addresses the master never assigns.
+    for (uint16_t address : { (uint16_t) 0, RouterPollAddress,
+                              MulticastAddressBase,
+                              (uint16_t) (MulticastAddressBase +
+                                          MulticastGroupCount - 1) })
+    {
+        snapshot = original;
+        snapshot[TopologySnapshot::HeaderLength] = address >> 8;
+        snapshot[TopologySnapshot::HeaderLength + 1] = address & 0xFF;
+
+        TestStream corrupt (4096);
+
+        corrupt.Write (snapshot.data (), length);
+
+        REQUIRE_FALSE (masterNode.LoadTopology (*corrupt.GetEndpoint ()));
+        REQUIRE (masterNode.HasNode (2));
+        REQUIRE_FALSE (masterNode.HasNode (address));
+    }
+}
+
+TEST_CASE ("Benchmark time to enumerate a network of routers",
+           "[.benchmark]")
+{
+    const uint8_t concurrencies[] = {1, 2, 4, 8, 16};
+
+    for (auto concurrency : concurrencies)
+    {
+        // 1 + 4 + 16 routers with 3 nodes each, 10 ms per link.
+        EnumerationTestNetwork network (4, 2, 3, 10);
+
+        auto time = network.Enumerate (concurrency);
+        REQUIRE (network.Discovered () == network.Nodes);
+
+        printf ("Enumerated %u nodes with %u routers in flight in %u ms\n",
+                network.Nodes, concurrency, (uint32_t)time);
+    }
+}
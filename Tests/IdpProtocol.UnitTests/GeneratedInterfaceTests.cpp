@@ -0,0 +1,262 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+
+#include "catch.hpp"
+
+#include "IdpRouter.h"
+#include "MasterNode.h"
+#include "SensorInterface.h"
+#include "TestRuntime.h"
+#include <chrono>
+#include <cstdio>
+
+static const Guid_t SensorGuid = Guid_t ("5b0bfc37-8d5e-4c1f-9a0f-2e3b0b6c9d11");
+
+class SensorNode : public IdpNode, public SensorServer
+{
+  public:
+    SensorNode () : IdpNode (SensorGuid, "Sensor.Node")
+    {
+        RegisterCommands (Manager ());
+    }
+
+    IdpResponseCode Configure (const SensorConfigureRequest& request,
+                               SensorConfigureResponse& response)
+    {
+        Configuration = request;
+
+        return IdpResponseCode::OK;
+    }
+
+    IdpResponseCode GetReading (const SensorGetReadingRequest& request,
+                                SensorGetReadingResponse& response)
+    {
+        if (request.Channel > 3)
+        {
+            return IdpResponseCode::InvalidParameters;
+        }
+
+        response.Value = -1000 * request.Channel;
+        response.Status = 0xBEEF;
+        response.Timestamp = 0x0102030405060708;
+
+        return IdpResponseCode::OK;
+    }
+
+    IdpResponseCode Describe (const SensorDescribeRequest& request,
+                              SensorDescribeResponse& response)
+    {
+        response.Name = "Thermocouple";
+        response.Serial = 1234567;
+
+        return IdpResponseCode::OK;
+    }
+
+    void Blink (const SensorBlinkRequest& request)
+    {
+        BlinkDuration = request.DurationMs;
+    }
+
+    SensorConfigureRequest Configuration = SensorConfigureRequest ();
+    uint16_t BlinkDuration = 0;
+};
+
+static SensorConfigureRequest CreateConfiguration ()
+{
+    SensorConfigureRequest request = {};
+    request.RateHz = 100000;
+    request.Channel = 3;
+    request.Offset = -42;
+    request.Gain = 1.5f;
+    request.Averaging = 16;
+    request.Enabled = true;
+
+    return request;
+}
+
+TEST_CASE ("Generated client and server exchange commands")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router = *new IdpRouter ();
+    auto& sensorNode = *new SensorNode ();
+
+    router.AddNode (masterNode);
+    router.AddNode (sensorNode);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    SensorClient client (masterNode, sensorNode.Address ());
+
+    auto configuration = CreateConfiguration ();
+    auto configured = IdpResponseCode::UnknownError;
+
+    client.Configure (configuration,
+                      [&](IdpResponseCode responseCode,
+                          const SensorConfigureResponse& response) {
+                          configured = responseCode;
+                      });
+
+    REQUIRE (configured == IdpResponseCode::OK);
+    REQUIRE (sensorNode.Configuration.RateHz == 100000);
+    REQUIRE (sensorNode.Configuration.Channel == 3);
+    REQUIRE (sensorNode.Configuration.Offset == -42);
+    REQUIRE (sensorNode.Configuration.Gain == 1.5f);
+    REQUIRE (sensorNode.Configuration.Averaging == 16);
+    REQUIRE (sensorNode.Configuration.Enabled);
+
+    SensorGetReadingRequest reading = {};
+    reading.Channel = 2;
+
+    bool read = false;
+
+    client.GetReading (reading, [&](IdpResponseCode responseCode,
+                                    const SensorGetReadingResponse& response) {
+        read = responseCode == IdpResponseCode::OK && response.Value == -2000 &&
+               response.Status == 0xBEEF &&
+               response.Timestamp == 0x0102030405060708;
+    });
+
+    REQUIRE (read);
+
+    reading.Channel = 9;
+
+    auto rejected = IdpResponseCode::OK;
+
+    client.GetReading (reading, [&](IdpResponseCode responseCode,
+                                    const SensorGetReadingResponse& response) {
+        rejected = responseCode;
+    });
+
+    REQUIRE (rejected == IdpResponseCode::InvalidParameters);
+
+    bool described = false;
+
+    client.Describe (SensorDescribeRequest (),
+                     [&](IdpResponseCode responseCode,
+                         const SensorDescribeResponse& response) {
+                         described = responseCode == IdpResponseCode::OK &&
+                                     response.Name.Equals ("Thermocouple") &&
+                                     response.Serial == 1234567;
+                     });
+
+    REQUIRE (described);
+
+    SensorBlinkRequest blink = {};
+    blink.DurationMs = 250;
+
+    REQUIRE (client.Blink (blink));
+    REQUIRE (sensorNode.BlinkDuration == 250);
+}
+
+TEST_CASE ("Generated serializers match the hand written encoding")
+{
+    auto configuration = CreateConfiguration ();
+
+    auto generated = OutgoingTransaction::Create (0xB100, 1);
+    configuration.WriteTo (*generated);
+
+    auto handWritten = OutgoingTransaction::Create (0xB100, 1);
+    handWritten->Write (configuration.RateHz)
+        ->Write (configuration.Channel)
+        ->Write (configuration.Offset);
+
+    uint32_t gain;
+    memcpy (&gain, &configuration.Gain, sizeof (gain));
+
+    handWritten->Write (gain)
+        ->Write (configuration.Averaging)
+        ->Write ((uint8_t) configuration.Enabled);
+
+    auto generatedPacket = generated->ToPacket (1, 2);
+    auto handWrittenPacket = handWritten->ToPacket (1, 2);
+
+    REQUIRE (generatedPacket->Length () == handWrittenPacket->Length ());
+    REQUIRE (memcmp (generatedPacket->Data (), handWrittenPacket->Data (),
+                     generatedPacket->Length ()) == 0);
+    REQUIRE (generatedPacket->PayloadLength () ==
+             7 + SensorConfigureRequest::FixedSize);
+
+    // A truncated request is rejected rather than read out of bounds.
+    auto truncated = OutgoingTransaction::Create (0xB100, 1);
+    truncated->Write (configuration.RateHz);
+
+    IncomingTransaction incoming (truncated->ToPacket (1, 2));
+    SensorConfigureRequest request = {};
+
+    REQUIRE_FALSE (request.ReadFrom (incoming));
+}
+
+TEST_CASE ("Benchmark generated serializers against hand written ones",
+           "[.benchmark]")
+{
+    const uint32_t iterations = 200000;
+
+    auto configuration = CreateConfiguration ();
+    uint32_t checksum = 0;
+
+    auto begin = std::chrono::steady_clock::now ();
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        auto transaction = OutgoingTransaction::Create (0xB100, i);
+
+        uint32_t gain;
+        memcpy (&gain, &configuration.Gain, sizeof (gain));
+
+        transaction->Write (configuration.RateHz)
+            ->Write (configuration.Channel)
+            ->Write (configuration.Offset)
+            ->Write (gain)
+            ->Write (configuration.Averaging)
+            ->Write ((uint8_t) configuration.Enabled);
+
+        IncomingTransaction incoming (transaction->ToPacket (1, 2));
+
+        checksum += incoming.Read<uint32_t> ();
+        checksum += incoming.Read<uint8_t> ();
+        checksum += incoming.Read<int16_t> ();
+        checksum += incoming.Read<uint32_t> ();
+        checksum += incoming.Read<uint16_t> ();
+        checksum += incoming.Read<uint8_t> ();
+    }
+
+    auto handWrittenTime = std::chrono::steady_clock::now () - begin;
+
+    begin = std::chrono::steady_clock::now ();
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        auto transaction = OutgoingTransaction::Create (0xB100, i);
+
+        configuration.WriteTo (*transaction);
+
+        IncomingTransaction incoming (transaction->ToPacket (1, 2));
+
+        SensorConfigureRequest request = {};
+        REQUIRE (request.ReadFrom (incoming));
+
+        uint32_t gain;
+        memcpy (&gain, &request.Gain, sizeof (gain));
+
+        checksum -= request.RateHz + request.Channel + request.Offset + gain +
+                    request.Averaging + request.Enabled;
+    }
+
+    auto generatedTime = std::chrono::steady_clock::now () - begin;
+
+    printf ("%u requests: hand written %lld us, generated %lld us\n",
+            iterations,
+            (long long) std::chrono::duration_cast<std::chrono::microseconds> (
+                handWrittenTime)
+                .count (),
+            (long long) std::chrono::duration_cast<std::chrono::microseconds> (
+                generatedTime)
+                .count ());
+
+    REQUIRE (checksum == 0);
+}
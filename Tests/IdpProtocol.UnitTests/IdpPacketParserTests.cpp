@@ -6,10 +6,12 @@
 #include "DataReceivedEventArgs.h"
 #include "IdpPacket.h"
 #include "IdpPacketParser.h"
+#include "NotifyingStreamAdaptor.h"
 #include "TestRuntime.h"
 #include "TestStream.h"
 
 #include "DispatcherTimer.h"
+#include <vector>
 
 TEST_CASE ("Can parse a minimal packet with 1byte payload")
 {
@@ -106,3 +108,394 @@ TEST_CASE ("Can reconstruct a packet including ETX")
     delete packet;
     packet = nullptr;
 }
+
+TEST_CASE ("Parser validates packet CRC")
+{
+    TestRuntime::Initialise ();
+
+    auto& parser = *new IdpPacketParser ();
+
+    auto parserEndPointStream = new TestStream ();
+
+    auto originatorEndPointStream = parserEndPointStream->GetEndpoint ();
+
+    parser.Stream (parserEndPointStream);
+
+    int packetsReceived = 0;
+
+    parser.DataReceived += [&](auto sender, auto& e) { packetsReceived++; };
+
+    auto packet = new IdpPacket (4, IdpFlags::CRC);
+
+    packet->Write ((uint32_t) 0xAA55AA55);
+    packet->Seal ();
+
+    originatorEndPointStream->Write (packet->Data (), packet->Length ());
+
+    parser.Parse ();
+
+    REQUIRE (packetsReceived == 1);
+
+    packet->Data ()[12] ^= 0x01;
+
+    originatorEndPointStream->Write (packet->Data (), packet->Length ());
+
+    parser.Parse ();
+
+    REQUIRE (packetsReceived == 1);
+
+    delete packet;
+}
+
+class RecordingCutThroughSink : public ICutThroughSink
+{
+  public:
+    RecordingCutThroughSink ()
+    {
+        Ended = false;
+        Valid = false;
+    }
+
+    bool BeginCutThrough (IdpFlags flags, uint16_t source,
+                          uint16_t destination, uint32_t length)
+    {
+        return true;
+    }
+
+    bool CutThroughData (const uint8_t* data, uint32_t length)
+    {
+        Data.insert (Data.end (), data, data + length);
+
+        return true;
+    }
+
+    void EndCutThrough (bool valid)
+    {
+        Ended = true;
+        Valid = valid;
+    }
+
+    std::vector<uint8_t> Data;
+    bool Ended;
+    bool Valid;
+};
+
+TEST_CASE ("Parser cuts through payload bytes as they arrive")
+{
+    TestRuntime::Initialise ();
+
+    auto& parser = *new IdpPacketParser ();
+    auto sink = RecordingCutThroughSink ();
+
+    auto parserEndPointStream = new TestStream ();
+
+    auto originatorEndPointStream = parserEndPointStream->GetEndpoint ();
+
+    parser.Stream (parserEndPointStream);
+    parser.CutThroughSink (&sink);
+
+    bool reassembled = false;
+
+    parser.DataReceived += [&](auto sender, auto& e) { reassembled = true; };
+
+    auto packet = new IdpPacket (300, IdpFlags::CRC, 2, 3);
+
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        packet->Write ((uint8_t) i);
+    }
+
+    packet->Seal ();
+
+    originatorEndPointStream->Write (packet->Data (), 160);
+
+    parser.Parse ();
+
+    REQUIRE (sink.Data.size () == 160);
+    REQUIRE_FALSE (sink.Ended);
+
+    originatorEndPointStream->Write (packet->Data () + 160,
+                                     packet->Length () - 160);
+
+    parser.Parse ();
+
+    REQUIRE (sink.Ended);
+    REQUIRE (sink.Valid);
+    REQUIRE_FALSE (reassembled);
+    REQUIRE (sink.Data.size () == packet->Length ());
+    REQUIRE (memcmp (sink.Data.data (), packet->Data (), packet->Length ()) ==
+             0);
+
+    delete packet;
+}
+
+TEST_CASE ("Parser aborts a cut through packet with a bad ETX")
+{
+    TestRuntime::Initialise ();
+
+    auto& parser = *new IdpPacketParser ();
+    auto sink = RecordingCutThroughSink ();
+
+    auto parserEndPointStream = new TestStream ();
+
+    auto originatorEndPointStream = parserEndPointStream->GetEndpoint ();
+
+    parser.Stream (parserEndPointStream);
+    parser.CutThroughSink (&sink);
+
+    auto packet = new IdpPacket (100, IdpFlags::CRC, 2, 3);
+
+    packet->IncrementWritePointer (100);
+    packet->Seal ();
+
+    packet->Data ()[packet->Length () - 5] = 0x55;
+
+    originatorEndPointStream->Write (packet->Data (), packet->Length ());
+
+    parser.Parse ();
+
+    REQUIRE (sink.Ended);
+    REQUIRE_FALSE (sink.Valid);
+    REQUIRE (sink.Data.size () == packet->Length () - 4);
+    REQUIRE (sink.Data.back () != 0x03);
+
+    delete packet;
+}
+
+/**
+ * Notifies the adaptor using it whenever data is written to the other end.
+ */
+class NotifyingTestStream : public INotifyingStream
+{
+  public:
+    NotifyingTestStream (std::shared_ptr<TestStream> stream)
+        : _stream (stream)
+    {
+    }
+
+    bool IsValid ()
+    {
+        return _stream->IsValid ();
+    }
+
+    int32_t BytesReceived ()
+    {
+        return _stream->BytesReceived ();
+    }
+
+    void Close ()
+    {
+        _stream->Close ();
+    }
+
+    int32_t Read (void* buffer, uint32_t length)
+    {
+        return _stream->Read (buffer, length);
+    }
+
+    int32_t Write (const void* data, uint32_t length)
+    {
+        return _stream->Write (data, length);
+    }
+
+    void Notify ()
+    {
+        DataReceived (this, EventArgs::Empty);
+    }
+
+  private:
+    std::shared_ptr<TestStream> _stream;
+};
+
+/**
+ * Cuts every packet through to one egress adaptor.
+ */
+class CutThroughPort : public IAdaptorToRouterPort
+{
+  public:
+    bool Transmit (uint16_t adaptorId, std::shared_ptr<IdpPacket> packet)
+    {
+        Received.push_back (packet);
+
+        return true;
+    }
+
+    IAdaptor* ResolveCutThrough (uint16_t adaptorId, uint16_t source,
+                                 uint16_t destination, uint32_t length)
+    {
+        return Egress->BeginForward () ? Egress : nullptr;
+    }
+
+    IAdaptor* Egress;
+    std::vector<std::shared_ptr<IdpPacket>> Received;
+};
+
+TEST_CASE ("A stalled cut through packet does not wedge the egress")
+{
+    TestRuntime::Initialise ();
+
+    auto ingressRemote = new TestStream (4096);
+    auto ingressStream = std::shared_ptr<NotifyingTestStream> (
+        new NotifyingTestStream (ingressRemote->GetEndpoint ()));
+
+    auto egressRemote = new TestStream (8192);
+    auto egressStream = std::shared_ptr<NotifyingTestStream> (
+        new NotifyingTestStream (egressRemote->GetEndpoint ()));
+
+    auto& ingress = *new NotifyingStreamAdaptor ();
+    auto& egress = *new NotifyingStreamAdaptor ();
+    CutThroughPort port;
+
+    port.Egress = &egress;
+
+    ingress.Connection (ingressStream);
+    ingress.SetLocal (port);
+    ingress.AdaptorId (1);
+    ingress.CutThrough (true);
+
+    egress.Connection (egressStream);
+
+    auto stalled = new IdpPacket (300, IdpFlags::None, 2, 3);
+
+    stalled->IncrementWritePointer (300);
+    stalled->Seal ();
+
+    // The sender stops partway through the payload.
+    ingressRemote->Write (stalled->Data (), 100);
+    ingressStream->Notify ();
+
+    REQUIRE (egressRemote->BytesReceived () == 100);
+
+    auto other = std::shared_ptr<IdpPacket> (
+        new IdpPacket (7, IdpFlags::None, 4, 5));
+
+    other->Write ((uint16_t) 0xA001);
+    other->Write ((uint32_t) 1000);
+    other->Write ((uint8_t) 0x01);
+    other->Seal ();
+
+    REQUIRE (egress.Transmit (other));
+    REQUIRE (egressRemote->BytesReceived () == 100);
+
+    // Held traffic is bounded.
+    auto large = std::shared_ptr<IdpPacket> (
+        new IdpPacket (egress.HeldBytesLimit (), IdpFlags::None, 4, 5));
+
+    large->IncrementWritePointer (egress.HeldBytesLimit ());
+    large->Seal ();
+
+    REQUIRE_FALSE (egress.Transmit (large));
+
+    for (uint32_t i = 0; i <= ingress.CutThroughTimeout ();
+         i += IdpScheduler::Resolution)
+    {
+        TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+    }
+
+    // The stalled packet is terminated with an invalid ETX and the held
+    // packet follows it.
+    IdpPacketParser parser;
+    std::vector<std::shared_ptr<IdpPacket>> received;
+
+    parser.Stream (egressRemote);
+
+    parser.DataReceived += [&](auto sender, auto& e) {
+        received.push_back (static_cast<DataReceivedEventArgs&> (e).Packet);
+    };
+
+    // The parser stops at the bad ETX.
+    parser.Parse ();
+    parser.Parse ();
+
+    REQUIRE (received.size () == 1);
+    REQUIRE (received[0]->Length () == other->Length ());
+    REQUIRE (memcmp (received[0]->Data (), other->Data (), other->Length ()) ==
+             0);
+
+    // Both adaptors carry on.
+    REQUIRE (egress.Transmit (other));
+
+    parser.Parse ();
+
+    REQUIRE (received.size () == 2);
+
+    ingressRemote->Write (other->Data (), other->Length ());
+    ingressStream->Notify ();
+
+    REQUIRE (port.Received.size () == 1);
+
+    delete stalled;
+}
+
+TEST_CASE ("Parser expands compact frames")
+{
+    TestRuntime::Initialise ();
+
+    auto& parser = *new IdpPacketParser ();
+
+    auto parserEndPointStream = new TestStream ();
+
+    auto originatorEndPointStream = parserEndPointStream->GetEndpoint ();
+
+    parser.Stream (parserEndPointStream);
+
+    std::vector<std::shared_ptr<IdpPacket>> received;
+
+    parser.DataReceived += [&](auto sender, auto& e) {
+        received.push_back (static_cast<DataReceivedEventArgs&> (e).Packet);
+    };
+
+    // A ping from 300 to 1, with a CRC.
+    auto ping = std::shared_ptr<IdpPacket> (
+        new IdpPacket (7, IdpFlags::CRC, 300, 1));
+
+    ping->Write ((uint16_t) 0xA001);
+    ping->Write ((uint32_t) 1000);
+    ping->Write ((uint8_t) 0x01);
+    ping->Seal ();
+
+    REQUIRE (CompactFrame::CanEncode (*ping));
+
+    uint8_t frame[CompactFrame::MaxFrameLength];
+    auto length = CompactFrame::Encode (*ping, frame);
+
+    REQUIRE (length == 16);
+    REQUIRE (length < ping->Length ());
+
+    originatorEndPointStream->Write (frame, length);
+
+    // The parser stops at the bad ETX.
+    parser.Parse ();
+    parser.Parse ();
+
+    REQUIRE (received.size () == 1);
+    REQUIRE (received[0]->Length () == ping->Length ());
+    REQUIRE (memcmp (received[0]->Data (), ping->Data (), ping->Length ()) ==
+             0);
+
+    // Normal frames are still recognised after a compact one.
+    originatorEndPointStream->Write (ping->Data (), ping->Length ());
+
+    parser.Parse ();
+
+    REQUIRE (received.size () == 2);
+
+    // A compact frame failing its CRC is dropped.
+    frame[length - 6] ^= 0x01;
+
+    originatorEndPointStream->Write (frame, length);
+
+    parser.Parse ();
+
+    REQUIRE (received.size () == 2);
+
+    // Transaction ids that need more than three bytes are sent in full.
+    auto late = std::shared_ptr<IdpPacket> (new IdpPacket (7, IdpFlags::None));
+
+    late->Write ((uint16_t) 0xA001);
+    late->Write ((uint32_t) CompactFrame::MaxTransactionId + 1);
+    late->Write ((uint8_t) 0x01);
+    late->Seal ();
+
+    REQUIRE_FALSE (CompactFrame::CanEncode (*late));
+}
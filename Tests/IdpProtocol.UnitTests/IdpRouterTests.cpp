@@ -3,11 +3,17 @@
 // full license information.
 #include <stdint.h>
 
+#include "IdpClientNode.h"
 #include "IdpRouter.h"
 #include "MasterNode.h"
 #include "SimpleAdaptor.h"
 #include "TestRuntime.h"
+#include "TraceRing.h"
 #include "catch.hpp"
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
 
 static const Guid_t TestGuid = Guid_t ("dfda0b6f-7ee4-4906-8b1c-15f455fbb77c");
 
@@ -883,4 +889,1261 @@ TEST_CASE ("Network is reenumerated following collapse")
     masterNode.EnumerateNetwork ();
 
     REQUIRE_FALSE (masterNode.IsEnumerating ());
-}
\ No newline at end of file
+}
+class CountingAdaptor : public SimpleAdaptor
+{
+  public:
+    bool Transmit (std::shared_ptr<IdpPacket> packet)
+    {
+        Sent[packet->Destination ()]++;
+
+        return SimpleAdaptor::Transmit (packet);
+    }
+
+    std::map<uint16_t, uint32_t> Sent;
+};
+
+TEST_CASE ("Routers only poll adaptors that have gone quiet")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+
+    auto& remoteNode1 = *new IdpNode (TestGuid, "Remote.Node.1");
+
+    router.AddNode (masterNode);
+    router2.AddNode (remoteNode1);
+
+    auto& adaptor1 = *new CountingAdaptor ();
+    auto& adaptor2 = *new CountingAdaptor ();
+
+    router.AddAdaptor (adaptor1);
+    router2.AddAdaptor (adaptor2);
+
+    adaptor1.SetRemote (adaptor2);
+    adaptor2.SetRemote (adaptor1);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    for (int i = 0; i < 20; i++)
+    {
+        TestRuntime::IterateRuntime (1000);
+        TestRuntime::IterateRuntime (0, 100);
+    }
+
+    // Router2 pings the master every second, which is proof of life for the
+    // downstream link. The upstream link only ever answers polls, so router2
+    // backs off.
+    REQUIRE (adaptor1.Sent[RouterPollAddress] <= 1);
+    REQUIRE (adaptor2.Sent[RouterPollAddress] < 10);
+    REQUIRE (adaptor1.IsEnumerated ());
+    REQUIRE (adaptor2.IsEnumerated ());
+
+    router2.Enabled (false);
+
+    for (int i = 0; i < 4; i++)
+    {
+        TestRuntime::IterateRuntime (1000);
+        TestRuntime::IterateRuntime (0, 100);
+    }
+
+    REQUIRE_FALSE (adaptor1.IsEnumerated ());
+}
+
+/**
+ * Records when polls are sent across a link.
+ */
+class PollTimingAdaptor : public SimpleAdaptor
+{
+  public:
+    bool Transmit (std::shared_ptr<IdpPacket> packet)
+    {
+        if (packet->Destination () == RouterPollAddress)
+        {
+            Polls.push_back (Application::GetApplicationTime ());
+        }
+
+        return SimpleAdaptor::Transmit (packet);
+    }
+
+    std::vector<uint64_t> Polls;
+};
+
+TEST_CASE ("Routers draw poll jitter once per poll and not in lock step")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router1 = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+    auto& router3 = *new IdpRouter ();
+
+    router1.AddNode (masterNode);
+
+    auto& toRouter2 = *new SimpleAdaptor ();
+    auto& fromRouter1 = *new PollTimingAdaptor ();
+    auto& toRouter3 = *new SimpleAdaptor ();
+    auto& fromRouter1Too = *new PollTimingAdaptor ();
+
+    router1.AddAdaptor (toRouter2);
+    router2.AddAdaptor (fromRouter1);
+    router1.AddAdaptor (toRouter3);
+    router3.AddAdaptor (fromRouter1Too);
+
+    toRouter2.SetRemote (fromRouter1);
+    fromRouter1.SetRemote (toRouter2);
+    toRouter3.SetRemote (fromRouter1Too);
+    fromRouter1Too.SetRemote (toRouter3);
+
+    router2.PollIdleInterval (4000);
+    router2.PollMaxInterval (16000);
+    router3.PollIdleInterval (4000);
+    router3.PollMaxInterval (16000);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    for (int i = 0; i < 300; i++)
+    {
+        TestRuntime::IterateRuntime (1000);
+        TestRuntime::IterateRuntime (0, 100);
+    }
+
+    // The upstream links only ever answer polls, so both back off to the
+    // longest interval. Each gap there is the interval less its own jitter,
+    // so they vary but never fall below three quarters of it.
+    std::set<uint64_t> gaps;
+
+    for (auto polls : {&fromRouter1.Polls, &fromRouter1Too.Polls})
+    {
+        REQUIRE (polls->size () > 10);
+
+        for (size_t i = polls->size () - 10; i < polls->size (); i++)
+        {
+            auto gap = (*polls)[i] - (*polls)[i - 1];
+
+            REQUIRE (gap >= 12000);
+            REQUIRE (gap <= 17000);
+
+            gaps.insert (gap);
+        }
+    }
+
+    REQUIRE (gaps.size () > 1);
+
+    // Routers at different addresses draw different jitter.
+    REQUIRE (fromRouter1.Polls != fromRouter1Too.Polls);
+}
+
+TEST_CASE ("QueryInterface is only forwarded towards group members")
+{
+    TestRuntime::Initialise ();
+
+    const Guid_t serverGuid = Guid_t ("0b6e8f2c-39d4-4a8e-9c61-7f2d3a5b1e90");
+    const Guid_t clientGuid = Guid_t ("5c1a9e77-02b3-4f6d-8e4a-d3b2c1a0f987");
+
+    auto group = IdpNode::InterfaceGroupAddress (serverGuid);
+
+    REQUIRE (IdpNode::InterfaceGroupAddress (RouterGuid) != group);
+    REQUIRE (IdpNode::InterfaceGroupAddress (TestGuid) != group);
+
+    auto& masterNode = *new MasterNode ();
+    auto& router1 = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+    auto& router3 = *new IdpRouter ();
+
+    auto& client = *new IdpClientNode (serverGuid, clientGuid, "Client");
+    auto& server = *new IdpServerNode (serverGuid, "Server");
+    auto& bystander = *new IdpNode (TestGuid, "Bystander");
+
+    router1.AddNode (masterNode);
+    router1.AddNode (client);
+    router2.AddNode (server);
+    router3.AddNode (bystander);
+
+    auto& adaptor1 = *new CountingAdaptor ();
+    auto& adaptor2 = *new CountingAdaptor ();
+    auto& adaptor3 = *new CountingAdaptor ();
+    auto& adaptor4 = *new CountingAdaptor ();
+
+    router1.AddAdaptor (adaptor1);
+    router2.AddAdaptor (adaptor2);
+    router1.AddAdaptor (adaptor3);
+    router3.AddAdaptor (adaptor4);
+
+    adaptor1.SetRemote (adaptor2);
+    adaptor2.SetRemote (adaptor1);
+    adaptor3.SetRemote (adaptor4);
+    adaptor4.SetRemote (adaptor3);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+    REQUIRE (adaptor1.Groups () & MulticastGroupMask (group));
+    REQUIRE_FALSE (adaptor3.Groups () & MulticastGroupMask (group));
+
+    bool connected = false;
+
+    client.Connected += [&](auto sender, auto& e) { connected = true; };
+
+    client.Connect ();
+
+    REQUIRE (connected);
+    REQUIRE (adaptor1.Sent[group] == 1);
+    REQUIRE (adaptor3.Sent[group] == 0);
+}
+
+TEST_CASE ("Routers stop forwarding a group once its members leave")
+{
+    TestRuntime::Initialise ();
+
+    const uint16_t group = MulticastAddressBase + 5;
+
+    auto& masterNode = *new MasterNode ();
+    auto& router1 = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+    auto& router3 = *new IdpRouter ();
+
+    auto& nearMember = *new IdpNode (TestGuid, "Near.Member");
+    auto& farMember = *new IdpNode (TestGuid, "Far.Member");
+
+    router1.AddNode (masterNode);
+    router2.AddNode (nearMember);
+    router3.AddNode (farMember);
+
+    auto& adaptor1 = *new CountingAdaptor ();
+    auto& adaptor2 = *new CountingAdaptor ();
+    auto& adaptor3 = *new CountingAdaptor ();
+    auto& adaptor4 = *new CountingAdaptor ();
+
+    router1.AddAdaptor (adaptor1);
+    router2.AddAdaptor (adaptor2);
+    router2.AddAdaptor (adaptor3);
+    router3.AddAdaptor (adaptor4);
+
+    adaptor1.SetRemote (adaptor2);
+    adaptor2.SetRemote (adaptor1);
+    adaptor3.SetRemote (adaptor4);
+    adaptor4.SetRemote (adaptor3);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    nearMember.JoinGroup (group);
+    farMember.JoinGroup (group);
+
+    REQUIRE (adaptor1.Groups () & MulticastGroupMask (group));
+    REQUIRE (adaptor3.Groups () & MulticastGroupMask (group));
+
+    // Router1 still has a member behind router2.
+    farMember.LeaveGroup (group);
+
+    REQUIRE (adaptor1.Groups () & MulticastGroupMask (group));
+    REQUIRE_FALSE (adaptor3.Groups () & MulticastGroupMask (group));
+
+    nearMember.LeaveGroup (group);
+
+    REQUIRE_FALSE (adaptor1.Groups () & MulticastGroupMask (group));
+
+    masterNode.SendRequest (
+        group, OutgoingTransaction::Create (
+                   static_cast<uint16_t> (NodeCommand::Ping),
+                   masterNode.CreateTransactionId (), IdpCommandFlags::None));
+
+    REQUIRE (adaptor1.Sent[group] == 0);
+    REQUIRE (adaptor3.Sent[group] == 0);
+
+    // Members that go away without leaving are dropped on the next tick.
+    farMember.JoinGroup (group);
+
+    REQUIRE (adaptor1.Groups () & MulticastGroupMask (group));
+
+    router3.RemoveNode (farMember);
+
+    for (int i = 0; i < 2; i++)
+    {
+        TestRuntime::IterateRuntime (1000);
+        TestRuntime::IterateRuntime (0, 100);
+    }
+
+    REQUIRE_FALSE (adaptor3.Groups () & MulticastGroupMask (group));
+    REQUIRE_FALSE (adaptor1.Groups () & MulticastGroupMask (group));
+}
+
+class GatedAdaptor : public SimpleAdaptor
+{
+  public:
+    GatedAdaptor ()
+    {
+        Hold = false;
+    }
+
+    bool Transmit (std::shared_ptr<IdpPacket> packet)
+    {
+        if (Hold && packet->Destination () == RouterPollAddress)
+        {
+            Held.push_back (packet);
+
+            return true;
+        }
+
+        return SimpleAdaptor::Transmit (packet);
+    }
+
+    void Release ()
+    {
+        Hold = false;
+
+        for (auto& packet : Held)
+        {
+            packet->ResetRead ();
+
+            SimpleAdaptor::Transmit (packet);
+        }
+
+        Held.clear ();
+    }
+
+    bool Hold;
+    std::list<std::shared_ptr<IdpPacket>> Held;
+};
+
+TEST_CASE ("Routers queue traffic until the remote router grants credit")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router1 = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+
+    auto& sender = *new IdpNode (TestGuid, "Sender");
+    auto& receiver = *new IdpNode (TestGuid, "Receiver");
+
+    router1.AddNode (masterNode);
+    router1.AddNode (sender);
+    router2.AddNode (receiver);
+
+    auto& adaptor1 = *new SimpleAdaptor ();
+    auto& adaptor2 = *new GatedAdaptor ();
+
+    router1.AddAdaptor (adaptor1);
+    router2.AddAdaptor (adaptor2);
+
+    adaptor1.SetRemote (adaptor2);
+    adaptor2.SetRemote (adaptor1);
+
+    const uint32_t window = 100;
+
+    adaptor2.Credits ().ReceiveWindow (window);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    TestRuntime::IterateRuntime (1000);
+
+    REQUIRE (adaptor1.Credits ().IsLimited ());
+
+    uint32_t received = 0;
+
+    receiver.Manager ().RegisterCommand (
+        0xB000, [&](std::shared_ptr<IncomingTransaction> incoming,
+                    std::shared_ptr<OutgoingTransaction> outgoing) {
+            received++;
+            return IdpResponseCode::OK;
+        });
+
+    // Credit returned by router2 is held back, so router1 must stop once it
+    // has used the window and queue the rest.
+    adaptor2.Hold = true;
+
+    auto start = adaptor1.Credits ().Transmitted ();
+
+    for (int i = 0; i < 20; i++)
+    {
+        sender.SendRequest (receiver.Address (),
+                            OutgoingTransaction::Create (
+                                0xB000, i, IdpCommandFlags::None));
+    }
+
+    REQUIRE (received < 20);
+    REQUIRE (adaptor1.Credits ().Transmitted () - start <= window + 32);
+    REQUIRE (router1.EgressQueueLength (adaptor1.AdaptorId ()) > 0);
+
+    adaptor2.Release ();
+
+    REQUIRE (received == 20);
+    REQUIRE (router1.EgressQueueLength (adaptor1.AdaptorId ()) == 0);
+}
+
+TEST_CASE ("Polls keep the byte counts at both ends of a link in step")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router1 = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+
+    router1.AddNode (masterNode);
+    router2.AddNode (*new IdpNode (TestGuid, "Remote.Node"));
+
+    auto& adaptor1 = *new CountingAdaptor ();
+    auto& adaptor2 = *new CountingAdaptor ();
+
+    router1.AddAdaptor (adaptor1);
+    router2.AddAdaptor (adaptor2);
+
+    adaptor1.SetRemote (adaptor2);
+    adaptor2.SetRemote (adaptor1);
+
+    const uint32_t window = 1000;
+
+    adaptor1.Credits ().ReceiveWindow (window);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    for (int i = 0; i < 10; i++)
+    {
+        TestRuntime::IterateRuntime (1000);
+        TestRuntime::IterateRuntime (0, 100);
+    }
+
+    // Router2 polls router1, which resyncs to the count in each poll.
+    REQUIRE (adaptor2.Sent[RouterPollAddress] > 0);
+    REQUIRE (adaptor1.Credits ().Limit () - window ==
+             adaptor2.Credits ().Transmitted ());
+}
+
+class CreditDroppingAdaptor : public SimpleAdaptor
+{
+  public:
+    CreditDroppingAdaptor ()
+    {
+        DropCredit = false;
+        Polls = 0;
+    }
+
+    bool Transmit (std::shared_ptr<IdpPacket> packet)
+    {
+        auto payload = packet->Payload ();
+
+        // Link credit grants are lost, everything else gets through.
+        if (DropCredit && packet->Destination () == RouterPollAddress &&
+            (uint16_t) (payload[0] << 8 | payload[1]) ==
+                static_cast<uint16_t> (NodeCommand::LinkCredit))
+        {
+            return true;
+        }
+
+        if (packet->Destination () == RouterPollAddress)
+        {
+            Polls++;
+        }
+
+        return SimpleAdaptor::Transmit (packet);
+    }
+
+    bool DropCredit;
+    uint32_t Polls;
+};
+
+TEST_CASE ("Polls are answered on links that have run out of credit")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router1 = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+    auto& sender = *new IdpNode (TestGuid, "Sender");
+
+    router1.AddNode (masterNode);
+    router2.AddNode (sender);
+
+    auto& adaptor1 = *new CreditDroppingAdaptor ();
+    auto& adaptor2 = *new SimpleAdaptor ();
+
+    router1.AddAdaptor (adaptor1);
+    router2.AddAdaptor (adaptor2);
+
+    adaptor1.SetRemote (adaptor2);
+    adaptor2.SetRemote (adaptor1);
+
+    adaptor1.Credits ().ReceiveWindow (100);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    TestRuntime::IterateRuntime (1000);
+
+    REQUIRE (adaptor2.Credits ().IsLimited ());
+
+    // Only router1 polls, so router2 is never granted more credit.
+    adaptor1.DropCredit = true;
+    router2.PollIdleInterval (60000);
+    router2.PollMaxInterval (60000);
+
+    for (int i = 0; i < 50; i++)
+    {
+        sender.SendRequest (1, OutgoingTransaction::Create (
+                                   0xB000, i, IdpCommandFlags::None));
+    }
+
+    REQUIRE (router2.EgressQueueLength (adaptor2.AdaptorId ()) > 0);
+
+    auto polls = adaptor1.Polls;
+
+    // Long enough for router1 to poll twice, before the master gives up on
+    // the nodes whose pings are stuck behind the data.
+    for (uint32_t i = 0; i < 4000; i += IdpScheduler::Resolution)
+    {
+        TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+    }
+
+    REQUIRE (adaptor1.IsEnumerated ());
+    REQUIRE (adaptor1.Polls >= polls + 2);
+    REQUIRE (router2.EgressQueueLength (adaptor2.AdaptorId ()) > 0);
+}
+
+TEST_CASE ("Requests can be awaited as tasks")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router = *new IdpRouter ();
+
+    auto& childNode1 = *new IdpNode (TestGuid, "Child.Node.1");
+    auto& childNode2 = *new IdpNode (TestGuid, "Child.Node.2");
+    auto& childNode3 = *new IdpNode (TestGuid, "Child.Node.3");
+
+    router.AddNode (masterNode);
+    router.AddNode (childNode1);
+    router.AddNode (childNode2);
+    router.AddNode (childNode3);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    std::vector<std::shared_ptr<IdpRequestTask>> pings;
+
+    for (auto node : { &childNode1, &childNode2, &childNode3 })
+    {
+        pings.push_back (masterNode.SendRequestAsync (
+            node->Address (),
+            OutgoingTransaction::Create (
+                static_cast<uint16_t> (NodeCommand::Ping),
+                masterNode.CreateTransactionId ())));
+    }
+
+    bool allResponded = false;
+
+    IdpRequestTask::WhenAll (pings)->Then (
+        [&](std::shared_ptr<IdpRequestTask> task) {
+            allResponded = task->IsSuccess ();
+        });
+
+    REQUIRE (allResponded);
+    REQUIRE (pings[0]->Response ()->ResponseCode () == IdpResponseCode::OK);
+
+    // A request that is never answered completes once it times out.
+    childNode3.Enabled (false);
+
+    auto unanswered = masterNode.SendRequestAsync (
+        childNode3.Address (),
+        OutgoingTransaction::Create (static_cast<uint16_t> (NodeCommand::Ping),
+                                     masterNode.CreateTransactionId ()),
+        100);
+
+    bool timedOut = false;
+
+    unanswered->Then ([&](std::shared_ptr<IdpRequestTask> task) {
+        timedOut = !task->IsSuccess () && task->Response () == nullptr;
+    });
+
+    REQUIRE_FALSE (unanswered->IsCompleted ());
+
+    TestRuntime::IterateRuntime (200);
+
+    REQUIRE (timedOut);
+
+    // A response arriving after the timeout leaves the task as it was.
+    auto late = std::make_shared<IdpResponse> (
+        std::make_shared<IncomingTransaction> (
+            OutgoingTransaction::CreateResponse (1, 0xB000)->ToPacket (2, 1)));
+
+    unanswered->Complete (late);
+
+    REQUIRE_FALSE (unanswered->IsSuccess ());
+    REQUIRE (unanswered->Response () == nullptr);
+}
+
+TEST_CASE ("Batched commands are dispatched and answered in one response")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router = *new IdpRouter ();
+    auto& childNode = *new IdpNode (TestGuid, "Child.Node");
+
+    router.AddNode (masterNode);
+    router.AddNode (childNode);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    uint32_t written = 0;
+
+    childNode.Manager ().RegisterCommand (
+        0xB000, [&](std::shared_ptr<IncomingTransaction> incoming,
+                    std::shared_ptr<OutgoingTransaction> outgoing) {
+            written += incoming->Read<uint32_t> ();
+            outgoing->Write (written);
+
+            return IdpResponseCode::OK;
+        });
+
+    auto batch = OutgoingTransaction::Create (
+        static_cast<uint16_t> (NodeCommand::Batch),
+        masterNode.CreateTransactionId ());
+
+    std::vector<uint32_t> results;
+
+    for (uint32_t value : { 1, 2, 3 })
+    {
+        auto request = OutgoingTransaction::Create (
+                           0xB000, masterNode.CreateTransactionId ())
+                           ->Write (value);
+
+        masterNode.Manager ().RegisterOneTimeResponseHandler (
+            request->TransactionId (),
+            [&](std::shared_ptr<IdpResponse> response) {
+                REQUIRE (response != nullptr);
+                REQUIRE (response->ResponseCode () == IdpResponseCode::OK);
+
+                results.push_back (
+                    response->Transaction ()->Read<uint32_t> ());
+            });
+
+        batch->WriteTransaction (request);
+    }
+
+    // One-way commands in a batch get no response.
+    batch->WriteTransaction (
+        OutgoingTransaction::Create (0xB000, masterNode.CreateTransactionId (),
+                                     IdpCommandFlags::None)
+            ->Write ((uint32_t) 10));
+
+    IdpResponseCode unknownCode = IdpResponseCode::OK;
+
+    auto unknown = OutgoingTransaction::Create (
+        0xB0FF, masterNode.CreateTransactionId ());
+
+    masterNode.Manager ().RegisterOneTimeResponseHandler (
+        unknown->TransactionId (), [&](std::shared_ptr<IdpResponse> response) {
+            unknownCode = response->ResponseCode ();
+        });
+
+    batch->WriteTransaction (unknown);
+
+    bool batchAnswered = false;
+
+    masterNode.SendRequest (childNode.Address (), batch,
+                            [&](std::shared_ptr<IdpResponse> response) {
+                                batchAnswered =
+                                    response != nullptr &&
+                                    response->ResponseCode () ==
+                                        IdpResponseCode::OK;
+                            });
+
+    REQUIRE (batchAnswered);
+    REQUIRE (written == 16);
+    REQUIRE (results == std::vector<uint32_t> ({ 1, 3, 6 }));
+    REQUIRE (unknownCode == IdpResponseCode::UnknownCommand);
+}
+
+TEST_CASE ("Requests are retransmitted with round trip time based timeouts")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router = *new IdpRouter ();
+    auto& childNode = *new IdpNode (TestGuid, "Child.Node");
+
+    router.AddNode (masterNode);
+    router.AddNode (childNode);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    masterNode.MaxRetransmissions (2);
+
+    auto advance = [](uint32_t timeMs) {
+        for (uint32_t i = 0; i < timeMs; i += IdpScheduler::Resolution)
+        {
+            TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+        }
+    };
+
+    auto ping = [&](bool& responded) {
+        responded = false;
+
+        masterNode.SendRequest (
+            childNode.Address (),
+            OutgoingTransaction::Create (
+                static_cast<uint16_t> (NodeCommand::Ping),
+                masterNode.CreateTransactionId ()),
+            [&](std::shared_ptr<IdpResponse> response) {
+                responded = response != nullptr &&
+                            response->ResponseCode () == IdpResponseCode::OK;
+            });
+    };
+
+    bool responded = false;
+
+    ping (responded);
+
+    REQUIRE (responded);
+
+    auto statistics =
+        masterNode.RoundTripTimes ().Statistics (childNode.Address ());
+
+    REQUIRE (statistics != nullptr);
+    REQUIRE (statistics->Samples == 1);
+    REQUIRE (statistics->RetransmitTimeout == RttEstimator::MinTimeout);
+
+    // The first transmission is lost, the retransmission gets through long
+    // before the fixed timeout would have expired.
+    childNode.Enabled (false);
+
+    ping (responded);
+
+    advance (RttEstimator::MinTimeout / 2);
+    childNode.Enabled (true);
+
+    REQUIRE_FALSE (responded);
+
+    advance (RttEstimator::MinTimeout);
+
+    REQUIRE (responded);
+    REQUIRE (statistics->Retransmissions == 1);
+    REQUIRE (statistics->Samples == 1);
+
+    // Each retransmission waits twice as long before giving up.
+    childNode.Enabled (false);
+
+    bool completed = false;
+
+    masterNode.SendRequest (
+        childNode.Address (),
+        OutgoingTransaction::Create (static_cast<uint16_t> (NodeCommand::Ping),
+                                     masterNode.CreateTransactionId ()),
+        [&](std::shared_ptr<IdpResponse> response) {
+            completed = response == nullptr;
+        });
+
+    advance (RttEstimator::MinTimeout * 6);
+
+    REQUIRE_FALSE (completed);
+    REQUIRE (statistics->Retransmissions == 3);
+
+    advance (RttEstimator::MinTimeout * 2);
+
+    REQUIRE (completed);
+}
+
+TEST_CASE ("Forwarding is not held up by commands running on worker threads")
+{
+    TestRuntime::Initialise ();
+
+    const uint32_t handlerMs = 25;
+    const uint32_t heavyRequests = 4;
+
+    auto& masterNode = *new MasterNode ();
+    auto& router = *new IdpRouter ();
+    auto& workerNode = *new IdpNode (TestGuid, "Worker.Node");
+    auto& childNode = *new IdpNode (TestGuid, "Child.Node");
+
+    router.AddNode (masterNode);
+    router.AddNode (workerNode);
+    router.AddNode (childNode);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    auto pool = new WorkerPool (2, 8);
+
+    workerNode.RegisterWorkerCommand (
+        0xB030,
+        [&](std::shared_ptr<IncomingTransaction> incoming,
+            std::shared_ptr<OutgoingTransaction> outgoing) {
+            std::this_thread::sleep_for (
+                std::chrono::milliseconds (handlerMs));
+
+            outgoing->Write ((uint8_t) 0x5A);
+
+            return IdpResponseCode::OK;
+        },
+        *pool);
+
+    uint32_t answered = 0;
+
+    for (uint32_t i = 0; i < heavyRequests; i++)
+    {
+        masterNode.SendRequest (
+            workerNode.Address (),
+            OutgoingTransaction::Create (0xB030,
+                                         masterNode.CreateTransactionId ()),
+            [&](std::shared_ptr<IdpResponse> response) {
+                if (response != nullptr &&
+                    response->ResponseCode () == IdpResponseCode::OK &&
+                    response->Transaction ()->Read<uint8_t> () == 0x5A)
+                {
+                    answered++;
+                }
+            });
+    }
+
+    // Pings through the router are answered while every worker is busy.
+    uint64_t slowestPingUs = 0;
+
+    for (int i = 0; i < 10; i++)
+    {
+        bool responded = false;
+
+        auto begin = std::chrono::steady_clock::now ();
+
+        masterNode.SendRequest (
+            childNode.Address (),
+            OutgoingTransaction::Create (
+                static_cast<uint16_t> (NodeCommand::Ping),
+                masterNode.CreateTransactionId ()),
+            [&](std::shared_ptr<IdpResponse> response) {
+                responded = response != nullptr;
+            });
+
+        uint64_t elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds> (
+                std::chrono::steady_clock::now () - begin)
+                .count ();
+
+        REQUIRE (responded);
+
+        slowestPingUs = std::max (slowestPingUs, elapsed);
+    }
+
+    REQUIRE (slowestPingUs < handlerMs * 1000 / 2);
+    REQUIRE (answered == 0);
+
+    for (int i = 0; i < 200 && answered < heavyRequests; i++)
+    {
+        std::this_thread::sleep_for (std::chrono::milliseconds (2));
+
+        TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+    }
+
+    REQUIRE (answered == heavyRequests);
+
+    auto metrics = pool->Metrics ();
+
+    REQUIRE (metrics.Completed == heavyRequests);
+    REQUIRE (metrics.PeakQueueDepth >= 1);
+    REQUIRE (metrics.QueueDepth == 0);
+    REQUIRE (metrics.Running == 0);
+    REQUIRE (metrics.MaxExecutionUs >= handlerMs * 1000);
+
+    delete pool;
+}
+
+class FragmentingAdaptor : public SimpleAdaptor
+{
+  public:
+    FragmentingAdaptor ()
+    {
+        Longest = 0;
+        Hold = false;
+    }
+
+    bool Transmit (std::shared_ptr<IdpPacket> packet)
+    {
+        if (packet->Length () > Longest)
+        {
+            Longest = packet->Length ();
+        }
+
+        if (Hold && ((uint8_t) packet->Flags () & (uint8_t) IdpFlags::Fragment))
+        {
+            Held.push_back (packet);
+
+            return true;
+        }
+
+        return SimpleAdaptor::Transmit (packet);
+    }
+
+    /**
+     * Delivers the held fragments last first, optionally losing one.
+     */
+    void Release (bool dropFirst = false)
+    {
+        Hold = false;
+
+        for (auto it = Held.rbegin (); it != Held.rend (); it++)
+        {
+            if (dropFirst && it == Held.rend () - 1)
+            {
+                continue;
+            }
+
+            SimpleAdaptor::Transmit (*it);
+        }
+
+        Held.clear ();
+    }
+
+    uint32_t Longest;
+    bool Hold;
+    std::vector<std::shared_ptr<IdpPacket>> Held;
+};
+
+TEST_CASE ("Packets longer than the link MTU are fragmented and reassembled")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router1 = *new IdpRouter ();
+    auto& router2 = *new IdpRouter ();
+    auto& remoteNode = *new IdpNode (TestGuid, "Remote.Node");
+
+    router1.AddNode (masterNode);
+    router2.AddNode (remoteNode);
+
+    auto& adaptor1 = *new FragmentingAdaptor ();
+    auto& adaptor2 = *new FragmentingAdaptor ();
+
+    adaptor1.Mtu (64);
+    adaptor2.Mtu (64);
+
+    router1.AddAdaptor (adaptor1);
+    router2.AddAdaptor (adaptor2);
+
+    adaptor1.SetRemote (adaptor2);
+    adaptor2.SetRemote (adaptor1);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    uint8_t block[2000];
+
+    for (uint32_t i = 0; i < sizeof (block); i++)
+    {
+        block[i] = (uint8_t) (i * 7);
+    }
+
+    remoteNode.Manager ().RegisterCommand (
+        0xB043, [&](std::shared_ptr<IncomingTransaction> incoming,
+                    std::shared_ptr<OutgoingTransaction> outgoing) {
+            auto data = incoming->ConsumeSpan (incoming->BytesRemaining ());
+
+            outgoing->Write ((void*) data.Data (), data.Count ());
+
+            return IdpResponseCode::OK;
+        });
+
+    auto echo = [&](bool& echoed) {
+        echoed = false;
+
+        masterNode.SendRequest (
+            remoteNode.Address (),
+            OutgoingTransaction::Create (0xB043,
+                                         masterNode.CreateTransactionId ())
+                ->Write (block, sizeof (block)),
+            [&](std::shared_ptr<IdpResponse> response) {
+                echoed =
+                    response != nullptr &&
+                    response->ResponseCode () == IdpResponseCode::OK &&
+                    response->Transaction ()->BytesRemaining () ==
+                        sizeof (block) &&
+                    memcmp (response->Transaction ()
+                                ->ConsumeSpan (sizeof (block))
+                                .Data (),
+                            block, sizeof (block)) == 0;
+            });
+    };
+
+    bool echoed = false;
+
+    echo (echoed);
+
+    REQUIRE (echoed);
+    REQUIRE (adaptor1.Longest <= 64);
+    REQUIRE (adaptor2.Longest <= 64);
+
+    // Fragments arriving in reverse order are placed by their offset.
+    adaptor1.Hold = true;
+
+    echo (echoed);
+
+    REQUIRE_FALSE (echoed);
+    REQUIRE (adaptor1.Held.size () > 1);
+
+    adaptor1.Release ();
+
+    REQUIRE (echoed);
+    REQUIRE (adaptor2.Reassembler ().Pending () == 0);
+
+    // A packet that loses a fragment is discarded once it times out.
+    adaptor1.Hold = true;
+
+    echo (echoed);
+
+    adaptor1.Release (true);
+
+    REQUIRE_FALSE (echoed);
+    REQUIRE (adaptor2.Reassembler ().Pending () == 1);
+
+    for (uint32_t i = 0; i < PacketReassembler::DefaultTimeout * 2;
+         i += IdpScheduler::Resolution)
+    {
+        TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+    }
+
+    REQUIRE_FALSE (echoed);
+    REQUIRE (adaptor2.Reassembler ().Pending () == 0);
+    REQUIRE (adaptor2.Reassembler ().Expired () == 1);
+}
+
+static std::shared_ptr<IdpPacket> CreateFragment (uint32_t total,
+                                                  uint32_t offset,
+                                                  uint32_t length)
+{
+    auto fragment = std::shared_ptr<IdpPacket> (
+        new IdpPacket (PacketFragmenter::HeaderLength + length,
+                       IdpFlags::Fragment, 2, 1));
+
+    fragment->Write ((uint16_t) 7);
+    fragment->Write ((uint8_t) IdpFlags::None);
+    fragment->Write (total);
+    fragment->Write (offset);
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        fragment->Write ((uint8_t) (offset + i));
+    }
+
+    fragment->Seal ();
+
+    return fragment;
+}
+
+TEST_CASE ("Overlapping fragments do not complete a packet")
+{
+    TestRuntime::Initialise ();
+
+    PacketReassembler reassembler;
+
+    REQUIRE (reassembler.Add (CreateFragment (200, 0, 100)) == nullptr);
+
+    // Together these add up to the packet's length, but leave a gap.
+    REQUIRE (reassembler.Add (CreateFragment (200, 50, 100)) == nullptr);
+    REQUIRE (reassembler.Add (CreateFragment (200, 0, 100)) == nullptr);
+    REQUIRE (reassembler.Pending () == 1);
+
+    auto packet = reassembler.Add (CreateFragment (200, 100, 100));
+
+    REQUIRE (packet != nullptr);
+    REQUIRE (packet->PayloadLength () == 200);
+
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        REQUIRE (packet->Payload ()[i] == (uint8_t) i);
+    }
+
+    REQUIRE (reassembler.Pending () == 0);
+}
+
+class RecordingTraceSink : public ITraceSink
+{
+  public:
+    void Write (const TransactionSpan& span)
+    {
+        Spans.push_back (span);
+    }
+
+    std::vector<TransactionSpan> Spans;
+};
+
+TEST_CASE ("Requests are traced from the first send until they complete")
+{
+    TestRuntime::Initialise ();
+
+    auto& masterNode = *new MasterNode ();
+    auto& router = *new IdpRouter ();
+    auto& childNode = *new IdpNode (TestGuid, "Child.Node");
+
+    router.AddNode (masterNode);
+    router.AddNode (childNode);
+
+    TraceRing ring;
+    RecordingTraceSink sink;
+
+    masterNode.EnableTracing (ring);
+
+    masterNode.EnumerateNetwork ();
+
+    REQUIRE_FALSE (masterNode.IsEnumerating ());
+
+    // Enumeration requests are traced like any other.
+    REQUIRE (ring.Drain (sink) > 0);
+
+    auto ping = [&]() {
+        masterNode.SendRequest (
+            childNode.Address (),
+            OutgoingTransaction::Create (
+                static_cast<uint16_t> (NodeCommand::Ping),
+                masterNode.CreateTransactionId ()),
+            [](std::shared_ptr<IdpResponse> response) {});
+    };
+
+    // The master keeps polling the network in the background, so only the
+    // pings sent here are checked.
+    auto drainPings = [&]() {
+        sink.Spans.clear ();
+        ring.Drain (sink);
+
+        std::vector<TransactionSpan> pings;
+
+        for (auto& span : sink.Spans)
+        {
+            if (span.CommandId == static_cast<uint16_t> (NodeCommand::Ping))
+            {
+                pings.push_back (span);
+            }
+        }
+
+        return pings;
+    };
+
+    auto iterate = [](uint32_t timeMs) {
+        for (uint32_t i = 0; i < timeMs; i += IdpScheduler::Resolution)
+        {
+            TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+        }
+    };
+
+    ping ();
+
+    auto spans = drainPings ();
+
+    REQUIRE (spans.size () == 1);
+    REQUIRE (spans[0].Source == masterNode.Address ());
+    REQUIRE (spans[0].Destination == childNode.Address ());
+    REQUIRE (spans[0].ResponseCode == IdpResponseCode::OK);
+    REQUIRE (spans[0].Attempts == 1);
+    REQUIRE_FALSE (spans[0].TimedOut);
+
+    childNode.Enabled (false);
+
+    ping ();
+
+    REQUIRE (drainPings ().size () == 0);
+
+    iterate (IdpCommandManager::DefaultTimeout * 2);
+
+    spans = drainPings ();
+
+    REQUIRE (spans.size () == 1);
+    REQUIRE (spans[0].TimedOut);
+    REQUIRE (spans[0].CompletedAt > spans[0].SentAt);
+
+    // A retransmitted request is a single span.
+    masterNode.MaxRetransmissions (2);
+
+    auto& rtt = masterNode.RoundTripTimes ();
+
+    ping ();
+
+    iterate (rtt.Timeout (childNode.Address (), 0) +
+             IdpScheduler::Resolution * 2);
+
+    childNode.Enabled (true);
+
+    iterate (rtt.Timeout (childNode.Address (), 1) * 2);
+
+    spans = drainPings ();
+
+    REQUIRE (spans.size () == 1);
+    REQUIRE (spans[0].ResponseCode == IdpResponseCode::OK);
+    REQUIRE (spans[0].Attempts > 1);
+
+    masterNode.DisableTracing ();
+}
+
+TEST_CASE ("Trace ring hands spans to another thread without locking")
+{
+    TraceRing ring (64);
+
+    const uint32_t count = 100000;
+
+    std::atomic<bool> done (false);
+    uint32_t received = 0;
+    bool ordered = true;
+
+    class OrderedSink : public ITraceSink
+    {
+      public:
+        OrderedSink (uint32_t& received, bool& ordered)
+            : Received (received), Ordered (ordered), Last (0)
+        {
+        }
+
+        void Write (const TransactionSpan& span)
+        {
+            Ordered = Ordered && span.TransactionId > Last;
+            Last = span.TransactionId;
+            Received++;
+        }
+
+        uint32_t& Received;
+        bool& Ordered;
+        uint32_t Last;
+    };
+
+    std::thread consumer ([&]() {
+        OrderedSink sink (received, ordered);
+
+        while (!done.load ())
+        {
+            ring.Drain (sink);
+        }
+
+        ring.Drain (sink);
+    });
+
+    TransactionSpan span = TransactionSpan ();
+
+    for (uint32_t i = 1; i <= count; i++)
+    {
+        span.TransactionId = i;
+
+        ring.Push (span);
+    }
+
+    done.store (true);
+    consumer.join ();
+
+    REQUIRE (ordered);
+    REQUIRE (received + ring.Dropped () == count);
+}
@@ -0,0 +1,521 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+//
+// Generated by tools/idpgen.py from Sensor.idl. Do not edit.
+#pragma once
+
+#include "IdpNode.h"
+#include "IdpWire.h"
+#include <functional>
+#include <memory>
+#include <stdint.h>
+
+enum class SensorCommand : uint16_t
+{
+    Configure = 0xB100,
+    GetReading = 0xB101,
+    Describe = 0xB102,
+    Blink = 0xB103
+};
+
+struct SensorConfigureRequest
+{
+    uint32_t RateHz = {};
+    uint8_t Channel = {};
+    int16_t Offset = {};
+    float Gain = {};
+    uint16_t Averaging = {};
+    bool Enabled = {};
+
+    static constexpr uint32_t FixedSize = 14;
+    static constexpr uint32_t MinimumSize = 14;
+
+    void WriteTo (OutgoingTransaction& transaction) const
+    {
+        uint8_t buffer[14];
+
+        IdpWire::Store (buffer + 0, RateHz);
+        IdpWire::Store (buffer + 4, Channel);
+        IdpWire::Store (buffer + 5, Offset);
+        IdpWire::Store (buffer + 7, Gain);
+        IdpWire::Store (buffer + 11, Averaging);
+        IdpWire::Store (buffer + 13, Enabled);
+
+        transaction.Write (buffer, sizeof (buffer));
+    }
+
+    bool ReadFrom (IncomingTransaction& transaction)
+    {
+        if (transaction.BytesRemaining () < 14)
+        {
+            return false;
+        }
+
+        {
+            auto buffer = static_cast<const uint8_t*> (
+                transaction.ConsumeData (14));
+
+            RateHz = IdpWire::Load<uint32_t> (buffer + 0);
+            Channel = IdpWire::Load<uint8_t> (buffer + 4);
+            Offset = IdpWire::Load<int16_t> (buffer + 5);
+            Gain = IdpWire::Load<float> (buffer + 7);
+            Averaging = IdpWire::Load<uint16_t> (buffer + 11);
+            Enabled = IdpWire::Load<bool> (buffer + 13);
+        }
+
+        return true;
+    }
+};
+
+struct SensorConfigureResponse
+{
+    static constexpr uint32_t MinimumSize = 0;
+
+    void WriteTo (OutgoingTransaction& transaction) const
+    {
+    }
+
+    bool ReadFrom (IncomingTransaction& transaction)
+    {
+        return true;
+    }
+};
+
+struct SensorGetReadingRequest
+{
+    uint8_t Channel = {};
+
+    static constexpr uint32_t FixedSize = 1;
+    static constexpr uint32_t MinimumSize = 1;
+
+    void WriteTo (OutgoingTransaction& transaction) const
+    {
+        uint8_t buffer[1];
+
+        IdpWire::Store (buffer + 0, Channel);
+
+        transaction.Write (buffer, sizeof (buffer));
+    }
+
+    bool ReadFrom (IncomingTransaction& transaction)
+    {
+        if (transaction.BytesRemaining () < 1)
+        {
+            return false;
+        }
+
+        {
+            auto buffer = static_cast<const uint8_t*> (
+                transaction.ConsumeData (1));
+
+            Channel = IdpWire::Load<uint8_t> (buffer + 0);
+        }
+
+        return true;
+    }
+};
+
+struct SensorGetReadingResponse
+{
+    int32_t Value = {};
+    uint16_t Status = {};
+    uint64_t Timestamp = {};
+
+    static constexpr uint32_t FixedSize = 14;
+    static constexpr uint32_t MinimumSize = 14;
+
+    void WriteTo (OutgoingTransaction& transaction) const
+    {
+        uint8_t buffer[14];
+
+        IdpWire::Store (buffer + 0, Value);
+        IdpWire::Store (buffer + 4, Status);
+        IdpWire::Store (buffer + 6, Timestamp);
+
+        transaction.Write (buffer, sizeof (buffer));
+    }
+
+    bool ReadFrom (IncomingTransaction& transaction)
+    {
+        if (transaction.BytesRemaining () < 14)
+        {
+            return false;
+        }
+
+        {
+            auto buffer = static_cast<const uint8_t*> (
+                transaction.ConsumeData (14));
+
+            Value = IdpWire::Load<int32_t> (buffer + 0);
+            Status = IdpWire::Load<uint16_t> (buffer + 4);
+            Timestamp = IdpWire::Load<uint64_t> (buffer + 6);
+        }
+
+        return true;
+    }
+};
+
+struct SensorDescribeRequest
+{
+    static constexpr uint32_t MinimumSize = 0;
+
+    void WriteTo (OutgoingTransaction& transaction) const
+    {
+    }
+
+    bool ReadFrom (IncomingTransaction& transaction)
+    {
+        return true;
+    }
+};
+
+struct SensorDescribeResponse
+{
+    StringView Name = {};
+    uint32_t Serial = {};
+
+    static constexpr uint32_t MinimumSize = 5;
+
+    void WriteTo (OutgoingTransaction& transaction) const
+    {
+        transaction.Write ((void*) Name.Data (), Name.Length () + 1);
+
+        {
+            uint8_t buffer[4];
+
+            IdpWire::Store (buffer + 0, Serial);
+
+            transaction.Write (buffer, sizeof (buffer));
+        }
+    }
+
+    bool ReadFrom (IncomingTransaction& transaction)
+    {
+        if (!transaction.TryReadStringView (Name))
+        {
+            return false;
+        }
+
+        if (transaction.BytesRemaining () < 4)
+        {
+            return false;
+        }
+
+        {
+            auto buffer = static_cast<const uint8_t*> (
+                transaction.ConsumeData (4));
+
+            Serial = IdpWire::Load<uint32_t> (buffer + 0);
+        }
+
+        return true;
+    }
+};
+
+struct SensorBlinkRequest
+{
+    uint16_t DurationMs = {};
+
+    static constexpr uint32_t FixedSize = 2;
+    static constexpr uint32_t MinimumSize = 2;
+
+    void WriteTo (OutgoingTransaction& transaction) const
+    {
+        uint8_t buffer[2];
+
+        IdpWire::Store (buffer + 0, DurationMs);
+
+        transaction.Write (buffer, sizeof (buffer));
+    }
+
+    bool ReadFrom (IncomingTransaction& transaction)
+    {
+        if (transaction.BytesRemaining () < 2)
+        {
+            return false;
+        }
+
+        {
+            auto buffer = static_cast<const uint8_t*> (
+                transaction.ConsumeData (2));
+
+            DurationMs = IdpWire::Load<uint16_t> (buffer + 0);
+        }
+
+        return true;
+    }
+};
+
+/**
+ *  SensorServer
+ *
+ *  Implement the handlers and call RegisterCommands with the node's
+ *  command manager. Requests that do not deserialize are answered with
+ *  InvalidParameters without calling the handler.
+ */
+class SensorServer
+{
+  public:
+    virtual ~SensorServer ()
+    {
+    }
+
+    virtual IdpResponseCode Configure (const SensorConfigureRequest& request,
+                                       SensorConfigureResponse& response) = 0;
+
+    virtual IdpResponseCode GetReading (const SensorGetReadingRequest& request,
+                                        SensorGetReadingResponse& response) = 0;
+
+    virtual IdpResponseCode Describe (const SensorDescribeRequest& request,
+                                      SensorDescribeResponse& response) = 0;
+
+    virtual void Blink (const SensorBlinkRequest& request) = 0;
+
+    void RegisterCommands (IdpCommandManager& manager)
+    {
+        manager.RegisterCommand (
+            static_cast<uint16_t> (SensorCommand::Configure),
+            [this](std::shared_ptr<IncomingTransaction> incoming,
+                   std::shared_ptr<OutgoingTransaction> outgoing) {
+                SensorConfigureRequest request = {};
+
+                if (!request.ReadFrom (*incoming))
+                {
+                    return IdpResponseCode::InvalidParameters;
+                }
+
+                SensorConfigureResponse response = {};
+
+                auto responseCode = Configure (request, response);
+
+                if (responseCode == IdpResponseCode::OK)
+                {
+                    response.WriteTo (*outgoing);
+                }
+
+                return responseCode;
+            },
+            SensorConfigureResponse::MinimumSize);
+
+        manager.RegisterCommand (
+            static_cast<uint16_t> (SensorCommand::GetReading),
+            [this](std::shared_ptr<IncomingTransaction> incoming,
+                   std::shared_ptr<OutgoingTransaction> outgoing) {
+                SensorGetReadingRequest request = {};
+
+                if (!request.ReadFrom (*incoming))
+                {
+                    return IdpResponseCode::InvalidParameters;
+                }
+
+                SensorGetReadingResponse response = {};
+
+                auto responseCode = GetReading (request, response);
+
+                if (responseCode == IdpResponseCode::OK)
+                {
+                    response.WriteTo (*outgoing);
+                }
+
+                return responseCode;
+            },
+            SensorGetReadingResponse::MinimumSize);
+
+        manager.RegisterCommand (
+            static_cast<uint16_t> (SensorCommand::Describe),
+            [this](std::shared_ptr<IncomingTransaction> incoming,
+                   std::shared_ptr<OutgoingTransaction> outgoing) {
+                SensorDescribeRequest request = {};
+
+                if (!request.ReadFrom (*incoming))
+                {
+                    return IdpResponseCode::InvalidParameters;
+                }
+
+                SensorDescribeResponse response = {};
+
+                auto responseCode = Describe (request, response);
+
+                if (responseCode == IdpResponseCode::OK)
+                {
+                    response.WriteTo (*outgoing);
+                }
+
+                return responseCode;
+            },
+            SensorDescribeResponse::MinimumSize);
+
+        manager.RegisterCommand (
+            static_cast<uint16_t> (SensorCommand::Blink),
+            [this](std::shared_ptr<IncomingTransaction> incoming,
+                   std::shared_ptr<OutgoingTransaction> outgoing) {
+                SensorBlinkRequest request = {};
+
+                if (!request.ReadFrom (*incoming))
+                {
+                    return IdpResponseCode::InvalidParameters;
+                }
+
+                Blink (request);
+
+                return IdpResponseCode::OK;
+            });
+    }
+};
+
+/**
+ *  SensorClient
+ *
+ *  Sends Sensor requests from a node. Response handlers get UnknownError
+ *  if the request times out, and any string views in the response are
+ *  only valid during the handler.
+ */
+class SensorClient
+{
+  public:
+    SensorClient (IdpNode& node, uint16_t address)
+        : _node (node), _address (address)
+    {
+    }
+
+    uint16_t Address ()
+    {
+        return _address;
+    }
+
+    void Address (uint16_t value)
+    {
+        _address = value;
+    }
+
+    typedef std::function<void(IdpResponseCode responseCode,
+                               const SensorConfigureResponse& response)>
+        ConfigureHandler;
+
+    bool Configure (const SensorConfigureRequest& request,
+                    ConfigureHandler handler)
+    {
+        auto transaction = OutgoingTransaction::Create (
+            static_cast<uint16_t> (SensorCommand::Configure),
+            _node.CreateTransactionId (),
+            IdpCommandFlags::ResponseExpected,
+            SensorConfigureRequest::MinimumSize);
+
+        request.WriteTo (*transaction);
+
+        return _node.SendRequest (
+            _address, transaction,
+            [handler](std::shared_ptr<IdpResponse> response) {
+                SensorConfigureResponse result = {};
+
+                if (response == nullptr)
+                {
+                    handler (IdpResponseCode::UnknownError, result);
+                    return;
+                }
+
+                auto responseCode = response->ResponseCode ();
+
+                if (responseCode == IdpResponseCode::OK &&
+                    !result.ReadFrom (*response->Transaction ()))
+                {
+                    responseCode = IdpResponseCode::InvalidParameters;
+                }
+
+                handler (responseCode, result);
+            });
+    }
+
+    typedef std::function<void(IdpResponseCode responseCode,
+                               const SensorGetReadingResponse& response)>
+        GetReadingHandler;
+
+    bool GetReading (const SensorGetReadingRequest& request,
+                     GetReadingHandler handler)
+    {
+        auto transaction = OutgoingTransaction::Create (
+            static_cast<uint16_t> (SensorCommand::GetReading),
+            _node.CreateTransactionId (),
+            IdpCommandFlags::ResponseExpected,
+            SensorGetReadingRequest::MinimumSize);
+
+        request.WriteTo (*transaction);
+
+        return _node.SendRequest (
+            _address, transaction,
+            [handler](std::shared_ptr<IdpResponse> response) {
+                SensorGetReadingResponse result = {};
+
+                if (response == nullptr)
+                {
+                    handler (IdpResponseCode::UnknownError, result);
+                    return;
+                }
+
+                auto responseCode = response->ResponseCode ();
+
+                if (responseCode == IdpResponseCode::OK &&
+                    !result.ReadFrom (*response->Transaction ()))
+                {
+                    responseCode = IdpResponseCode::InvalidParameters;
+                }
+
+                handler (responseCode, result);
+            });
+    }
+
+    typedef std::function<void(IdpResponseCode responseCode,
+                               const SensorDescribeResponse& response)>
+        DescribeHandler;
+
+    bool Describe (const SensorDescribeRequest& request,
+                   DescribeHandler handler)
+    {
+        auto transaction = OutgoingTransaction::Create (
+            static_cast<uint16_t> (SensorCommand::Describe),
+            _node.CreateTransactionId (),
+            IdpCommandFlags::ResponseExpected,
+            SensorDescribeRequest::MinimumSize);
+
+        request.WriteTo (*transaction);
+
+        return _node.SendRequest (
+            _address, transaction,
+            [handler](std::shared_ptr<IdpResponse> response) {
+                SensorDescribeResponse result = {};
+
+                if (response == nullptr)
+                {
+                    handler (IdpResponseCode::UnknownError, result);
+                    return;
+                }
+
+                auto responseCode = response->ResponseCode ();
+
+                if (responseCode == IdpResponseCode::OK &&
+                    !result.ReadFrom (*response->Transaction ()))
+                {
+                    responseCode = IdpResponseCode::InvalidParameters;
+                }
+
+                handler (responseCode, result);
+            });
+    }
+
+    bool Blink (const SensorBlinkRequest& request)
+    {
+        auto transaction = OutgoingTransaction::Create (
+            static_cast<uint16_t> (SensorCommand::Blink),
+            _node.CreateTransactionId (), IdpCommandFlags::None,
+            SensorBlinkRequest::MinimumSize);
+
+        request.WriteTo (*transaction);
+
+        return _node.SendRequest (_address, transaction);
+    }
+
+  private:
+    IdpNode& _node;
+    uint16_t _address;
+};
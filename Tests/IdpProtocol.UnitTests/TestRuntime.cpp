@@ -4,6 +4,7 @@
 #include "TestRuntime.h"
 #include "Application.h"
 #include "Dispatcher.h"
+#include "IdpScheduler.h"
 #include "Trace.h"
 
 uint64_t TestRuntime::s_systemTime = 0;
@@ -53,6 +54,7 @@ void TestRuntime::Initialise ()
     ResetTime ();
     Dispatcher::DeleteDispatchers ();
     DispatcherTimer::InitialiseTimers (TestRuntime::GetSystemTime);
+    IdpScheduler::Initialise ();
 
     auto& actions = *new DispatcherActions ();
     actions.EnterCriticalSection = [] {};
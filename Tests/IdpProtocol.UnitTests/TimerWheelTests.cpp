@@ -0,0 +1,242 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+
+#include "catch.hpp"
+
+#include "IdpCommandManager.h"
+#include "ScheduledTimer.h"
+#include "TestRuntime.h"
+#include "TimerWheel.h"
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+TEST_CASE ("Timer wheel expires entries once their expiry is reached")
+{
+    TimerWheel wheel;
+
+    const uint64_t start = 1000000;
+    const uint64_t delays[] = { 1,     2,      255,     256,     257,
+                                300,   16383,  16384,   16385,   70000,
+                                1048575, 1048576, 1048577, 3600000 };
+
+    std::map<uint32_t, uint64_t> expiries;
+    std::map<uint32_t, uint64_t> fired;
+
+    uint32_t id = 0;
+
+    for (auto delay : delays)
+    {
+        wheel.Schedule (start, start + delay, id);
+        expiries[id] = start + delay;
+        id++;
+    }
+
+    REQUIRE (wheel.Count () == id);
+
+    auto cancelled = wheel.Schedule (start, start + 500, id);
+    wheel.Cancel (cancelled);
+
+    REQUIRE (wheel.Count () == id);
+
+    uint64_t now = start;
+    uint64_t previous = start;
+
+    // Uneven steps exercise both fine and coarse advances.
+    uint64_t step = 1;
+
+    while (wheel.Count () != 0)
+    {
+        now += step;
+        step = step * 7 % 1013 + 1;
+
+        wheel.Advance (now, [&](uint32_t expired) {
+            REQUIRE (fired.find (expired) == fired.end ());
+            REQUIRE (expiries[expired] > previous);
+            REQUIRE (expiries[expired] <= now);
+
+            fired[expired] = now;
+        });
+
+        previous = now;
+    }
+
+    REQUIRE (fired.size () == expiries.size ());
+}
+
+TEST_CASE ("Timer wheel allows entries to be scheduled while expiring")
+{
+    TimerWheel wheel;
+
+    uint32_t expired = 0;
+
+    wheel.Schedule (0, 10, 1);
+
+    wheel.Advance (10, [&](uint32_t id) {
+        expired++;
+
+        if (id < 5)
+        {
+            wheel.Schedule (10, 10, id + 1);
+        }
+    });
+
+    REQUIRE (expired == 1);
+
+    for (uint64_t now = 11; now < 20; now++)
+    {
+        wheel.Advance (now, [&](uint32_t id) {
+            expired++;
+
+            if (id < 5)
+            {
+                wheel.Schedule (now, now + 1, id + 1);
+            }
+        });
+    }
+
+    REQUIRE (expired == 5);
+    REQUIRE (wheel.Count () == 0);
+}
+
+TEST_CASE ("Scheduled timers share one scheduler")
+{
+    TestRuntime::Initialise ();
+
+    const uint32_t timerCount = 500;
+
+    uint32_t ticks = 0;
+    std::vector<ScheduledTimer*> timers;
+
+    for (uint32_t i = 0; i < timerCount; i++)
+    {
+        timers.push_back (new ScheduledTimer (1000, [&] { ticks++; }));
+        timers.back ()->Start ();
+    }
+
+    REQUIRE (IdpScheduler::Instance ().Pending () == timerCount);
+
+    // Deadlines are checked at the scheduler's resolution.
+    TestRuntime::IterateRuntime (1000 - IdpScheduler::Resolution);
+
+    REQUIRE (ticks == 0);
+
+    TestRuntime::IterateRuntime (IdpScheduler::Resolution);
+
+    REQUIRE (ticks == timerCount);
+
+    for (uint32_t i = 0; i < timerCount / 2; i++)
+    {
+        delete timers[i];
+    }
+
+    REQUIRE (IdpScheduler::Instance ().Pending () == timerCount / 2);
+
+    TestRuntime::IterateRuntime (1000);
+
+    REQUIRE (ticks == timerCount + timerCount / 2);
+
+    for (uint32_t i = timerCount / 2; i < timerCount; i++)
+    {
+        timers[i]->Stop ();
+    }
+
+    REQUIRE (IdpScheduler::Instance ().Pending () == 0);
+
+    TestRuntime::IterateRuntime (1000);
+
+    REQUIRE (ticks == timerCount + timerCount / 2);
+}
+
+TEST_CASE ("Benchmark timeouts with 10k outstanding transactions",
+           "[.benchmark]")
+{
+    TestRuntime::Initialise ();
+
+    const uint32_t outstanding = 10000;
+    const uint32_t ticks = 1000;
+
+    auto& manager = *new IdpCommandManager ();
+
+    uint32_t timedOut = 0;
+
+    for (uint32_t i = 0; i < outstanding; i++)
+    {
+        // Spread expiries from 10 s to 20 s, all beyond the measured ticks.
+        manager.RegisterOneTimeResponseHandler (
+            i,
+            [&](std::shared_ptr<IdpResponse> response) {
+                if (response == nullptr)
+                {
+                    timedOut++;
+                }
+            },
+            10000 + i);
+    }
+
+    auto begin = std::chrono::steady_clock::now ();
+
+    for (uint32_t i = 0; i < ticks; i++)
+    {
+        TestRuntime::IterateRuntime (10);
+    }
+
+    auto wheelTime = std::chrono::steady_clock::now () - begin;
+
+    REQUIRE (timedOut == 0);
+
+    // The scan every tick used to do, for comparison.
+    struct ScannedTimeout
+    {
+        ResponseHandler handler;
+        uint64_t expiry;
+    };
+
+    std::map<uint32_t, ScannedTimeout> handlers;
+
+    for (uint32_t i = 0; i < outstanding; i++)
+    {
+        auto handlerInfo = ScannedTimeout ();
+        handlerInfo.handler = [&](std::shared_ptr<IdpResponse> response) {
+            timedOut++;
+        };
+        handlerInfo.expiry = 20000 + i;
+        handlers[i] = handlerInfo;
+    }
+
+    begin = std::chrono::steady_clock::now ();
+
+    for (uint32_t i = 0; i < ticks; i++)
+    {
+        uint64_t currentTime = i * 10;
+
+        for (auto it = handlers.begin (); it != handlers.end (); ++it)
+        {
+            auto current = it->second;
+
+            if (current.expiry < currentTime)
+            {
+                current.handler (nullptr);
+            }
+        }
+    }
+
+    auto scanTime = std::chrono::steady_clock::now () - begin;
+
+    printf ("%u ticks with %u outstanding: wheel %lld us, scan %lld us\n", ticks,
+            outstanding,
+            (long long) std::chrono::duration_cast<std::chrono::microseconds> (
+                wheelTime)
+                .count (),
+            (long long) std::chrono::duration_cast<std::chrono::microseconds> (
+                scanTime)
+                .count ());
+
+    TestRuntime::IterateRuntime (20000);
+
+    REQUIRE (timedOut == outstanding);
+
+    delete &manager;
+}
@@ -0,0 +1,143 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "BitConverter.h"
+#include <cstring>
+#include <stdint.h>
+
+/**
+ *  StringView
+ *
+ *  Non-owning view of a null terminated UTF8 string inside a packet buffer.
+ *  It is only valid while the buffer it was read from is alive.
+ */
+class StringView
+{
+  public:
+    StringView () : _data (""), _length (0)
+    {
+    }
+
+    StringView (const char* data, uint32_t length)
+        : _data (data), _length (length)
+    {
+    }
+
+    StringView (const char* data) : _data (data), _length (strlen (data))
+    {
+    }
+
+    /**
+     * The string, including its terminator, so it can be passed on as a C
+     * string.
+     */
+    const char* Data () const
+    {
+        return _data;
+    }
+
+    /**
+     * Length excluding the terminator.
+     */
+    uint32_t Length () const
+    {
+        return _length;
+    }
+
+    bool IsEmpty () const
+    {
+        return _length == 0;
+    }
+
+    bool Equals (const char* value) const
+    {
+        return strlen (value) == _length && memcmp (value, _data, _length) == 0;
+    }
+
+    const char* begin () const
+    {
+        return _data;
+    }
+
+    const char* end () const
+    {
+        return _data + _length;
+    }
+
+  private:
+    const char* _data;
+    uint32_t _length;
+};
+
+/**
+ *  ArrayView
+ *
+ *  Non-owning view of consecutive network order elements inside a packet
+ *  buffer. Elements are unaligned, so they are loaded and byte swapped on
+ *  access rather than referenced. It is only valid while the buffer it was
+ *  read from is alive.
+ */
+template <typename T>
+class ArrayView
+{
+  public:
+    ArrayView () : _data (nullptr), _count (0)
+    {
+    }
+
+    ArrayView (const uint8_t* data, uint32_t count)
+        : _data (data), _count (count)
+    {
+    }
+
+    uint32_t Count () const
+    {
+        return _count;
+    }
+
+    uint32_t SizeInBytes () const
+    {
+        return _count * sizeof (T);
+    }
+
+    /**
+     * The raw, network order, bytes of the elements.
+     */
+    const uint8_t* Data () const
+    {
+        return _data;
+    }
+
+    T operator[] (uint32_t index) const
+    {
+        T result;
+
+        memcpy (&result, _data + index * sizeof (T), sizeof (T));
+
+        if (BitConverter::IsLittleEndian ())
+        {
+            result = BitConverter::SwapEndian (result);
+        }
+
+        return result;
+    }
+
+    /**
+     * Copies the elements out in host order.
+     */
+    void CopyTo (T* destination) const
+    {
+        for (uint32_t i = 0; i < _count; i++)
+        {
+            destination[i] = (*this)[i];
+        }
+    }
+
+  private:
+    const uint8_t* _data;
+    uint32_t _count;
+};
+
+typedef ArrayView<uint8_t> ByteView;
@@ -0,0 +1,200 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "BulkReceiver.h"
+
+BulkReceiver::BulkReceiver (IdpNode& node) : _node (node)
+{
+    _buffer = nullptr;
+    _capacity = 0;
+
+    _isOpen = false;
+    _source = UnassignedAddress;
+    _transferId = 0;
+    _length = 0;
+    _chunkSize = 0;
+    _crc = 0;
+    _status = BulkTransferStatus::InProgress;
+    _cumulative = 0;
+
+    _node.Manager ().RegisterCommand (
+        static_cast<uint16_t> (NodeCommand::BulkOpen),
+        [&](std::shared_ptr<IncomingTransaction> incoming,
+            std::shared_ptr<OutgoingTransaction> outgoing) {
+            return OnOpen (incoming, outgoing);
+        },
+        sizeof (uint32_t));
+
+    _node.Manager ().RegisterCommand (
+        static_cast<uint16_t> (NodeCommand::BulkData),
+        [&](std::shared_ptr<IncomingTransaction> incoming,
+            std::shared_ptr<OutgoingTransaction> outgoing) {
+            OnData (incoming);
+
+            return IdpResponseCode::OK;
+        });
+}
+
+BulkReceiver::~BulkReceiver ()
+{
+}
+
+void BulkReceiver::Receive (uint8_t* buffer, uint32_t capacity,
+                            BulkReceiveCompleted completed)
+{
+    _buffer = buffer;
+    _capacity = capacity;
+    _completed = completed;
+
+    _isOpen = false;
+}
+
+IdpResponseCode
+    BulkReceiver::OnOpen (std::shared_ptr<IncomingTransaction> incoming,
+                          std::shared_ptr<OutgoingTransaction> outgoing)
+{
+    if (incoming->BytesRemaining () < 12)
+    {
+        return IdpResponseCode::InvalidParameters;
+    }
+
+    auto transferId = incoming->Read<uint16_t> ();
+    auto length = incoming->Read<uint32_t> ();
+    auto chunkSize = incoming->Read<uint16_t> ();
+    auto crc = incoming->Read<uint32_t> ();
+
+    if (_buffer == nullptr || length == 0 || length > _capacity ||
+        chunkSize == 0)
+    {
+        return IdpResponseCode::InvalidParameters;
+    }
+
+    bool isResumed = _isOpen && _status == BulkTransferStatus::InProgress &&
+                     _source == incoming->Source () &&
+                     _transferId == transferId && _length == length &&
+                     _chunkSize == chunkSize && _crc == crc;
+
+    if (!isResumed)
+    {
+        _isOpen = true;
+        _source = incoming->Source ();
+        _transferId = transferId;
+        _length = length;
+        _chunkSize = chunkSize;
+        _crc = crc;
+        _status = BulkTransferStatus::InProgress;
+        _cumulative = 0;
+
+        _chunks.assign ((length + chunkSize - 1) / chunkSize, false);
+    }
+
+    outgoing->Write (Received ());
+
+    return IdpResponseCode::OK;
+}
+
+void BulkReceiver::OnData (std::shared_ptr<IncomingTransaction> incoming)
+{
+    if (!_isOpen || incoming->BytesRemaining () < 6 ||
+        incoming->Source () != _source)
+    {
+        return;
+    }
+
+    auto transferId = incoming->Read<uint16_t> ();
+    auto offset = incoming->Read<uint32_t> ();
+    auto data = incoming->ConsumeSpan (incoming->BytesRemaining ());
+
+    if (transferId != _transferId)
+    {
+        return;
+    }
+
+    if (_status == BulkTransferStatus::InProgress)
+    {
+        if (offset % _chunkSize != 0 || offset >= _length ||
+            data.Count () !=
+                (_length - offset < _chunkSize ? _length - offset
+                                               : _chunkSize))
+        {
+            return;
+        }
+
+        auto chunk = offset / _chunkSize;
+
+        if (!_chunks[chunk])
+        {
+            memcpy (_buffer + offset, data.Data (), data.Count ());
+
+            _chunks[chunk] = true;
+
+            while (_cumulative < _chunks.size () && _chunks[_cumulative])
+            {
+                _cumulative++;
+            }
+
+            if (_cumulative == _chunks.size ())
+            {
+                _status = IdpPacket::Crc32 (_buffer, _length) == _crc
+                              ? BulkTransferStatus::Complete
+                              : BulkTransferStatus::CrcMismatch;
+
+                Acknowledge ();
+
+                if (_completed != nullptr)
+                {
+                    _completed (_status, _length);
+                }
+
+                return;
+            }
+        }
+    }
+
+    // Chunks arriving after the verdict are answered with it again, in
+    // case it was lost.
+    Acknowledge ();
+}
+
+void BulkReceiver::Acknowledge ()
+{
+    uint32_t mask = 0;
+
+    for (uint32_t i = 0; i < 32; i++)
+    {
+        auto chunk = _cumulative + 1 + i;
+
+        if (chunk < _chunks.size () && _chunks[chunk])
+        {
+            mask |= 1u << i;
+        }
+    }
+
+    auto ack = OutgoingTransaction::Create (
+        static_cast<uint16_t> (NodeCommand::BulkAck),
+        _node.CreateTransactionId (), IdpCommandFlags::None, 11);
+
+    ack->Write (_transferId)
+        ->Write ((uint8_t) _status)
+        ->Write (Received ())
+        ->Write (mask);
+
+    _node.SendRequest (_source, ack);
+}
+
+uint32_t BulkReceiver::Received ()
+{
+    if (!_isOpen)
+    {
+        return 0;
+    }
+
+    auto received = _cumulative * _chunkSize;
+
+    return received < _length ? received : _length;
+}
+
+BulkTransferStatus BulkReceiver::Status ()
+{
+    return _status;
+}
@@ -0,0 +1,70 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "BulkTransfer.h"
+#include "IdpNode.h"
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+typedef std::function<void(BulkTransferStatus status, uint32_t length)>
+    BulkReceiveCompleted;
+
+/**
+ *  BulkReceiver
+ *
+ *  Receives transfers from a BulkSender into a caller supplied buffer,
+ *  acknowledging every chunk with the length received so far and a mask of
+ *  the chunks that arrived beyond it. The whole block is checked against
+ *  the sender's CRC once it has arrived. A transfer that is reopened with
+ *  the same id, length and CRC carries on from where it stopped. One
+ *  receiver may be used per node.
+ */
+class BulkReceiver
+{
+  public:
+    /**
+     * Instantiates a new instance of BulkReceiver
+     */
+    BulkReceiver (IdpNode& node);
+    ~BulkReceiver ();
+
+    /**
+     * Accepts transfers of up to capacity bytes into buffer. completed is
+     * called each time a transfer has arrived and been checked.
+     */
+    void Receive (uint8_t* buffer, uint32_t capacity,
+                  BulkReceiveCompleted completed);
+
+    /**
+     * Bytes of the current transfer received contiguously.
+     */
+    uint32_t Received ();
+
+    BulkTransferStatus Status ();
+
+  private:
+    IdpResponseCode OnOpen (std::shared_ptr<IncomingTransaction> incoming,
+                            std::shared_ptr<OutgoingTransaction> outgoing);
+    void OnData (std::shared_ptr<IncomingTransaction> incoming);
+    void Acknowledge ();
+
+    IdpNode& _node;
+    BulkReceiveCompleted _completed;
+
+    uint8_t* _buffer;
+    uint32_t _capacity;
+
+    bool _isOpen;
+    uint16_t _source;
+    uint16_t _transferId;
+    uint32_t _length;
+    uint16_t _chunkSize;
+    uint32_t _crc;
+    BulkTransferStatus _status;
+
+    std::vector<bool> _chunks;
+    uint32_t _cumulative;
+};
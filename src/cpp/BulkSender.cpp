@@ -0,0 +1,403 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "BulkSender.h"
+#include "Application.h"
+
+constexpr uint16_t BulkSender::DefaultChunkSize;
+constexpr uint8_t BulkSender::DefaultWindow;
+constexpr uint8_t BulkSender::MaxWindow;
+constexpr uint8_t BulkSender::MaxRetransmissions;
+
+// Transfer id and offset.
+static constexpr uint32_t DataHeaderLength = 6;
+
+BulkSender::BulkSender (IdpNode& node) : _node (node)
+{
+    _destination = UnassignedAddress;
+    _transferId = 0;
+    _data = nullptr;
+    _length = 0;
+    _chunkSize = DefaultChunkSize;
+    _window = DefaultWindow;
+
+    _isSending = false;
+    _isOpen = false;
+    _isFilling = false;
+    _openTransactionId = 0;
+
+    _chunkCount = 0;
+    _base = 0;
+    _next = 0;
+    _sequence = 0;
+    _lastSent = 0;
+    _verdictAttempts = 0;
+
+    _chunksSent = 0;
+    _retransmissions = 0;
+
+    _timer = new ScheduledTimer (IdpScheduler::Resolution,
+                                 [&]() { OnTimerTick (); });
+
+    _node.Manager ().RegisterCommand (
+        static_cast<uint16_t> (NodeCommand::BulkAck),
+        [&](std::shared_ptr<IncomingTransaction> incoming,
+            std::shared_ptr<OutgoingTransaction> outgoing) {
+            OnAcknowledged (incoming);
+
+            return IdpResponseCode::OK;
+        });
+}
+
+BulkSender::~BulkSender ()
+{
+    delete _timer;
+}
+
+bool BulkSender::Send (uint16_t destination, uint16_t transferId,
+                       const uint8_t* data, uint32_t length,
+                       BulkSendCompleted completed)
+{
+    if (_isSending || length == 0)
+    {
+        return false;
+    }
+
+    _destination = destination;
+    _transferId = transferId;
+    _data = data;
+    _length = length;
+    _completed = completed;
+
+    _isSending = true;
+    _isOpen = false;
+    _chunkCount = (length + _chunkSize - 1) / _chunkSize;
+    _base = 0;
+    _next = 0;
+    _verdictAttempts = 0;
+    _chunksSent = 0;
+    _retransmissions = 0;
+
+    auto request = OutgoingTransaction::Create (
+        static_cast<uint16_t> (NodeCommand::BulkOpen),
+        _node.CreateTransactionId (), IdpCommandFlags::ResponseExpected, 12);
+
+    request->Write (transferId)
+        ->Write (length)
+        ->Write (_chunkSize)
+        ->Write (IdpPacket::Crc32 (data, length));
+
+    _openTransactionId = request->TransactionId ();
+
+    if (!_node.SendRequest (destination, request,
+                            [&](std::shared_ptr<IdpResponse> response) {
+                                OnOpened (response);
+                            }))
+    {
+        _isSending = false;
+        _completed = nullptr;
+
+        return false;
+    }
+
+    return true;
+}
+
+void BulkSender::OnOpened (std::shared_ptr<IdpResponse> response)
+{
+    if (!_isSending || _isOpen ||
+        (response != nullptr &&
+         response->Transaction ()->TransactionId () != _openTransactionId))
+    {
+        return;
+    }
+
+    if (response == nullptr ||
+        response->ResponseCode () != IdpResponseCode::OK ||
+        response->Transaction ()->BytesRemaining () < sizeof (uint32_t))
+    {
+        Complete (BulkTransferStatus::Rejected);
+        return;
+    }
+
+    auto resumeFrom = response->Transaction ()->Read<uint32_t> ();
+
+    _isOpen = true;
+    _base = resumeFrom < _length ? resumeFrom / _chunkSize : _chunkCount;
+    _next = _base;
+
+    _timer->Start ();
+
+    if (_base == _chunkCount)
+    {
+        // Everything has arrived already, prompt the receiver for its verdict.
+        SendChunk (_chunkCount - 1);
+        return;
+    }
+
+    Fill ();
+}
+
+void BulkSender::Fill ()
+{
+    // Acknowledgements can arrive while a chunk is being sent, so only the
+    // outermost call sends.
+    if (_isFilling)
+    {
+        return;
+    }
+
+    _isFilling = true;
+
+    while (_isSending && _next < _chunkCount && _next - _base < _window)
+    {
+        _chunks[_next % MaxWindow] = ChunkState ();
+
+        SendChunk (_next++);
+    }
+
+    _isFilling = false;
+}
+
+void BulkSender::SendChunk (uint32_t chunk)
+{
+    auto offset = chunk * _chunkSize;
+    auto length = _length - offset < _chunkSize ? _length - offset : _chunkSize;
+
+    auto& state = _chunks[chunk % MaxWindow];
+    state.Sequence = ++_sequence;
+    state.SentAt = Application::GetApplicationTime ();
+    state.Transmissions++;
+
+    _lastSent = state.SentAt;
+    _chunksSent++;
+
+    auto transaction = OutgoingTransaction::Create (
+        static_cast<uint16_t> (NodeCommand::BulkData),
+        _node.CreateTransactionId (), IdpCommandFlags::None,
+        DataHeaderLength + length);
+
+    transaction->Write (_transferId)
+        ->Write (offset)
+        ->Write ((void*) (_data + offset), length);
+
+    _node.SendRequest (_destination, transaction);
+}
+
+void BulkSender::Retransmit (uint32_t chunk)
+{
+    _retransmissions++;
+
+    _node.RoundTripTimes ().OnRetransmit (_destination);
+
+    SendChunk (chunk);
+}
+
+void BulkSender::Sample (ChunkState& state, uint64_t now)
+{
+    // Only chunks sent once give an unambiguous round trip time.
+    if (!state.Acknowledged && state.Transmissions == 1)
+    {
+        _node.RoundTripTimes ().OnSample (_destination,
+                                          (uint32_t) (now - state.SentAt));
+    }
+
+    state.Acknowledged = true;
+}
+
+void BulkSender::OnAcknowledged (std::shared_ptr<IncomingTransaction> incoming)
+{
+    if (incoming->BytesRemaining () < 11)
+    {
+        return;
+    }
+
+    auto transferId = incoming->Read<uint16_t> ();
+    auto status = (BulkTransferStatus) incoming->Read<uint8_t> ();
+    auto received = incoming->Read<uint32_t> ();
+    auto mask = incoming->Read<uint32_t> ();
+
+    if (!_isOpen || transferId != _transferId ||
+        incoming->Source () != _destination)
+    {
+        return;
+    }
+
+    if (status != BulkTransferStatus::InProgress)
+    {
+        Complete (status);
+        return;
+    }
+
+    auto now = Application::GetApplicationTime ();
+    auto cumulative = (received + _chunkSize - 1) / _chunkSize;
+
+    if (cumulative > _next)
+    {
+        return;
+    }
+
+    while (_base < cumulative)
+    {
+        Sample (_chunks[_base % MaxWindow], now);
+
+        _base++;
+    }
+
+    uint32_t newest = 0;
+
+    for (uint32_t i = 0; i < MaxWindow && (mask >> i) != 0; i++)
+    {
+        auto chunk = cumulative + 1 + i;
+
+        if ((mask & (1u << i)) != 0 && chunk >= _base && chunk < _next)
+        {
+            auto& state = _chunks[chunk % MaxWindow];
+
+            Sample (state, now);
+
+            if (state.Sequence > newest)
+            {
+                newest = state.Sequence;
+            }
+        }
+    }
+
+    // A chunk sent before one that has since arrived has been lost.
+    for (auto chunk = _base; _isSending && chunk < _next; chunk++)
+    {
+        auto& state = _chunks[chunk % MaxWindow];
+
+        if (!state.Acknowledged && state.Sequence < newest)
+        {
+            if (state.Transmissions > MaxRetransmissions)
+            {
+                Complete (BulkTransferStatus::TimedOut);
+                return;
+            }
+
+            Retransmit (chunk);
+        }
+    }
+
+    Fill ();
+}
+
+void BulkSender::OnTimerTick ()
+{
+    if (!_isOpen)
+    {
+        return;
+    }
+
+    auto now = Application::GetApplicationTime ();
+    auto timeout = _node.RoundTripTimes ().Timeout (_destination, 0);
+
+    if (_base == _chunkCount)
+    {
+        // All chunks are acknowledged but the verdict was lost.
+        if (now - _lastSent >= timeout)
+        {
+            if (++_verdictAttempts > MaxRetransmissions)
+            {
+                Complete (BulkTransferStatus::TimedOut);
+                return;
+            }
+
+            SendChunk (_chunkCount - 1);
+        }
+
+        return;
+    }
+
+    for (auto chunk = _base; _isSending && chunk < _next; chunk++)
+    {
+        auto& state = _chunks[chunk % MaxWindow];
+
+        if (!state.Acknowledged &&
+            now - state.SentAt >=
+                _node.RoundTripTimes ().Timeout (_destination,
+                                                 state.Transmissions - 1))
+        {
+            if (state.Transmissions > MaxRetransmissions)
+            {
+                Complete (BulkTransferStatus::TimedOut);
+                return;
+            }
+
+            Retransmit (chunk);
+        }
+    }
+}
+
+void BulkSender::Complete (BulkTransferStatus status)
+{
+    if (!_isSending)
+    {
+        return;
+    }
+
+    _isSending = false;
+    _isOpen = false;
+    _data = nullptr;
+
+    _timer->Stop ();
+
+    auto completed = _completed;
+    _completed = nullptr;
+
+    if (completed != nullptr)
+    {
+        completed (status);
+    }
+}
+
+void BulkSender::Cancel ()
+{
+    Complete (BulkTransferStatus::Cancelled);
+}
+
+bool BulkSender::IsSending ()
+{
+    return _isSending;
+}
+
+uint16_t BulkSender::ChunkSize ()
+{
+    return _chunkSize;
+}
+
+void BulkSender::ChunkSize (uint16_t value)
+{
+    if (value != 0 && !_isSending)
+    {
+        _chunkSize = value;
+    }
+}
+
+uint8_t BulkSender::Window ()
+{
+    return _window;
+}
+
+void BulkSender::Window (uint8_t value)
+{
+    _window = value == 0 ? 1 : value > MaxWindow ? MaxWindow : value;
+}
+
+uint32_t BulkSender::Acknowledged ()
+{
+    auto acknowledged = _base * _chunkSize;
+
+    return acknowledged < _length ? acknowledged : _length;
+}
+
+uint32_t BulkSender::ChunksSent ()
+{
+    return _chunksSent;
+}
+
+uint32_t BulkSender::Retransmissions ()
+{
+    return _retransmissions;
+}
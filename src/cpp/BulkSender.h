@@ -0,0 +1,133 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "BulkTransfer.h"
+#include "IdpNode.h"
+#include "ScheduledTimer.h"
+#include <functional>
+#include <stdint.h>
+
+typedef std::function<void(BulkTransferStatus status)> BulkSendCompleted;
+
+/**
+ *  BulkSender
+ *
+ *  Sends a block of memory to a BulkReceiver, keeping a window of chunks in
+ *  flight rather than waiting for each one to be acknowledged, so throughput
+ *  is bound by the link rather than the round trip time. Chunks are read
+ *  straight from the block, which may be memory mapped flash or a mapped
+ *  file, and must stay valid until the transfer completes.
+ *
+ *  A chunk is retransmitted when a chunk sent after it has been
+ *  acknowledged, or when it is not acknowledged within the node's round trip
+ *  timeout for the receiver. One sender may be used per node.
+ */
+class BulkSender
+{
+  public:
+    static constexpr uint16_t DefaultChunkSize = 256;
+
+    static constexpr uint8_t DefaultWindow = 8;
+
+    /**
+     * The selective mask covers 32 chunks, so no more may be in flight.
+     */
+    static constexpr uint8_t MaxWindow = 32;
+
+    /**
+     * Times a chunk is retransmitted before the transfer is abandoned.
+     */
+    static constexpr uint8_t MaxRetransmissions = 8;
+
+    /**
+     * Instantiates a new instance of BulkSender
+     */
+    BulkSender (IdpNode& node);
+    ~BulkSender ();
+
+    /**
+     * Starts sending length bytes at data to destination. If the receiver
+     * already holds part of the same transfer, sending resumes from there.
+     * Returns false if a transfer is already in progress or the receiver
+     * could not be reached.
+     */
+    bool Send (uint16_t destination, uint16_t transferId, const uint8_t* data,
+               uint32_t length, BulkSendCompleted completed);
+
+    /**
+     * Abandons the transfer. The receiver keeps what it has, so sending the
+     * same block with the same id resumes it.
+     */
+    void Cancel ();
+
+    bool IsSending ();
+
+    uint16_t ChunkSize ();
+    void ChunkSize (uint16_t value);
+
+    /**
+     * Chunks that may be sent ahead of the first unacknowledged one.
+     */
+    uint8_t Window ();
+    void Window (uint8_t value);
+
+    /**
+     * Bytes the receiver has acknowledged contiguously.
+     */
+    uint32_t Acknowledged ();
+
+    /**
+     * Chunks sent in the current transfer, including retransmissions.
+     */
+    uint32_t ChunksSent ();
+
+    uint32_t Retransmissions ();
+
+  private:
+    struct ChunkState
+    {
+        uint32_t Sequence;
+        uint64_t SentAt;
+        uint8_t Transmissions;
+        bool Acknowledged;
+    };
+
+    void OnOpened (std::shared_ptr<IdpResponse> response);
+    void OnAcknowledged (std::shared_ptr<IncomingTransaction> incoming);
+    void OnTimerTick ();
+
+    void Fill ();
+    void SendChunk (uint32_t chunk);
+    void Retransmit (uint32_t chunk);
+    void Sample (ChunkState& state, uint64_t now);
+    void Complete (BulkTransferStatus status);
+
+    IdpNode& _node;
+    ScheduledTimer* _timer;
+    BulkSendCompleted _completed;
+
+    uint16_t _destination;
+    uint16_t _transferId;
+    const uint8_t* _data;
+    uint32_t _length;
+    uint16_t _chunkSize;
+    uint8_t _window;
+
+    bool _isSending;
+    bool _isOpen;
+    bool _isFilling;
+    uint32_t _openTransactionId;
+
+    uint32_t _chunkCount;
+    uint32_t _base;
+    uint32_t _next;
+    uint32_t _sequence;
+    uint64_t _lastSent;
+    uint8_t _verdictAttempts;
+    ChunkState _chunks[MaxWindow];
+
+    uint32_t _chunksSent;
+    uint32_t _retransmissions;
+};
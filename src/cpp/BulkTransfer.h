@@ -0,0 +1,32 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Bulk transfers move a block of memory, such as a firmware image or a log,
+ * from a BulkSender to a BulkReceiver on another node.
+ *
+ *  BulkOpen (request):  transfer id (u16), length (u32), chunk size (u16),
+ *                       CRC-32 of the whole block (u32)
+ *           (response): offset to resume from (u32)
+ *
+ *  BulkData (one way):  transfer id (u16), offset (u32), chunk
+ *
+ *  BulkAck  (one way):  transfer id (u16), status (u8), bytes received
+ *                       contiguously (u32), selective mask (u32)
+ *
+ * Bit n of the selective mask is set when the chunk n + 1 chunks past the
+ * contiguous data has also arrived.
+ */
+enum class BulkTransferStatus : uint8_t
+{
+    InProgress,
+    Complete,
+    CrcMismatch,
+    Rejected,
+    TimedOut,
+    Cancelled
+};
@@ -0,0 +1,175 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "CompactFrame.h"
+#include "IdpWire.h"
+
+constexpr uint32_t CompactFrame::MaxPayloadLength;
+constexpr uint32_t CompactFrame::MaxHeaderLength;
+constexpr uint32_t CompactFrame::MaxFrameLength;
+constexpr uint32_t CompactFrame::MaxTransactionId;
+
+// Command id, transaction id and transaction flags.
+static constexpr uint32_t TransactionHeaderLength = 7;
+
+static bool HasCrc (uint8_t flags)
+{
+    return (flags & (uint8_t) IdpFlags::CRC) == (uint8_t) IdpFlags::CRC;
+}
+
+bool CompactFrame::CanEncode (IdpPacket& packet)
+{
+    auto flags = (uint8_t) packet.Flags ();
+    auto length = packet.PayloadLength ();
+
+    return (flags & ((uint8_t) IdpFlags::RAW | (uint8_t) IdpFlags::Fragment |
+                     (uint8_t) IdpFlags::Compact)) == 0 &&
+           length >= TransactionHeaderLength && length <= MaxPayloadLength &&
+           IdpWire::Load<uint32_t> (packet.Payload () + 2) <= MaxTransactionId;
+}
+
+uint32_t CompactFrame::Encode (IdpPacket& packet, uint8_t* buffer)
+{
+    auto payload = packet.Payload ();
+    auto length = packet.PayloadLength ();
+    auto flags = (uint8_t) packet.Flags ();
+
+    uint8_t transactionId[5];
+    auto transactionIdLength =
+        WriteVarint (IdpWire::Load<uint32_t> (payload + 2), transactionId);
+
+    uint32_t index = 0;
+
+    buffer[index++] = 0x02;
+    buffer[index++] = flags | (uint8_t) IdpFlags::Compact;
+
+    index += WriteVarint (length - sizeof (uint32_t) + transactionIdLength,
+                          buffer + index);
+    index += WriteVarint (packet.Source (), buffer + index);
+    index += WriteVarint (packet.Destination (), buffer + index);
+
+    memcpy (buffer + index, payload, sizeof (uint16_t));
+    index += sizeof (uint16_t);
+
+    memcpy (buffer + index, transactionId, transactionIdLength);
+    index += transactionIdLength;
+
+    memcpy (buffer + index, payload + 6, length - 6);
+    index += length - 6;
+
+    buffer[index++] = 0x03;
+
+    if (HasCrc (flags))
+    {
+        IdpWire::Store (buffer + index, IdpPacket::Crc32 (buffer, index));
+        index += sizeof (uint32_t);
+    }
+
+    return index;
+}
+
+std::shared_ptr<IdpPacket> CompactFrame::Decode (const uint8_t* frame,
+                                                 uint32_t length)
+{
+    auto end = frame + length;
+
+    if (length < 2 || frame[0] != 0x02 ||
+        (frame[1] & (uint8_t) IdpFlags::Compact) == 0)
+    {
+        return nullptr;
+    }
+
+    auto flags = (uint8_t) (frame[1] & ~(uint8_t) IdpFlags::Compact);
+
+    if (HasCrc (flags))
+    {
+        if (length < 6 || IdpWire::Load<uint32_t> (end - 4) !=
+                              IdpPacket::Crc32 (frame, length - 4))
+        {
+            return nullptr;
+        }
+
+        end -= 4;
+    }
+
+    auto data = frame + 2;
+
+    uint32_t payloadLength;
+    uint32_t source;
+    uint32_t destination;
+
+    if (!ReadVarint (data, end, payloadLength) ||
+        !ReadVarint (data, end, source) ||
+        !ReadVarint (data, end, destination) || source > 0xFFFF ||
+        destination > 0xFFFF || (uint32_t) (end - data) != payloadLength + 1 ||
+        end[-1] != 0x03)
+    {
+        return nullptr;
+    }
+
+    auto payloadEnd = end - 1;
+
+    if (payloadEnd - data < 2)
+    {
+        return nullptr;
+    }
+
+    auto command = data;
+    data += sizeof (uint16_t);
+
+    uint32_t transactionId;
+
+    if (!ReadVarint (data, payloadEnd, transactionId) || data >= payloadEnd)
+    {
+        return nullptr;
+    }
+
+    // The transaction flags and whatever follows are copied as they are.
+    auto remainder = (uint32_t) (payloadEnd - data);
+
+    auto result = std::shared_ptr<IdpPacket> (new IdpPacket (
+        sizeof (uint16_t) + sizeof (uint32_t) + remainder, (IdpFlags) flags,
+        (uint16_t) source, (uint16_t) destination));
+
+    result->Write (command, sizeof (uint16_t));
+    result->Write (transactionId);
+    result->Write (data, remainder);
+    result->Seal ();
+
+    return result;
+}
+
+uint32_t CompactFrame::WriteVarint (uint32_t value, uint8_t* buffer)
+{
+    uint32_t length = 0;
+
+    while (value >= 0x80)
+    {
+        buffer[length++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+
+    buffer[length++] = (uint8_t) value;
+
+    return length;
+}
+
+bool CompactFrame::ReadVarint (const uint8_t*& data, const uint8_t* end,
+                               uint32_t& value)
+{
+    value = 0;
+
+    for (uint32_t shift = 0; shift < 35 && data < end; shift += 7)
+    {
+        auto byte = *data++;
+
+        value |= (uint32_t) (byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,72 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "IdpPacket.h"
+#include <memory>
+#include <stdint.h>
+
+/**
+ *  CompactFrame
+ *
+ *  Wire encoding for small packets on slow stream links. The byte after
+ *  STX holds the packet flags with IdpFlags::Compact set, which can never
+ *  be the first byte of a normal frame's length, followed by varints for
+ *  the payload length, source and destination:
+ *
+ *      STX, flags, length, source, destination, payload, ETX, [CRC]
+ *
+ *  The payload starts with the transaction header, where the transaction
+ *  id is also a varint. The CRC covers the compact frame and is checked by
+ *  the receiving link, the packet is expanded and sealed again from there.
+ *  A Ping between addresses below 128 takes 10 bytes instead of 18.
+ */
+class CompactFrame
+{
+  public:
+    /**
+     * Largest payload, as expanded, that is sent compact.
+     */
+    static constexpr uint32_t MaxPayloadLength = 255;
+
+    /**
+     * STX, flags and the length, source and destination varints.
+     */
+    static constexpr uint32_t MaxHeaderLength = 10;
+
+    static constexpr uint32_t MaxFrameLength =
+        MaxHeaderLength + MaxPayloadLength + 5;
+
+    /**
+     * Transaction ids up to this are short enough to be encoded.
+     */
+    static constexpr uint32_t MaxTransactionId = 0x1FFFFF;
+
+    /**
+     * True if the packet carries a transaction and is small enough.
+     */
+    static bool CanEncode (IdpPacket& packet);
+
+    /**
+     * Encodes packet into buffer, which must hold MaxFrameLength bytes, and
+     * returns the length of the frame.
+     */
+    static uint32_t Encode (IdpPacket& packet, uint8_t* buffer);
+
+    /**
+     * Expands a complete frame into a packet, or returns nullptr if it is
+     * malformed or fails its CRC.
+     */
+    static std::shared_ptr<IdpPacket> Decode (const uint8_t* frame,
+                                              uint32_t length);
+
+    static uint32_t WriteVarint (uint32_t value, uint8_t* buffer);
+
+    /**
+     * Reads a varint from data, advancing it. Returns false if the varint
+     * runs past end or is longer than 5 bytes.
+     */
+    static bool ReadVarint (const uint8_t*& data, const uint8_t* end,
+                            uint32_t& value);
+};
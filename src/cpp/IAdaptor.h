@@ -3,7 +3,11 @@
 // full license information.
 #pragma once
 
+#include "Application.h"
 #include "IPacketTransmit.h"
+#include "LinkCredits.h"
+#include "PacketFragmenter.h"
+#include "PacketReassembler.h"
 
 /**
  * Interface that provides a bridge between a router and the outside world.
@@ -19,6 +23,22 @@ class IAdaptor : public IPacketTransmit
     bool _isReEnumerated;
     bool _isActive;
 
+    uint16_t _remoteAddress;
+    uint64_t _lastRemoteActivity;
+    uint32_t _remoteActivityCount;
+    uint32_t _polledActivityCount;
+    uint8_t _idlePolls;
+    uint8_t _pollJitter;
+    bool _isPollOutstanding;
+
+    uint64_t _groups;
+
+    LinkCredits _credits;
+
+    uint32_t _mtu;
+    PacketFragmenter _fragmenter;
+    PacketReassembler _reassembler;
+
   public:
     IAdaptor ()
     {
@@ -27,6 +47,18 @@ class IAdaptor : public IPacketTransmit
         _isEnumerated = false;
         _isReEnumerated = false;
         _isActive = false;
+
+        _remoteAddress = UnassignedAddress;
+        _lastRemoteActivity = 0;
+        _remoteActivityCount = 0;
+        _polledActivityCount = 0;
+        _idlePolls = 0;
+        _pollJitter = 0;
+        _isPollOutstanding = false;
+
+        _groups = 0;
+
+        _mtu = 0;
     }
 
     virtual ~IAdaptor ()
@@ -35,6 +67,24 @@ class IAdaptor : public IPacketTransmit
 
     virtual const char* Name () = 0;
 
+    /**
+     * Reserves the adaptor to forward a packet as it is received. Packets
+     * transmitted while it is reserved must be held back until EndForward.
+     */
+    virtual bool BeginForward ()
+    {
+        return false;
+    }
+
+    virtual bool Forward (const void* data, uint32_t length)
+    {
+        return false;
+    }
+
+    virtual void EndForward ()
+    {
+    }
+
     bool IsActive ()
     {
         return _isActive;
@@ -50,9 +100,19 @@ class IAdaptor : public IPacketTransmit
             {
                 IsEnumerated (false);
             }
+
+            if (_id != 0 && _local != nullptr)
+            {
+                _local->OnAdaptorActiveChanged (_id);
+            }
         }
     }
 
+    uint16_t AdaptorId ()
+    {
+        return _id;
+    }
+
     void AdaptorId (uint16_t id)
     {
         _id = id;
@@ -65,6 +125,27 @@ class IAdaptor : public IPacketTransmit
 
     bool OnReceive (std::shared_ptr<IdpPacket> packet)
     {
+        // Traffic from the router on the other side of the link proves it is
+        // still alive and addressed, so the link does not need polling.
+        if (_remoteAddress != UnassignedAddress &&
+            packet->Source () == _remoteAddress)
+        {
+            _lastRemoteActivity = Application::GetApplicationTime ();
+            _remoteActivityCount++;
+        }
+
+        _credits.OnReceived (packet->Length ());
+
+        if (((uint8_t) packet->Flags () & (uint8_t) IdpFlags::Fragment) != 0)
+        {
+            packet = _reassembler.Add (packet);
+
+            if (packet == nullptr)
+            {
+                return true;
+            }
+        }
+
         if (_id != 0 && _local != nullptr)
         {
             return _local->Transmit (_id, packet);
@@ -81,6 +162,15 @@ class IAdaptor : public IPacketTransmit
     void IsEnumerated (bool isEnumerated)
     {
         _isEnumerated = isEnumerated;
+
+        if (!isEnumerated)
+        {
+            // The remote router announces its groups again once the link is
+            // marked connected, and its receive window.
+            _groups = 0;
+            _credits.Unlimit ();
+            _reassembler.Clear ();
+        }
     }
 
     bool IsReEnumerated ()
@@ -92,4 +182,129 @@ class IAdaptor : public IPacketTransmit
     {
         _isReEnumerated = value;
     }
+
+    /**
+     * Address of the router on the other side of the link, learnt from its
+     * RouterPoll responses.
+     */
+    uint16_t RemoteAddress ()
+    {
+        return _remoteAddress;
+    }
+
+    void RemoteAddress (uint16_t address)
+    {
+        _remoteAddress = address;
+    }
+
+    uint64_t LastRemoteActivity ()
+    {
+        return _lastRemoteActivity;
+    }
+
+    void LastRemoteActivity (uint64_t time)
+    {
+        _lastRemoteActivity = time;
+    }
+
+    uint32_t RemoteActivityCount ()
+    {
+        return _remoteActivityCount;
+    }
+
+    /**
+     * Remote activity count as of the last answered poll.
+     */
+    uint32_t PolledActivityCount ()
+    {
+        return _polledActivityCount;
+    }
+
+    void PolledActivityCount (uint32_t value)
+    {
+        _polledActivityCount = value;
+    }
+
+    /**
+     * Number of consecutive polls that were the only traffic from the remote
+     * router, used to back off polling on idle links.
+     */
+    uint8_t IdlePolls ()
+    {
+        return _idlePolls;
+    }
+
+    void IdlePolls (uint8_t value)
+    {
+        _idlePolls = value;
+    }
+
+    /**
+     * How far the next poll of an idle link is brought forward, in 256ths of
+     * a quarter of the poll interval. Drawn once for each poll.
+     */
+    uint8_t PollJitter ()
+    {
+        return _pollJitter;
+    }
+
+    void PollJitter (uint8_t value)
+    {
+        _pollJitter = value;
+    }
+
+    /**
+     * Multicast groups that have members somewhere behind this adaptor.
+     */
+    uint64_t Groups ()
+    {
+        return _groups;
+    }
+
+    void Groups (uint64_t groups)
+    {
+        _groups = groups;
+    }
+
+    LinkCredits& Credits ()
+    {
+        return _credits;
+    }
+
+    /**
+     * Longest packet the link can carry. Longer packets are fragmented by
+     * the router and reassembled by the adaptor on the other side. Zero
+     * means the link has no limit.
+     */
+    uint32_t Mtu ()
+    {
+        return _mtu;
+    }
+
+    void Mtu (uint32_t value)
+    {
+        _mtu = value != 0 && value < PacketFragmenter::MinimumMtu
+                   ? PacketFragmenter::MinimumMtu
+                   : value;
+    }
+
+    PacketFragmenter& Fragmenter ()
+    {
+        return _fragmenter;
+    }
+
+    PacketReassembler& Reassembler ()
+    {
+        return _reassembler;
+    }
+
+    bool IsPollOutstanding ()
+    {
+        return _isPollOutstanding;
+    }
+
+    void IsPollOutstanding (bool value)
+    {
+        _isPollOutstanding = value;
+    }
 };
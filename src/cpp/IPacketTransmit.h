@@ -10,6 +10,7 @@
 #include <stdint.h>
 
 class IdpNode;
+class IAdaptor;
 
 /**
  *  IPacketTransmit
@@ -33,4 +34,21 @@ class IAdaptorToRouterPort
 
     virtual bool Transmit (uint16_t adaptorId,
                            std::shared_ptr<IdpPacket> packet) = 0;
+
+    /**
+     * Returns an adaptor that has been reserved to forward the packet byte by
+     * byte, or nullptr if the packet must be received in full and routed.
+     */
+    virtual IAdaptor* ResolveCutThrough (uint16_t adaptorId, uint16_t source,
+                                         uint16_t destination, uint32_t length)
+    {
+        return nullptr;
+    }
+
+    /**
+     * Called when a link is connected or disconnected.
+     */
+    virtual void OnAdaptorActiveChanged (uint16_t adaptorId)
+    {
+    }
 };
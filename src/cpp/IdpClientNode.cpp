@@ -18,11 +18,8 @@ IdpClientNode::IdpClientNode (Guid_t serverGuid, Guid_t guid, const char* name,
     _serverGuid = serverGuid;
 
     _lastPing = 0;
-    _pollTimerHandler = nullptr;
 
-    _pollTimer = new DispatcherTimer (1000, false);
-
-    _pollTimerHandler = &(_pollTimer->Tick += [&](auto sender, auto& e) {
+    _pollTimer = new ScheduledTimer (1000, [&] {
         if (_serverAddress == UnassignedAddress)
         {
             if (Address () == UnassignedAddress)
@@ -78,24 +75,18 @@ IdpClientNode::~IdpClientNode ()
 {
     if (_pollTimer != nullptr)
     {
-        if (_pollTimerHandler != nullptr)
-        {
-            _pollTimer->Tick -= *_pollTimerHandler;
-            _pollTimerHandler = nullptr;
-        }
-
-        _pollTimer->Stop ();
         delete _pollTimer;
         _pollTimer = nullptr;
     }
 }
 
 bool IdpClientNode::SendRequest (std::shared_ptr<OutgoingTransaction> request,
-                                 ResponseHandler handler)
+                                 OneTimeResponseHandler handler)
 {
     if (IsConnected ())
     {
-        return IdpNode::SendRequest (_serverAddress, request, handler);
+        return IdpNode::SendRequest (_serverAddress, request,
+                                     std::move (handler));
     }
     else
     {
@@ -202,7 +193,7 @@ void IdpClientNode::OnAddressAssigned (uint16_t address)
         return;
     }
 
-    if (_pollTimer != nullptr && _pollTimer->get_IsEnabled () &&
+    if (_pollTimer != nullptr && _pollTimer->IsEnabled () &&
         _serverAddress == UnassignedAddress)
     {
         Trace::WriteLine ("Local address assigned; querying interface",
@@ -220,10 +211,10 @@ void IdpClientNode::QueryInterface (Guid_t guid)
         return;
     }
 
-    Trace::WriteLine ("Broadcasting QueryInterface", "IdpClientNode");
+    Trace::WriteLine ("Multicasting QueryInterface", "IdpClientNode");
 
     bool queried = IdpNode::SendRequest (
-        0,
+        InterfaceGroupAddress (guid),
         OutgoingTransaction::Create ((uint16_t) NodeCommand::QueryInterface,
                                      CreateTransactionId (),
                                      IdpCommandFlags::None)
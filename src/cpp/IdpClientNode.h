@@ -6,8 +6,8 @@
  *******************************************************************************/
 #pragma once
 
-#include "DispatcherTimer.h"
 #include "IdpServerNode.h"
+#include "ScheduledTimer.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -18,8 +18,7 @@ class IdpClientNode : public IdpNode
 {
     uint64_t _lastPing;
     uint16_t _serverAddress;
-    DispatcherTimer* _pollTimer;
-    EventHandler* _pollTimerHandler;
+    ScheduledTimer* _pollTimer;
     Guid_t _serverGuid;
 
   public:
@@ -34,7 +33,7 @@ class IdpClientNode : public IdpNode
     void Connect ();
 
     bool SendRequest (std::shared_ptr<OutgoingTransaction> request,
-                      ResponseHandler handler);
+                      OneTimeResponseHandler handler);
 
     bool SendRequest (std::shared_ptr<OutgoingTransaction> request);
 
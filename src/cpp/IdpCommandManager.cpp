@@ -3,39 +3,93 @@
 // full license information.
 #include "IdpCommandManager.h"
 #include "Application.h"
-#include "DispatcherTimer.h"
 #include "IdpPacket.h"
 #include "IdpResponse.h"
+#include <algorithm>
 #include <unistd.h>
 
+template <typename THandler>
+static bool CompareCommandId (const DispatchEntry<THandler>& entry,
+                              uint16_t commandId)
+{
+    return entry.CommandId < commandId;
+}
+
+template <typename THandler>
+static THandler* FindHandler (std::vector<DispatchEntry<THandler>>& table,
+                              uint16_t commandId)
+{
+    auto it = std::lower_bound (table.begin (), table.end (), commandId,
+                                CompareCommandId<THandler>);
+
+    if (it != table.end () && it->CommandId == commandId)
+    {
+        return &it->Handler;
+    }
+
+    return nullptr;
+}
+
+template <typename THandler>
+static void InsertHandler (std::vector<DispatchEntry<THandler>>& table,
+                           uint16_t commandId, THandler handler)
+{
+    auto it = std::lower_bound (table.begin (), table.end (), commandId,
+                                CompareCommandId<THandler>);
+
+    if (it != table.end () && it->CommandId == commandId)
+    {
+        it->Handler = handler;
+    }
+    else
+    {
+        table.insert (it, { commandId, handler });
+    }
+}
+
+// Responses larger than this are rare enough not to reserve for up front.
+static constexpr uint32_t LearnedCapacityLimit = 1024;
+
+constexpr uint32_t IdpCommandManager::DefaultTimeout;
+constexpr uint16_t IdpCommandManager::BatchCommand;
+
 IdpCommandManager::IdpCommandManager ()
 {
-    _pollTimer = nullptr;
-    _pollTimerHandler = nullptr;
+    _staticDispatcher = nullptr;
+    _staticContext = nullptr;
+    _tracer = nullptr;
 
     RegisterCommand (
         0xA000, [&](std::shared_ptr<IncomingTransaction> incoming,
                     std::shared_ptr<OutgoingTransaction> outgoing) {
-            auto response =
-                std::shared_ptr<IdpResponse> (new IdpResponse (incoming));
-
-            auto it = _transactionHandlers.find (response->TransactionId ());
+            auto response = std::allocate_shared<IdpResponse> (
+                TransactionAllocator<IdpResponse> (), incoming);
 
-            if (it != _transactionHandlers.end ())
+            if (response->ResponseId () == BatchCommand &&
+                response->ResponseCode () == IdpResponseCode::OK)
             {
-                auto current = _transactionHandlers[response->TransactionId ()];
+                DispatchBatchResponses (*incoming);
+            }
+
+            ResponseHandlerTimeout current;
 
-                _transactionHandlers.erase (it);
+            if (_transactionHandlers.Remove (response->TransactionId (),
+                                             current))
+            {
+                IdpScheduler::Instance ().Cancel (current.timer);
 
                 current.handler (response);
+
+                TraceCompleted (response->TransactionId (), response);
             }
             else
             {
-                auto it = _responseHandlers.find (response->ResponseId ());
+                auto handler =
+                    FindHandler (_responseHandlers, response->ResponseId ());
 
-                if (it != _responseHandlers.end ())
+                if (handler != nullptr)
                 {
-                    auto current = it->second;
+                    auto current = *handler;
 
                     current (response);
                 }
@@ -44,129 +98,374 @@ IdpCommandManager::IdpCommandManager ()
             return IdpResponseCode::OK;
         });
 
-    _pollTimer = new DispatcherTimer (10);
+    _schedulerId = IdpScheduler::Instance ().Register (*this);
+}
 
-    _pollTimerHandler =
-        &(_pollTimer->Tick +=
-          [&](auto sender, auto& e) { this->InvalidateTimeouts (); });
+IdpCommandManager::~IdpCommandManager ()
+{
+    _transactionHandlers.ForEach ([](ResponseHandlerTimeout& entry) {
+        IdpScheduler::Instance ().Cancel (entry.timer);
+    });
 
-    _pollTimer->Start ();
+    IdpScheduler::Instance ().Unregister (_schedulerId);
 }
 
-IdpCommandManager::~IdpCommandManager ()
+void IdpCommandManager::OnScheduled (uint32_t transactionId)
 {
-    if (_pollTimer != nullptr)
+    ResponseHandlerTimeout current;
+
+    if (_transactionHandlers.Remove (transactionId, current))
     {
-        if (_pollTimerHandler != nullptr)
-        {
-            _pollTimer->Tick -= *_pollTimerHandler;
-            _pollTimerHandler = nullptr;
-        }
+        current.handler (std::shared_ptr<IdpResponse> (nullptr));
 
-        _pollTimer->Stop ();
-        delete _pollTimer;
-        _pollTimer = nullptr;
+        TraceCompleted (transactionId, nullptr);
     }
 }
 
-void IdpCommandManager::InvalidateTimeouts ()
+void IdpCommandManager::TraceCompleted (uint32_t transactionId,
+                                        std::shared_ptr<IdpResponse> response)
 {
-    auto currentTime = Application::GetApplicationTime ();
-
-    auto it = _transactionHandlers.begin ();
-
-    while (it != _transactionHandlers.end ())
+    // A handler that retransmits registers itself again, the transaction is
+    // then still in progress.
+    if (_tracer != nullptr &&
+        (response != nullptr ||
+         _transactionHandlers.Find (transactionId) == nullptr))
     {
-        auto current = it->second;
+        _tracer->OnCompleted (transactionId, response);
+    }
+}
 
-        if (current.expiry < currentTime)
-        {
-            it = _transactionHandlers.erase (it);
+TransactionTracer* IdpCommandManager::Tracer ()
+{
+    return _tracer;
+}
 
-            current.handler (std::shared_ptr<IdpResponse> (nullptr));
-        }
-        else
-        {
-            ++it;
-        }
-    }
+void IdpCommandManager::Tracer (TransactionTracer* tracer)
+{
+    _tracer = tracer;
 }
 
 
-void IdpCommandManager::RegisterOneTimeResponseHandler (uint32_t transactionId,
-                                                        ResponseHandler handler,
-                                                        uint32_t timeoutMs)
+void IdpCommandManager::RegisterOneTimeResponseHandler (
+    uint32_t transactionId, OneTimeResponseHandler handler, uint32_t timeoutMs)
 {
     auto currentTime = Application::GetApplicationTime ();
 
-    auto handlerInfo = ResponseHandlerTimeout ();
-    handlerInfo.handler = handler;
+    UnregisterOneTimeResponseHandler (transactionId);
+
+    auto& handlerInfo = _transactionHandlers.Insert (transactionId);
+    handlerInfo.handler = std::move (handler);
     handlerInfo.expiry = currentTime + timeoutMs;
-    _transactionHandlers[transactionId] = handlerInfo;
+
+    // Handlers time out once the expiry has passed, not when it is reached.
+    handlerInfo.timer = IdpScheduler::Instance ().Schedule (
+        _schedulerId, transactionId, handlerInfo.expiry + 1);
 }
 
 void IdpCommandManager::UnregisterOneTimeResponseHandler (
     uint32_t transactionId)
 {
-    auto it = _transactionHandlers.find (transactionId);
+    ResponseHandlerTimeout removed;
 
-    if (it != _transactionHandlers.end ())
+    if (_transactionHandlers.Remove (transactionId, removed))
     {
-        _transactionHandlers.erase (it);
+        IdpScheduler::Instance ().Cancel (removed.timer);
     }
 }
 
 void IdpCommandManager::RegisterResponseHandler (uint16_t commandId,
                                                  ResponseHandler handler)
 {
-    _responseHandlers[commandId] = handler;
+    InsertHandler (_responseHandlers, commandId, handler);
+}
+
+void IdpCommandManager::EnableReplayCache (uint16_t commandId)
+{
+    auto it = std::lower_bound (_replayedCommands.begin (),
+                                _replayedCommands.end (), commandId);
+
+    if (it == _replayedCommands.end () || *it != commandId)
+    {
+        _replayedCommands.insert (it, commandId);
+    }
+}
+
+ReplayCache& IdpCommandManager::Replays ()
+{
+    return _replayCache;
+}
+
+bool IdpCommandManager::IsReplayed (uint16_t commandId)
+{
+    return !_replayedCommands.empty () &&
+           std::binary_search (_replayedCommands.begin (),
+                               _replayedCommands.end (), commandId);
 }
 
 void IdpCommandManager::RegisterCommand (uint16_t commandId,
-                                         CommandHandler handler)
+                                         CommandHandler handler,
+                                         uint32_t responseCapacity)
 {
-    _commandHandlers[commandId] = handler;
+    InsertHandler (_commandHandlers, commandId, handler);
+
+    if (responseCapacity > 0)
+    {
+        InsertHandler (_responseCapacities, commandId, responseCapacity);
+    }
 }
 
 std::shared_ptr<IdpPacket>
     IdpCommandManager::ProcessPayload (uint16_t nodeAddress,
                                        std::shared_ptr<IdpPacket> packet)
 {
-    std::shared_ptr<IncomingTransaction> incomingTransaction (
-        new IncomingTransaction (packet));
+    // Both transactions come from pools and the response is only written if
+    // a handler touches it or it is sent, so one-way commands dispatch
+    // without allocating.
+    auto incomingTransaction = std::allocate_shared<IncomingTransaction> (
+        TransactionAllocator<IncomingTransaction> (), packet);
 
     auto& incoming = *incomingTransaction;
 
-    auto outgoingTransaction = OutgoingTransaction::Create (
-        0xA000, incoming.TransactionId (), IdpCommandFlags::None);
+    auto hint = FindHandler (_responseCapacities, incoming.CommandId ());
+    uint32_t capacity = hint != nullptr ? *hint : 0;
+
+    auto outgoingTransaction = OutgoingTransaction::CreateResponse (
+        incoming.TransactionId (), incoming.CommandId (), capacity);
 
     auto& outgoing = *outgoingTransaction;
 
-    if (_commandHandlers.find (incoming.CommandId ()) !=
-        _commandHandlers.end ())
+    if (incoming.CommandId () == BatchCommand)
+    {
+        return ProcessBatch (nodeAddress, incoming, outgoing);
+    }
+
+    bool isReplayed = ((uint8_t) incoming.Flags () &
+                       (uint8_t) IdpCommandFlags::ResponseExpected) &&
+                      IsReplayed (incoming.CommandId ());
+
+    if (isReplayed)
+    {
+        auto cached = _replayCache.Find (
+            incoming.Source (), incoming.TransactionId (), incoming.CommandId ());
+
+        if (cached != nullptr)
+        {
+            return CreateSubPacket (nodeAddress, incoming.Source (),
+                                    cached->data (), cached->size ());
+        }
+
+        // The original is still being handled, its response answers this.
+        if (_replayCache.IsPending (incoming.Source (),
+                                    incoming.TransactionId (),
+                                    incoming.CommandId ()))
+        {
+            return nullptr;
+        }
+
+        _replayCache.BeginPending (incoming.Source (),
+                                   incoming.TransactionId (),
+                                   incoming.CommandId ());
+    }
+
+    auto responseCode = IdpResponseCode::OK;
+
+    bool handled = _staticDispatcher != nullptr &&
+                   _staticDispatcher (_staticContext, incoming.CommandId (),
+                                      incomingTransaction, outgoingTransaction,
+                                      responseCode);
+
+    if (!handled)
     {
-        outgoing.Write ((uint8_t) IdpResponseCode::OK);
-        outgoing.Write (incoming.CommandId ());
+        auto handler = FindHandler (_commandHandlers, incoming.CommandId ());
+
+        if (handler != nullptr)
+        {
+            responseCode = (*handler) (incomingTransaction, outgoingTransaction);
 
-        auto responseCode = _commandHandlers[incoming.CommandId ()](
-            incomingTransaction, outgoingTransaction);
+            handled = true;
+        }
+    }
+
+    if (isReplayed && responseCode != IdpResponseCode::Deferred)
+    {
+        _replayCache.EndPending (incoming.Source (), incoming.TransactionId (),
+                                 incoming.CommandId ());
+    }
 
+    if (handled)
+    {
         if ((uint8_t) incoming.Flags () &
                 (uint8_t) IdpCommandFlags::ResponseExpected &&
             responseCode != IdpResponseCode::Deferred)
         {
             outgoing.WithResponseCode (responseCode);
 
-            return outgoing.ToPacket (nodeAddress, packet->Source ());
+            auto response = outgoing.ToPacket (nodeAddress, packet->Source ());
+
+            // Remember how much the handler wrote so the next response to
+            // this command is allocated once, at its full size.
+            auto written =
+                outgoing.Length () - OutgoingTransaction::ResponseHeaderLength;
+
+            if (written > capacity && written <= LearnedCapacityLimit)
+            {
+                InsertHandler (_responseCapacities, incoming.CommandId (),
+                               written);
+            }
+
+            // NotReady is transient, a retry should run the handler again.
+            if (isReplayed && responseCode != IdpResponseCode::NotReady)
+            {
+                _replayCache.Store (incoming.Source (),
+                                    incoming.TransactionId (),
+                                    incoming.CommandId (), response->Payload (),
+                                    response->PayloadLength ());
+            }
+
+            return response;
         }
     }
     else
     {
-        outgoing.Write ((uint8_t) IdpResponseCode::UnknownCommand);
-        outgoing.Write (incoming.CommandId ());
+        outgoing.WithResponseCode (IdpResponseCode::UnknownCommand);
 
         return outgoing.ToPacket (nodeAddress, packet->Source ());
     }
 
     return nullptr;
 }
+
+void IdpCommandManager::StoreDeferredResponse (uint16_t destination,
+                                               OutgoingTransaction& response,
+                                               IdpPacket& packet)
+{
+    if (!IsReplayed (response.ResponseId ()))
+    {
+        return;
+    }
+
+    // NotReady is transient, a retry should run the handler again.
+    if (response.ResponseCode () == IdpResponseCode::NotReady)
+    {
+        _replayCache.EndPending (destination, response.TransactionId (),
+                                 response.ResponseId ());
+    }
+    else
+    {
+        _replayCache.Store (destination, response.TransactionId (),
+                            response.ResponseId (), packet.Payload (),
+                            packet.PayloadLength ());
+    }
+}
+
+std::shared_ptr<IdpPacket> IdpCommandManager::CreateSubPacket (
+    uint16_t source, uint16_t destination, const void* data, uint16_t length)
+{
+    auto packet = std::shared_ptr<IdpPacket> (
+        new IdpPacket (length, IdpFlags::None, source, destination));
+
+    packet->Write (data, length);
+    packet->Seal ();
+
+    return packet;
+}
+
+std::shared_ptr<IdpPacket>
+    IdpCommandManager::ProcessBatch (uint16_t nodeAddress,
+                                     IncomingTransaction& incoming,
+                                     OutgoingTransaction& outgoing)
+{
+    bool responseExpected = (uint8_t) incoming.Flags () &
+                            (uint8_t) IdpCommandFlags::ResponseExpected;
+
+    auto responseCode = IdpResponseCode::OK;
+
+    while (incoming.BytesRemaining () > 0)
+    {
+        // Sub-transactions already dispatched stay dispatched, the sender
+        // learns the rest of the batch was malformed.
+        if (incoming.BytesRemaining () < sizeof (uint16_t))
+        {
+            responseCode = IdpResponseCode::InvalidParameters;
+            break;
+        }
+
+        auto length = incoming.Read<uint16_t> ();
+
+        // Command, transaction id and flags at the least.
+        if (length < 7 || length > incoming.BytesRemaining ())
+        {
+            responseCode = IdpResponseCode::InvalidParameters;
+            break;
+        }
+
+        auto data = incoming.ConsumeData (length);
+
+        auto response = ProcessPayload (
+            nodeAddress, CreateSubPacket (incoming.Source (),
+                                          incoming.Destination (), data,
+                                          length));
+
+        if (response == nullptr || !responseExpected)
+        {
+            continue;
+        }
+
+        auto responseLength = response->PayloadLength ();
+
+        if (responseLength <= UINT16_MAX)
+        {
+            outgoing.Write<uint16_t> (responseLength);
+            outgoing.Write (response->Payload (), responseLength);
+        }
+        else
+        {
+            // Too long for its length prefix. Only the header goes back, with
+            // an error code, so the sender can repeat the command on its own.
+            outgoing.Write<uint16_t> (
+                OutgoingTransaction::ResponseHeaderLength);
+            outgoing.Write (response->Payload (),
+                            OutgoingTransaction::HeaderLength);
+            outgoing.Write ((uint8_t) IdpResponseCode::InvalidParameters);
+            outgoing.Write (response->Payload () +
+                                OutgoingTransaction::ResponseHeaderLength -
+                                sizeof (uint16_t),
+                            sizeof (uint16_t));
+        }
+    }
+
+    if (responseExpected)
+    {
+        outgoing.WithResponseCode (responseCode);
+
+        return outgoing.ToPacket (nodeAddress, incoming.Source ());
+    }
+
+    return nullptr;
+}
+
+void IdpCommandManager::DispatchBatchResponses (IncomingTransaction& incoming)
+{
+    // Read from a fresh transaction, the batch's own handler still gets the
+    // response untouched.
+    IncomingTransaction batch (incoming.Packet ());
+
+    batch.Read<uint8_t> ();
+    batch.Read<uint16_t> ();
+
+    while (batch.BytesRemaining () >= sizeof (uint16_t))
+    {
+        auto length = batch.Read<uint16_t> ();
+
+        if (length < 7 || length > batch.BytesRemaining ())
+        {
+            break;
+        }
+
+        auto data = batch.ConsumeData (length);
+
+        ProcessPayload (batch.Destination (),
+                        CreateSubPacket (batch.Source (), batch.Destination (),
+                                         data, length));
+    }
+}
@@ -7,12 +7,16 @@
 #include "IdpResponse.h"
 #include "IncomingTransaction.h"
 #include "OutgoingTransaction.h"
-#include "DispatcherTimer.h"
+#include "IdpScheduler.h"
+#include "ReplayCache.h"
+#include "ResponseHandlerTable.h"
+#include "StaticCommandTable.h"
+#include "TransactionTracer.h"
 #include <functional>
 #include <list>
-#include <map>
 #include <memory>
 #include <stdint.h>
+#include <vector>
 
 typedef std::function<IdpResponseCode (
     std::shared_ptr<IncomingTransaction> incomingTransaction,
@@ -22,44 +26,133 @@ typedef std::function<IdpResponseCode (
 typedef std::function<void(std::shared_ptr<IdpResponse> response)>
     ResponseHandler;
 
-typedef struct
+template <typename THandler>
+struct DispatchEntry
 {
-    ResponseHandler handler;
-    uint64_t expiry;
-} ResponseHandlerTimeout;
+    uint16_t CommandId;
+    THandler Handler;
+};
 
 /**
  *  IdpCommandManager
  */
-class IdpCommandManager
+class IdpCommandManager : public ISchedulerTarget
 {
   public:
+    /**
+     * Time a one-time response handler waits for its response.
+     */
+    static constexpr uint32_t DefaultTimeout = 1750;
+
+    /**
+     * Envelope carrying length prefixed sub-transactions. Each one is
+     * dispatched in turn and their responses are returned, length prefixed,
+     * in a single response to the batch. A response too long for its length
+     * prefix is returned as just its header, with InvalidParameters.
+     */
+    static constexpr uint16_t BatchCommand = 0xA00E;
+
     /**
      * Instantiates a new instance of IdpCommandManager
      */
     IdpCommandManager ();
     ~IdpCommandManager ();
 
-    void RegisterCommand (uint16_t commandId, CommandHandler handler);
+    /**
+     * Registers a handler for commandId. Responses are created with room
+     * for responseCapacity payload bytes, or for the largest response the
+     * handler has written so far if that is more.
+     */
+    void RegisterCommand (uint16_t commandId, CommandHandler handler,
+                          uint32_t responseCapacity = 0);
 
     void RegisterOneTimeResponseHandler (uint32_t transactionId,
-                                         ResponseHandler handler,
-                                         uint32_t timeoutMs = 1750);
+                                         OneTimeResponseHandler handler,
+                                         uint32_t timeoutMs = DefaultTimeout);
 
     void UnregisterOneTimeResponseHandler (uint32_t transactionId);
 
     void RegisterResponseHandler (uint16_t commandId, ResponseHandler handler);
 
+    /**
+     * Answers retried commandId requests from a cache of recent responses
+     * rather than running the handler again. For handlers that are
+     * expensive or have side effects. A handler that returns Deferred must
+     * answer through IdpNode::SendDeferredResponse, otherwise retries are
+     * dropped until the replay cache's pending timeout passes.
+     */
+    void EnableReplayCache (uint16_t commandId);
+
+    ReplayCache& Replays ();
+
+    /**
+     * Stores a response that was deferred by its handler in the replay cache,
+     * given the packet it is sent to destination in. Retries of the request
+     * are dropped until this is called, then answered from the cache.
+     */
+    void StoreDeferredResponse (uint16_t destination,
+                                OutgoingTransaction& response,
+                                IdpPacket& packet);
+
+    /**
+     * Tracer told when one-time response handlers complete, or nullptr.
+     */
+    TransactionTracer* Tracer ();
+    void Tracer (TransactionTracer* tracer);
+
+    /**
+     * Dispatches the commands in TTable ahead of any registered at runtime,
+     * passing context to their handlers.
+     */
+    template <typename TTable>
+    void RegisterStaticCommands (void* context)
+    {
+        _staticDispatcher = &TTable::Dispatch;
+        _staticContext = context;
+    }
+
     std::shared_ptr<IdpPacket>
         ProcessPayload (uint16_t nodeAddress,
                         std::shared_ptr<IdpPacket> packet);
 
+    /**
+     * Called by the scheduler when a one-time response handler times out.
+     */
+    void OnScheduled (uint32_t transactionId);
+
   private:
-    void InvalidateTimeouts ();
+    std::shared_ptr<IdpPacket> ProcessBatch (uint16_t nodeAddress,
+                                             IncomingTransaction& incoming,
+                                             OutgoingTransaction& outgoing);
+
+    void DispatchBatchResponses (IncomingTransaction& incoming);
+
+    static std::shared_ptr<IdpPacket> CreateSubPacket (uint16_t source,
+                                                       uint16_t destination,
+                                                       const void* data,
+                                                       uint16_t length);
+
+    bool IsReplayed (uint16_t commandId);
+
+    uint32_t _schedulerId;
+
+    // Kept sorted by command id so dispatch is a single binary search over
+    // contiguous memory. Handlers are registered up front, not from within
+    // another handler.
+    std::vector<DispatchEntry<CommandHandler>> _commandHandlers;
+    std::vector<DispatchEntry<ResponseHandler>> _responseHandlers;
+    std::vector<DispatchEntry<uint32_t>> _responseCapacities;
+
+    ResponseHandlerTable _transactionHandlers;
+
+    std::vector<uint16_t> _replayedCommands;
+    ReplayCache _replayCache;
+
+    StaticCommandDispatcher _staticDispatcher;
+    void* _staticContext;
+
+    TransactionTracer* _tracer;
 
-    DispatcherTimer* _pollTimer;
-    EventHandler* _pollTimerHandler;
-    std::map<uint16_t, CommandHandler> _commandHandlers;
-    std::map<uint32_t, ResponseHandlerTimeout> _transactionHandlers;
-    std::map<uint16_t, ResponseHandler> _responseHandlers;
+    void TraceCompleted (uint32_t transactionId,
+                         std::shared_ptr<IdpResponse> response);
 };
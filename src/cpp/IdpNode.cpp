@@ -17,7 +17,9 @@ IdpNode::IdpNode (Guid_t guid, const char* name, uint16_t address)
     _timeout = 4000;
     _name = name;
     _lastPing = 0;
-    _pingTimerHandler = nullptr;
+    _maxRetransmissions = 0;
+    _tracer = nullptr;
+    _groups = MulticastGroupMask (InterfaceGroupAddress (guid));
 
     Manager ().RegisterResponseHandler (
         static_cast<uint16_t> (NodeCommand::Ping),
@@ -65,6 +67,14 @@ IdpNode::IdpNode (Guid_t guid, const char* name, uint16_t address)
             return IdpResponseCode::Deferred;
         });
 
+    Manager ().RegisterCommand (
+        static_cast<uint16_t> (NodeCommand::JoinGroup),
+        [&](std::shared_ptr<IncomingTransaction> incoming,
+            std::shared_ptr<OutgoingTransaction> outgoing) {
+            // Only routers keep track of membership.
+            return IdpResponseCode::OK;
+        });
+
     Manager ().RegisterCommand (
         static_cast<uint16_t> (NodeCommand::Reset),
         [&](std::shared_ptr<IncomingTransaction> incoming,
@@ -74,28 +84,19 @@ IdpNode::IdpNode (Guid_t guid, const char* name, uint16_t address)
             return IdpResponseCode::OK;
         });
 
-    _pingTimer = new DispatcherTimer (1000, false);
-
-    _pingTimerHandler =
-        &(_pingTimer->Tick +=
-          [&](auto sender, auto& e) { this->OnPollTimerTick (); });
+    _pingTimer = new ScheduledTimer (1000, [&] { this->OnPollTimerTick (); });
 }
 
 IdpNode::~IdpNode ()
 {
     if (_pingTimer != nullptr)
     {
-        if (_pingTimerHandler != nullptr)
-        {
-            _pingTimer->Tick -= *_pingTimerHandler;
-            _pingTimerHandler = nullptr;
-        }
-
-        _pingTimer->Stop ();
         delete _pingTimer;
         _pingTimer = nullptr;
     }
 
+    DisableTracing ();
+
     delete _commandManager;
 }
 
@@ -109,17 +110,20 @@ void IdpNode::OnPollTimerTick ()
     }
     else
     {
-        auto outgoingTransaction = OutgoingTransaction ::Create (
-            static_cast<uint16_t> (NodeCommand::Ping),
-            this->CreateTransactionId ());
-
-        if (!this->SendRequest (1, outgoingTransaction))
+        if (!this->SendRequest (1, CreatePing ()))
         {
             this->OnReset ();
         }
     }
 }
 
+std::shared_ptr<OutgoingTransaction> IdpNode::CreatePing ()
+{
+    return OutgoingTransaction::Create (
+        static_cast<uint16_t> (NodeCommand::Ping),
+        this->CreateTransactionId ());
+}
+
 uint32_t IdpNode::Timeout ()
 {
     return _timeout;
@@ -147,6 +151,63 @@ void IdpNode::OnAddressAssigned (uint16_t address)
     }
 }
 
+uint16_t IdpNode::InterfaceGroupAddress (Guid_t guid)
+{
+    uint32_t hash = guid.Data1 ^ guid.Data2 ^ ((uint32_t) guid.Data3 << 16);
+
+    for (int i = 0; i < 8; i++)
+    {
+        hash = (hash << 5) ^ (hash >> 27) ^ guid.Data4[i];
+    }
+
+    return MulticastAddressBase + (hash % MulticastGroupCount);
+}
+
+void IdpNode::JoinGroup (uint16_t group)
+{
+    if (IsMulticastAddress (group) && !IsGroupMember (group))
+    {
+        _groups |= MulticastGroupMask (group);
+
+        if (_address != UnassignedAddress)
+        {
+            AnnounceGroups ();
+        }
+    }
+}
+
+void IdpNode::LeaveGroup (uint16_t group)
+{
+    if (IsMulticastAddress (group) && IsGroupMember (group))
+    {
+        _groups &= ~MulticastGroupMask (group);
+
+        if (_address != UnassignedAddress)
+        {
+            AnnounceGroups ();
+        }
+    }
+}
+
+bool IdpNode::IsGroupMember (uint16_t group)
+{
+    return (_groups & MulticastGroupMask (group)) != 0;
+}
+
+uint64_t IdpNode::Groups ()
+{
+    return _groups;
+}
+
+void IdpNode::AnnounceGroups ()
+{
+    SendRequest (RouterPollAddress,
+                 OutgoingTransaction::Create (
+                     static_cast<uint16_t> (NodeCommand::JoinGroup),
+                     CreateTransactionId (), IdpCommandFlags::None)
+                     ->Write (_groups));
+}
+
 void IdpNode::OnReset ()
 {
     this->Address (UnassignedAddress);
@@ -186,6 +247,24 @@ const char* IdpNode::GetNodeCommandDescription (NodeCommand command)
         case NodeCommand::RouterPrepareToEnumerateAdaptors:
             return "Begin Enum Adapt";
 
+        case NodeCommand::JoinGroup:
+            return "Join Group      ";
+
+        case NodeCommand::LinkCredit:
+            return "Link Credit     ";
+
+        case NodeCommand::Batch:
+            return "Batch           ";
+
+        case NodeCommand::BulkOpen:
+            return "Bulk Open       ";
+
+        case NodeCommand::BulkData:
+            return "Bulk Data       ";
+
+        case NodeCommand::BulkAck:
+            return "Bulk Ack        ";
+
         default:
             return "Unknown         ";
     }
@@ -218,6 +297,11 @@ void IdpNode::Address (uint16_t address)
             _pingTimer->Stop ();
         }
 
+        if (address != UnassignedAddress)
+        {
+            AnnounceGroups ();
+        }
+
         OnAddressAssigned (address);
     }
 }
@@ -233,6 +317,59 @@ std::shared_ptr<IdpPacket>
     return nullptr;
 }
 
+void IdpNode::RegisterWorkerCommand (uint16_t commandId,
+                                     CommandHandler handler, WorkerPool& pool)
+{
+    Manager ().RegisterCommand (
+        commandId, [this, handler, &pool](
+                       std::shared_ptr<IncomingTransaction> incoming,
+                       std::shared_ptr<OutgoingTransaction> outgoing) {
+            auto source = incoming->Source ();
+            bool responseExpected =
+                (uint8_t) incoming->Flags () &
+                (uint8_t) IdpCommandFlags::ResponseExpected;
+
+            auto result = std::make_shared<IdpResponseCode> ();
+
+            bool posted = pool.Post (
+                [handler, incoming, outgoing, result]() {
+                    *result = handler (incoming, outgoing);
+                },
+                [this, outgoing, result, source, responseExpected]() {
+                    if (responseExpected &&
+                        *result != IdpResponseCode::Deferred)
+                    {
+                        outgoing->WithResponseCode (*result);
+
+                        this->SendDeferredResponse (source, outgoing);
+                    }
+                });
+
+            return posted ? IdpResponseCode::Deferred
+                          : IdpResponseCode::NotReady;
+        });
+}
+
+bool IdpNode::SendDeferredResponse (
+    uint16_t destination, std::shared_ptr<OutgoingTransaction> response)
+{
+    if (!Connected ())
+    {
+        return false;
+    }
+
+    auto packet = response->ToPacket (Address (), destination);
+
+    Manager ().StoreDeferredResponse (destination, *response, *packet);
+
+    if (!_enabled)
+    {
+        return true;
+    }
+
+    return TransmitEndpoint ().Transmit (packet);
+}
+
 IPacketTransmit& IdpNode::TransmitEndpoint ()
 {
     return *_transmitEndpoint;
@@ -250,21 +387,199 @@ bool IdpNode::Connected ()
 
 bool IdpNode::SendRequest (uint16_t destination,
                            std::shared_ptr<OutgoingTransaction> request,
-                           ResponseHandler handler)
+                           OneTimeResponseHandler handler)
 {
+    if (_maxRetransmissions > 0)
+    {
+        PendingRequest pending;
+        pending.TransactionId = request->TransactionId ();
+        pending.Destination = destination;
+        pending.Attempt = 0;
+        pending.Request = request;
+        pending.Handler = std::move (handler);
+
+        _pendingRequests.push_back (std::move (pending));
+
+        if (!TransmitPendingRequest (_pendingRequests.back ()))
+        {
+            auto index = FindPendingRequest (request->TransactionId ());
+
+            if (index >= 0)
+            {
+                _pendingRequests.erase (_pendingRequests.begin () + index);
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
     Manager ().RegisterOneTimeResponseHandler (request->TransactionId (),
-                                               handler);
+                                               std::move (handler));
+
+    if (_tracer != nullptr)
+    {
+        _tracer->OnSent (request->TransactionId (), Address (), destination,
+                         request->CommandId ());
+    }
 
     auto result = SendRequest (Address (), destination, request);
 
     if (!result)
     {
         Manager ().UnregisterOneTimeResponseHandler (request->TransactionId ());
+
+        if (_tracer != nullptr)
+        {
+            _tracer->Discard (request->TransactionId ());
+        }
     }
 
     return result;
 }
 
+int32_t IdpNode::FindPendingRequest (uint32_t transactionId)
+{
+    for (uint32_t i = 0; i < _pendingRequests.size (); i++)
+    {
+        if (_pendingRequests[i].TransactionId == transactionId)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool IdpNode::TransmitPendingRequest (PendingRequest& pending)
+{
+    auto transactionId = pending.TransactionId;
+
+    pending.SentAt = Application::GetApplicationTime ();
+
+    Manager ().RegisterOneTimeResponseHandler (
+        transactionId,
+        [this, transactionId](std::shared_ptr<IdpResponse> response) {
+            OnPendingResponse (transactionId, response);
+        },
+        _roundTripTimes.Timeout (pending.Destination, pending.Attempt));
+
+    auto isFirstAttempt = pending.Attempt == 0;
+
+    if (_tracer != nullptr)
+    {
+        _tracer->OnSent (transactionId, Address (), pending.Destination,
+                         pending.Request->CommandId ());
+    }
+
+    // Local destinations answer before this returns, so pending must not
+    // be used after sending.
+    if (!SendRequest (Address (), pending.Destination, pending.Request))
+    {
+        Manager ().UnregisterOneTimeResponseHandler (transactionId);
+
+        if (_tracer != nullptr && isFirstAttempt)
+        {
+            _tracer->Discard (transactionId);
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+void IdpNode::OnPendingResponse (uint32_t transactionId,
+                                 std::shared_ptr<IdpResponse> response)
+{
+    auto index = FindPendingRequest (transactionId);
+
+    if (index < 0)
+    {
+        return;
+    }
+
+    if (response == nullptr &&
+        _pendingRequests[index].Attempt < _maxRetransmissions)
+    {
+        auto& pending = _pendingRequests[index];
+
+        pending.Attempt++;
+
+        _roundTripTimes.OnRetransmit (pending.Destination);
+
+        if (TransmitPendingRequest (pending))
+        {
+            return;
+        }
+
+        index = FindPendingRequest (transactionId);
+
+        if (index < 0)
+        {
+            return;
+        }
+    }
+
+    auto& pending = _pendingRequests[index];
+
+    // Only first transmissions are sampled, an answer to a retransmission
+    // could belong to any of the sends.
+    if (response != nullptr && pending.Attempt == 0)
+    {
+        _roundTripTimes.OnSample (
+            pending.Destination,
+            Application::GetApplicationTime () - pending.SentAt);
+    }
+
+    auto handler = std::move (pending.Handler);
+
+    if ((uint32_t) index != _pendingRequests.size () - 1)
+    {
+        pending = std::move (_pendingRequests.back ());
+    }
+
+    _pendingRequests.pop_back ();
+
+    handler (response);
+}
+
+std::shared_ptr<IdpRequestTask>
+    IdpNode::SendRequestAsync (uint16_t destination,
+                               std::shared_ptr<OutgoingTransaction> request,
+                               uint32_t timeoutMs)
+{
+    auto task = IdpRequestTask::Create ();
+
+    Manager ().RegisterOneTimeResponseHandler (
+        request->TransactionId (),
+        [task](std::shared_ptr<IdpResponse> response) {
+            task->Complete (response);
+        },
+        timeoutMs);
+
+    if (_tracer != nullptr)
+    {
+        _tracer->OnSent (request->TransactionId (), Address (), destination,
+                         request->CommandId ());
+    }
+
+    if (!SendRequest (Address (), destination, request))
+    {
+        Manager ().UnregisterOneTimeResponseHandler (request->TransactionId ());
+
+        if (_tracer != nullptr)
+        {
+            _tracer->Discard (request->TransactionId ());
+        }
+
+        task->Complete (false);
+    }
+
+    return task;
+}
+
 bool IdpNode::SendRequest (uint16_t destination,
                            std::shared_ptr<OutgoingTransaction> request)
 {
@@ -288,6 +603,41 @@ bool IdpNode::SendRequest (uint16_t source, uint16_t destination,
     return false;
 }
 
+void IdpNode::EnableTracing (TraceRing& ring)
+{
+    DisableTracing ();
+
+    _tracer = new TransactionTracer (ring);
+
+    Manager ().Tracer (_tracer);
+}
+
+void IdpNode::DisableTracing ()
+{
+    if (_tracer != nullptr)
+    {
+        Manager ().Tracer (nullptr);
+
+        delete _tracer;
+        _tracer = nullptr;
+    }
+}
+
+uint8_t IdpNode::MaxRetransmissions ()
+{
+    return _maxRetransmissions;
+}
+
+void IdpNode::MaxRetransmissions (uint8_t value)
+{
+    _maxRetransmissions = value;
+}
+
+RttEstimator& IdpNode::RoundTripTimes ()
+{
+    return _roundTripTimes;
+}
+
 bool IdpNode::Enabled ()
 {
     return _enabled;
@@ -3,13 +3,18 @@
 // full license information.
 #pragma once
 
-#include "DispatcherTimer.h"
 #include "Guid.h"
 #include "IPacketTransmit.h"
 #include "IdpCommandManager.h"
+#include "IdpRequestTask.h"
+#include "RttEstimator.h"
+#include "ScheduledTimer.h"
+#include "TransactionTracer.h"
+#include "WorkerPool.h"
 #include <memory>
 #include <stdbool.h>
 #include <stdint.h>
+#include <vector>
 
 class IPacketTransmit;
 
@@ -19,6 +24,24 @@ const Guid_t RouterGuid = Guid_t ("A1EE332D-5C7C-42FE-9519-54BDAC40CF21");
 constexpr uint16_t UnassignedAddress = 0xFFFF;
 constexpr uint16_t RouterPollAddress = 0xFFFE;
 
+// Multicast group addresses. Routers keep a 64 bit membership bitmap per
+// adaptor, so the number of groups is fixed.
+constexpr uint16_t MulticastAddressBase = 0xFF00;
+constexpr uint16_t MulticastGroupCount = 64;
+
+constexpr bool IsMulticastAddress (uint16_t address)
+{
+    return address >= MulticastAddressBase &&
+           address < MulticastAddressBase + MulticastGroupCount;
+}
+
+constexpr uint64_t MulticastGroupMask (uint16_t address)
+{
+    return IsMulticastAddress (address)
+               ? (uint64_t) 1 << (address - MulticastAddressBase)
+               : 0;
+}
+
 enum class NodeCommand : uint16_t
 {
     Response = 0xA000,
@@ -35,7 +58,17 @@ enum class NodeCommand : uint16_t
     RouterEnumerateAdaptor = 0xA009,
     MarkAdaptorConnected = 0xA00A,
 
-    RouterPoll = 0xA00B
+    RouterPoll = 0xA00B,
+
+    JoinGroup = 0xA00C,
+
+    LinkCredit = 0xA00D,
+
+    Batch = IdpCommandManager::BatchCommand,
+
+    BulkOpen = 0xA00F,
+    BulkData = 0xA010,
+    BulkAck = 0xA011
 };
 
 enum class EnumerationTarget : uint16_t
@@ -59,13 +92,39 @@ class IdpNode
 
     const char* _name;
     uint64_t _lastPing;
-    DispatcherTimer* _pingTimer;
-    EventHandler* _pingTimerHandler;
+    ScheduledTimer* _pingTimer;
     uint32_t _timeout;
+    uint64_t _groups;
+
+    struct PendingRequest
+    {
+        uint32_t TransactionId;
+        uint16_t Destination;
+        uint8_t Attempt;
+        uint64_t SentAt;
+        std::shared_ptr<OutgoingTransaction> Request;
+        OneTimeResponseHandler Handler;
+    };
+
+    std::vector<PendingRequest> _pendingRequests;
+    RttEstimator _roundTripTimes;
+    uint8_t _maxRetransmissions;
+    TransactionTracer* _tracer;
+
+    int32_t FindPendingRequest (uint32_t transactionId);
+    bool TransmitPendingRequest (PendingRequest& pending);
+    void OnPendingResponse (uint32_t transactionId,
+                            std::shared_ptr<IdpResponse> response);
 
   protected:
     Guid_t _guid;
 
+    /**
+     * Sends the full set of groups this node is a member of to the router it
+     * is attached to, which replaces what it knew before.
+     */
+    virtual void AnnounceGroups ();
+
   public:
     /**
      * Instantiates a new instance of IdpNode
@@ -77,14 +136,39 @@ class IdpNode
 
     static const char* GetNodeCommandDescription (NodeCommand command);
 
+    /**
+     * Returns the multicast group that nodes implementing the interface join,
+     * so QueryInterface only reaches candidate nodes.
+     */
+    static uint16_t InterfaceGroupAddress (Guid_t guid);
+
     IdpCommandManager& Manager ();
 
     std::shared_ptr<IdpPacket>
         ProcessPacket (std::shared_ptr<IdpPacket> packet);
 
+    /**
+     * Registers a command whose handler runs on a worker thread, so a slow
+     * handler does not hold up the dispatcher. The response is sent from
+     * the dispatcher once the handler returns, or NotReady is returned
+     * straight away if the pool's queue is full. The handler must only use
+     * the transactions it is given, and the pool must be destroyed before
+     * the node.
+     */
+    void RegisterWorkerCommand (uint16_t commandId, CommandHandler handler,
+                                WorkerPool& pool);
+
+    /**
+     * Sends the response to a request whose handler returned Deferred. If
+     * the command has a replay cache the response is stored in it, so
+     * retries of the request are answered without running the handler.
+     */
+    bool SendDeferredResponse (uint16_t destination,
+                               std::shared_ptr<OutgoingTransaction> response);
+
     bool SendRequest (uint16_t destination,
                       std::shared_ptr<OutgoingTransaction> request,
-                      ResponseHandler handler);
+                      OneTimeResponseHandler handler);
 
     bool SendRequest (uint16_t destination,
                       std::shared_ptr<OutgoingTransaction> request);
@@ -92,15 +176,52 @@ class IdpNode
     bool SendRequest (uint16_t source, uint16_t destination,
                       std::shared_ptr<OutgoingTransaction> request);
 
+    /**
+     * Sends a request and returns a task that completes with its response,
+     * so callers can chain requests or wait on several without registering
+     * handlers themselves.
+     */
+    std::shared_ptr<IdpRequestTask> SendRequestAsync (
+        uint16_t destination, std::shared_ptr<OutgoingTransaction> request,
+        uint32_t timeoutMs = IdpCommandManager::DefaultTimeout);
+
     virtual void OnAddressAssigned (uint16_t address);
 
     virtual void OnReset ();
 
     virtual void OnPollTimerTick ();
 
+    /**
+     * Creates the Ping sent to the master every poll tick.
+     */
+    virtual std::shared_ptr<OutgoingTransaction> CreatePing ();
+
     uint32_t Timeout ();
     void Timeout (uint32_t value);
 
+    /**
+     * Number of times a request sent with a response handler is
+     * retransmitted before the handler is given up on. Timeouts then follow
+     * the round trip time to the destination and back off exponentially.
+     * Zero, the default, sends once with the fixed timeout.
+     */
+    uint8_t MaxRetransmissions ();
+    void MaxRetransmissions (uint8_t value);
+
+    /**
+     * Round trip time statistics per destination, gathered while
+     * retransmission is enabled.
+     */
+    RttEstimator& RoundTripTimes ();
+
+    /**
+     * Records a span in ring for every request sent with a response handler,
+     * from the first send until its response arrives or it times out. The
+     * ring must outlive the node or tracing be disabled first.
+     */
+    void EnableTracing (TraceRing& ring);
+    void DisableTracing ();
+
     uint16_t Address ();
     void Address (uint16_t address);
 
@@ -118,6 +239,23 @@ class IdpNode
 
     const char* Name ();
 
+    /**
+     * Joins a multicast group. Membership is announced to the router the node
+     * is attached to whenever it changes or the node is addressed, and each
+     * router passes on the groups with members behind it towards the master.
+     */
+    void JoinGroup (uint16_t group);
+
+    /**
+     * Stops processing traffic for a group. Routers stop forwarding the group
+     * towards this node once no other member is behind the same link.
+     */
+    void LeaveGroup (uint16_t group);
+
+    bool IsGroupMember (uint16_t group);
+
+    uint64_t Groups ();
+
     uint32_t CreateTransactionId ();
 
     Event Enumerated;
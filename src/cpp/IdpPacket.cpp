@@ -69,13 +69,33 @@ void IdpPacket::Seal ()
     if (((uint8_t) Flags () & (uint8_t) IdpFlags::CRC) ==
         (uint8_t) IdpFlags::CRC)
     {
-        // TODO write CRC.
-        Write ((uint32_t) 0xAA55AA55);
+        Write (Crc32 (Data (), _writeIndex));
     }
 
     _isSealed = true;
 }
 
+uint32_t IdpPacket::Crc32 (const uint8_t* data, uint32_t length, uint32_t crc)
+{
+    static const uint32_t nibbleTable[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    crc = ~crc;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ nibbleTable[crc & 0x0F];
+        crc = (crc >> 4) ^ nibbleTable[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+
 void IdpPacket::Write (const void* data, uint32_t length)
 {
     memcpy (_buffer.get () + _writeIndex, data, length);
@@ -12,7 +12,9 @@ enum class IdpFlags
 {
     None = 0,
     CRC = 0x01,
-    RAW = 0x02
+    RAW = 0x02,
+    Fragment = 0x04,
+    Compact = 0x80
 };
 
 /**
@@ -87,6 +89,13 @@ class IdpPacket
 
     void Write (const void* data, uint32_t length);
 
+    /**
+     * CRC-32 (IEEE 802.3) over a buffer. Pass the previous result as crc to
+     * continue a running checksum.
+     */
+    static uint32_t Crc32 (const uint8_t* data, uint32_t length,
+                           uint32_t crc = 0);
+
   private:
     std::shared_ptr<uint8_t> _buffer;
     uint32_t _writeIndex;
@@ -2,13 +2,22 @@
 // Licensed under the MIT license. See licence.md file in the project root for
 // full license information.
 #include "IdpPacketParser.h"
+#include "Application.h"
 #include "BitConverter.h"
 #include "DataReceivedEventArgs.h"
 
+static constexpr uint32_t DefaultCutThroughTimeout = 100;
+
 IdpPacketParser::IdpPacketParser ()
 {
     _stream = nullptr;
     _currentPacketCRC = 0;
+    _cutThroughSink = nullptr;
+    _isCuttingThrough = false;
+    _cutThroughTimeout = DefaultCutThroughTimeout;
+    _cutThroughActivity = 0;
+    _cutThroughTimer = std::unique_ptr<ScheduledTimer> (new ScheduledTimer (
+        _cutThroughTimeout, [&] { this->OnCutThroughTimer (); }));
     Reset ();
 
     _pollTimer = std::unique_ptr<DispatcherTimer> (new DispatcherTimer (2));
@@ -38,9 +47,16 @@ IdpPacketParser::~IdpPacketParser ()
 
 void IdpPacketParser::Reset ()
 {
+    if (_isCuttingThrough)
+    {
+        EndCutThrough (false);
+    }
+
     _currentPacket = nullptr;
     _currentPacketHasCRC = false;
     _currentPacketLength = 0;
+    _compactFrameLength = 0;
+    _compactVarints = 0;
     _currentState = &IdpPacketParser::WaitingForStx;
 }
 
@@ -73,6 +89,37 @@ void IdpPacketParser::Stream (IStream* value)
     Reset();
 }
 
+void IdpPacketParser::CutThroughSink (ICutThroughSink* sink)
+{
+    _cutThroughSink = sink;
+}
+
+uint32_t IdpPacketParser::CutThroughTimeout ()
+{
+    return _cutThroughTimeout;
+}
+
+void IdpPacketParser::CutThroughTimeout (uint32_t value)
+{
+    _cutThroughTimeout = value;
+    _cutThroughTimer->Interval (value);
+}
+
+void IdpPacketParser::OnCutThroughTimer ()
+{
+    if (!_isCuttingThrough)
+    {
+        _cutThroughTimer->Stop ();
+    }
+    else if (Application::GetApplicationTime () - _cutThroughActivity >=
+             _cutThroughTimeout)
+    {
+        // The rest of the packet is dropped as it arrives, as the parser
+        // looks for the next STX.
+        Reset ();
+    }
+}
+
 bool IdpPacketParser::WaitingForStx ()
 {
     uint8_t data;
@@ -89,14 +136,42 @@ bool IdpPacketParser::WaitingForStx ()
 
 bool IdpPacketParser::ReadingLength ()
 {
-    if (_stream->TryRead (_currentPacketLength))
+    uint8_t data;
+
+    if (_stream->TryRead (data))
     {
-        if (BitConverter::IsLittleEndian ())
+        // No valid length has its top bit set, so it marks a compact frame.
+        if ((data & (uint8_t) IdpFlags::Compact) != 0)
         {
-            _currentPacketLength =
-                BitConverter::SwapEndian (_currentPacketLength);
+            _compactFrame[0] = 0x02;
+            _compactFrame[1] = data;
+            _compactFrameLength = 2;
+            _compactVarints = 0;
+
+            _currentState = &IdpPacketParser::ReadingCompactHeader;
+
+            return true;
         }
 
+        _currentPacketLength = data;
+
+        _currentState = &IdpPacketParser::ReadingLengthRemainder;
+
+        return true;
+    }
+
+    return false;
+}
+
+bool IdpPacketParser::ReadingLengthRemainder ()
+{
+    uint8_t data[3];
+
+    if (_stream->TryRead (data, sizeof (data)))
+    {
+        _currentPacketLength = (_currentPacketLength << 24) |
+                               (data[0] << 16) | (data[1] << 8) | data[2];
+
         if (_currentPacketLength < 11 || _currentPacketLength > 1000000)
         {
             Reset ();
@@ -166,6 +241,43 @@ bool IdpPacketParser::ReadingDestination ()
             data = BitConverter::SwapEndian (data);
         }
 
+        _currentPacketDestination = data;
+
+        if (_cutThroughSink != nullptr &&
+            _cutThroughSink->BeginCutThrough (
+                _currentPacketFlags, _currentPacketSource,
+                _currentPacketDestination, _currentPacketLength))
+        {
+            _isCuttingThrough = true;
+            _cutThroughFailed = false;
+            _cutThroughRemaining = PayloadLength ();
+            _cutThroughActivity = Application::GetApplicationTime ();
+            _cutThroughTimer->Start ();
+
+            // Header layout matches IdpPacket.
+            uint8_t header[10];
+            uint32_t length = _currentPacketLength;
+            uint16_t source = _currentPacketSource;
+
+            if (BitConverter::IsLittleEndian ())
+            {
+                length = BitConverter::SwapEndian (length);
+                source = BitConverter::SwapEndian (source);
+                data = BitConverter::SwapEndian (data);
+            }
+
+            header[0] = 0x02;
+            memcpy (header + 1, &length, sizeof (length));
+            header[5] = (uint8_t) _currentPacketFlags;
+            memcpy (header + 6, &source, sizeof (source));
+            memcpy (header + 8, &data, sizeof (data));
+
+            CutThrough (header, sizeof (header));
+
+            _currentState = &IdpPacketParser::CuttingThroughPayload;
+            return true;
+        }
+
         _currentPacket = std::shared_ptr<IdpPacket> (
             new IdpPacket (PayloadLength (), _currentPacketFlags,
                            _currentPacketSource, data, false));
@@ -225,6 +337,11 @@ bool IdpPacketParser::ReadingCRC ()
 {
     if (_stream->TryRead (_currentPacketCRC))
     {
+        if (BitConverter::IsLittleEndian ())
+        {
+            _currentPacketCRC = BitConverter::SwapEndian (_currentPacketCRC);
+        }
+
         _currentPacket->Write (_currentPacketCRC);
 
         _currentState = &IdpPacketParser::Validating;
@@ -237,11 +354,13 @@ bool IdpPacketParser::ReadingCRC ()
 
 bool IdpPacketParser::Validating ()
 {
-    bool isValid = !_currentPacketHasCRC;
+    bool isValid = true;
 
     if (_currentPacketHasCRC)
     {
-        // TODO validate CRC
+        isValid = IdpPacket::Crc32 (_currentPacket->Data (),
+                                    _currentPacketLength - 4) ==
+                  _currentPacketCRC;
     }
 
     if (isValid)
@@ -253,3 +372,198 @@ bool IdpPacketParser::Validating ()
 
     return false;
 }
+
+bool IdpPacketParser::ReadingCompactHeader ()
+{
+    uint8_t data;
+
+    while (_compactVarints < 3)
+    {
+        if (!_stream->TryRead (data))
+        {
+            return false;
+        }
+
+        if (_compactFrameLength == CompactFrame::MaxHeaderLength)
+        {
+            Reset ();
+            return false;
+        }
+
+        _compactFrame[_compactFrameLength++] = data;
+
+        if ((data & 0x80) == 0)
+        {
+            _compactVarints++;
+        }
+    }
+
+    const uint8_t* length = _compactFrame + 2;
+    uint32_t payloadLength;
+
+    if (!CompactFrame::ReadVarint (length, _compactFrame + _compactFrameLength,
+                                   payloadLength) ||
+        payloadLength > CompactFrame::MaxPayloadLength)
+    {
+        Reset ();
+        return false;
+    }
+
+    // Payload, ETX and CRC.
+    _compactFrameRemaining = payloadLength + 1;
+
+    if ((_compactFrame[1] & (uint8_t) IdpFlags::CRC) != 0)
+    {
+        _compactFrameRemaining += 4;
+    }
+
+    _currentState = &IdpPacketParser::ReadingCompactBody;
+
+    return true;
+}
+
+bool IdpPacketParser::ReadingCompactBody ()
+{
+    if (_stream->TryRead (_compactFrame + _compactFrameLength,
+                          _compactFrameRemaining))
+    {
+        _compactFrameLength += _compactFrameRemaining;
+
+        auto packet =
+            CompactFrame::Decode (_compactFrame, _compactFrameLength);
+
+        if (packet != nullptr)
+        {
+            DataReceived (this, new DataReceivedEventArgs (packet));
+        }
+
+        Reset ();
+    }
+
+    return false;
+}
+
+bool IdpPacketParser::CuttingThroughPayload ()
+{
+    uint8_t buffer[64];
+
+    while (_cutThroughRemaining > 0)
+    {
+        auto available = _stream->BytesReceived ();
+
+        if (available <= 0)
+        {
+            return false;
+        }
+
+        uint32_t length = sizeof (buffer);
+
+        if (length > (uint32_t) available)
+        {
+            length = available;
+        }
+
+        if (length > _cutThroughRemaining)
+        {
+            length = _cutThroughRemaining;
+        }
+
+        auto received = _stream->Read (buffer, length);
+
+        if (received <= 0)
+        {
+            return false;
+        }
+
+        CutThrough (buffer, received);
+
+        _cutThroughRemaining -= received;
+        _cutThroughActivity = Application::GetApplicationTime ();
+    }
+
+    _currentState = &IdpPacketParser::CuttingThroughEtx;
+
+    return true;
+}
+
+bool IdpPacketParser::CuttingThroughEtx ()
+{
+    uint8_t data;
+
+    if (_stream->TryRead (data))
+    {
+        if (data == 0x03)
+        {
+            CutThrough (&data, 1);
+
+            if (_currentPacketHasCRC)
+            {
+                _currentState = &IdpPacketParser::CuttingThroughCRC;
+
+                return true;
+            }
+
+            EndCutThrough (!_cutThroughFailed);
+        }
+
+        Reset ();
+    }
+
+    return false;
+}
+
+bool IdpPacketParser::CuttingThroughCRC ()
+{
+    uint8_t data[4];
+
+    if (_stream->TryRead (data, sizeof (data)))
+    {
+        // The CRC is checked end to end by the receiving node.
+        CutThrough (data, sizeof (data));
+
+        EndCutThrough (!_cutThroughFailed);
+
+        Reset ();
+    }
+
+    return false;
+}
+
+void IdpPacketParser::CutThrough (const uint8_t* data, uint32_t length)
+{
+    if (!_cutThroughFailed && !_cutThroughSink->CutThroughData (data, length))
+    {
+        _cutThroughFailed = true;
+    }
+}
+
+void IdpPacketParser::EndCutThrough (bool valid)
+{
+    _isCuttingThrough = false;
+    _cutThroughTimer->Stop ();
+
+    if (!valid && !_cutThroughFailed)
+    {
+        // The header has already gone out, so pad the packet to its
+        // advertised length and terminate it with an invalid ETX.
+        uint8_t padding[64] = { 0 };
+
+        while (_cutThroughRemaining > 0 && !_cutThroughFailed)
+        {
+            uint32_t length = sizeof (padding);
+
+            if (length > _cutThroughRemaining)
+            {
+                length = _cutThroughRemaining;
+            }
+
+            CutThrough (padding, length);
+
+            _cutThroughRemaining -= length;
+        }
+
+        CutThrough (padding, 1);
+    }
+
+    _cutThroughSink->EndCutThrough (valid);
+}
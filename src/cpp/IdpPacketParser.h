@@ -6,11 +6,42 @@
 #include <memory>
 #include <stdint.h>
 
+#include "CompactFrame.h"
 #include "DataReceivedEventArgs.h"
 #include "Dispatcher.h"
 #include "Event.h"
 #include "IStream.h"
 #include "IdpPacket.h"
+#include "ScheduledTimer.h"
+
+/**
+ * Receives packets that are forwarded byte by byte as they arrive instead of
+ * being reassembled first.
+ */
+class ICutThroughSink
+{
+  public:
+    virtual ~ICutThroughSink ()
+    {
+    }
+
+    /**
+     * Called once the header has been parsed. Return true to take the packet,
+     * the parser then passes on every byte of it (header included) through
+     * CutThroughData.
+     */
+    virtual bool BeginCutThrough (IdpFlags flags, uint16_t source,
+                                  uint16_t destination, uint32_t length) = 0;
+
+    virtual bool CutThroughData (const uint8_t* data, uint32_t length) = 0;
+
+    /**
+     * Called when the packet has been passed on. If it was not valid, the
+     * parser has already padded it out with an invalid ETX, so the next hop
+     * drops it.
+     */
+    virtual void EndCutThrough (bool valid) = 0;
+};
 
 /**
  *  IdpPacketParser
@@ -37,12 +68,35 @@ class IdpPacketParser
 
     void Parse ();
 
+    void CutThroughSink (ICutThroughSink* sink);
+
+    /**
+     * Time a packet being cut through may go without receiving any bytes
+     * before it is aborted, so a stalled sender does not hold the egress.
+     */
+    uint32_t CutThroughTimeout ();
+    void CutThroughTimeout (uint32_t value);
+
   private:
     uint32_t _currentPacketLength;
     bool _currentPacketHasCRC;
     uint32_t _currentPacketCRC;
     IdpFlags _currentPacketFlags;
     uint16_t _currentPacketSource;
+    uint16_t _currentPacketDestination;
+
+    ICutThroughSink* _cutThroughSink;
+    bool _isCuttingThrough;
+    bool _cutThroughFailed;
+    uint32_t _cutThroughRemaining;
+    uint32_t _cutThroughTimeout;
+    uint64_t _cutThroughActivity;
+    std::unique_ptr<ScheduledTimer> _cutThroughTimer;
+
+    uint8_t _compactFrame[CompactFrame::MaxFrameLength];
+    uint32_t _compactFrameLength;
+    uint32_t _compactFrameRemaining;
+    uint8_t _compactVarints;
 
     IStream* _stream;
     std::unique_ptr<DispatcherTimer> _pollTimer;
@@ -55,6 +109,7 @@ class IdpPacketParser
     void Reset ();
     bool WaitingForStx ();
     bool ReadingLength ();
+    bool ReadingLengthRemainder ();
     bool ReadingFlags ();
     bool ReadingSource ();
     bool ReadingDestination ();
@@ -62,4 +117,14 @@ class IdpPacketParser
     bool WaitingForEtx ();
     bool ReadingCRC ();
     bool Validating ();
+
+    bool ReadingCompactHeader ();
+    bool ReadingCompactBody ();
+
+    bool CuttingThroughPayload ();
+    bool CuttingThroughEtx ();
+    bool CuttingThroughCRC ();
+    void CutThrough (const uint8_t* data, uint32_t length);
+    void EndCutThrough (bool valid);
+    void OnCutThroughTimer ();
 };
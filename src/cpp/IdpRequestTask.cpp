@@ -0,0 +1,116 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "IdpRequestTask.h"
+#include "TransactionAllocator.h"
+
+IdpRequestTask::IdpRequestTask ()
+{
+    _isCompleted = false;
+    _isSuccess = false;
+}
+
+IdpRequestTask::~IdpRequestTask ()
+{
+}
+
+std::shared_ptr<IdpRequestTask> IdpRequestTask::Create ()
+{
+    return std::allocate_shared<IdpRequestTask> (
+        TransactionAllocator<IdpRequestTask> ());
+}
+
+std::shared_ptr<IdpRequestTask>
+    IdpRequestTask::WhenAll (std::vector<std::shared_ptr<IdpRequestTask>> tasks)
+{
+    auto result = Create ();
+
+    if (tasks.empty ())
+    {
+        result->Complete (true);
+
+        return result;
+    }
+
+    auto remaining = std::make_shared<uint32_t> (tasks.size ());
+    auto success = std::make_shared<bool> (true);
+
+    for (auto& task : tasks)
+    {
+        task->Then ([result, remaining, success](
+                        std::shared_ptr<IdpRequestTask> completed) {
+            *success = *success && completed->IsSuccess ();
+
+            if (--(*remaining) == 0)
+            {
+                result->Complete (*success);
+            }
+        });
+    }
+
+    return result;
+}
+
+bool IdpRequestTask::IsCompleted ()
+{
+    return _isCompleted;
+}
+
+bool IdpRequestTask::IsSuccess ()
+{
+    return _isSuccess;
+}
+
+std::shared_ptr<IdpResponse> IdpRequestTask::Response ()
+{
+    return _response;
+}
+
+std::shared_ptr<IdpRequestTask>
+    IdpRequestTask::Then (RequestContinuation continuation)
+{
+    if (_isCompleted)
+    {
+        continuation (shared_from_this ());
+    }
+    else
+    {
+        _continuations.push_back (continuation);
+    }
+
+    return shared_from_this ();
+}
+
+void IdpRequestTask::Complete (std::shared_ptr<IdpResponse> response)
+{
+    // A late response must not replace the one continuations already saw.
+    if (_isCompleted)
+    {
+        return;
+    }
+
+    _response = response;
+
+    Complete (response != nullptr);
+}
+
+void IdpRequestTask::Complete (bool success)
+{
+    if (_isCompleted)
+    {
+        return;
+    }
+
+    _isCompleted = true;
+    _isSuccess = success;
+
+    // Keep the task alive while continuations run, they may drop the last
+    // reference to it.
+    auto self = shared_from_this ();
+    auto continuations = std::move (_continuations);
+
+    for (auto& continuation : continuations)
+    {
+        continuation (self);
+    }
+}
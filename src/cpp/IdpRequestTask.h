@@ -0,0 +1,101 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "IdpResponse.h"
+#include <functional>
+#include <memory>
+#include <stdbool.h>
+#include <stdint.h>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+
+class IdpRequestTask;
+
+typedef std::function<void(std::shared_ptr<IdpRequestTask> task)>
+    RequestContinuation;
+
+/**
+ *  IdpRequestTask
+ *
+ *  The pending result of IdpNode::SendRequestAsync. Completes on the
+ *  dispatcher with the response, or without one when the request could not
+ *  be sent or timed out. Continuations attached after completion run
+ *  immediately.
+ */
+class IdpRequestTask : public std::enable_shared_from_this<IdpRequestTask>
+{
+  public:
+    /**
+     * Instantiates a new instance of IdpRequestTask
+     */
+    IdpRequestTask ();
+    ~IdpRequestTask ();
+
+    static std::shared_ptr<IdpRequestTask> Create ();
+
+    /**
+     * Completes once every task has completed. It succeeds only if all of
+     * them received a response.
+     */
+    static std::shared_ptr<IdpRequestTask>
+        WhenAll (std::vector<std::shared_ptr<IdpRequestTask>> tasks);
+
+    bool IsCompleted ();
+
+    /**
+     * True when a response was received, whatever its response code.
+     */
+    bool IsSuccess ();
+
+    std::shared_ptr<IdpResponse> Response ();
+
+    std::shared_ptr<IdpRequestTask> Then (RequestContinuation continuation);
+
+    void Complete (std::shared_ptr<IdpResponse> response);
+
+    void Complete (bool success);
+
+#if defined(__cpp_impl_coroutine)
+    /**
+     * Lets toolchains with coroutine support co_await a request from their
+     * own coroutine types. Resumes on the dispatcher.
+     */
+    struct Awaiter
+    {
+        std::shared_ptr<IdpRequestTask> Task;
+
+        bool await_ready ()
+        {
+            return Task->IsCompleted ();
+        }
+
+        void await_suspend (std::coroutine_handle<> handle)
+        {
+            Task->Then ([handle](std::shared_ptr<IdpRequestTask>) {
+                handle.resume ();
+            });
+        }
+
+        std::shared_ptr<IdpResponse> await_resume ()
+        {
+            return Task->Response ();
+        }
+    };
+
+    friend Awaiter operator co_await (std::shared_ptr<IdpRequestTask> task)
+    {
+        return Awaiter{ task };
+    }
+#endif
+
+  private:
+    bool _isCompleted;
+    bool _isSuccess;
+    std::shared_ptr<IdpResponse> _response;
+    std::vector<RequestContinuation> _continuations;
+};
@@ -6,16 +6,67 @@
 #include <algorithm>
 
 static constexpr uint16_t AdaptorNone = 0xFFFF;
+static constexpr uint32_t DefaultPollIdleInterval = 1000;
+static constexpr uint32_t DefaultPollMaxInterval = 3000;
+static constexpr uint32_t DefaultEgressQueueLimit = 4096;
 
 IdpRouter::IdpRouter () : IdpNode (RouterGuid, "Network.Router")
 {
     _currentlyEnumeratingAdaptor = nullptr;
     _lastAdaptorId = -1;
+    _pollIdleInterval = DefaultPollIdleInterval;
+    _pollMaxInterval = DefaultPollMaxInterval;
+    _egressQueueLimit = DefaultEgressQueueLimit;
+    _generation = 0;
+    _pollRandom = 0;
+    _pollRandomAddress = UnassignedAddress;
+    _announcedGroups = 0;
+    _announcedAdaptorId = AdaptorNone;
 
     Manager ().RegisterCommand (
         static_cast<uint16_t> (NodeCommand::RouterPoll),
         [&](std::shared_ptr<IncomingTransaction> incoming,
             std::shared_ptr<OutgoingTransaction> outgoing) {
+            auto adaptor = _adaptors.find (_lastAdaptorId);
+
+            if (_lastAdaptorId != -1 && adaptor != _adaptors.end ())
+            {
+                auto& credits = adaptor->second->Credits ();
+
+                // The poller sends how much it has transmitted so bytes lost
+                // on the link do not leak credit, and gets our limit back.
+                // Its count was taken before the poll itself, which has
+                // already been counted here.
+                if (incoming->BytesRemaining () >= sizeof (uint32_t))
+                {
+                    credits.Resynchronise (incoming->Read<uint32_t> () +
+                                           incoming->Packet ()->Length ());
+                }
+
+                if (credits.ReceiveWindow () != 0)
+                {
+                    outgoing->Write (credits.Grant ());
+                }
+            }
+
+            return IdpResponseCode::OK;
+        });
+
+    Manager ().RegisterCommand (
+        static_cast<uint16_t> (NodeCommand::LinkCredit),
+        [&](std::shared_ptr<IncomingTransaction> incoming,
+            std::shared_ptr<OutgoingTransaction> outgoing) {
+            auto limit = incoming->Read<uint32_t> ();
+
+            auto adaptor = _adaptors.find (_lastAdaptorId);
+
+            if (_lastAdaptorId != -1 && adaptor != _adaptors.end ())
+            {
+                adaptor->second->Credits ().OnGranted (limit);
+
+                DrainEgress (adaptor->first);
+            }
+
             return IdpResponseCode::OK;
         });
 
@@ -93,11 +144,38 @@ IdpRouter::IdpRouter () : IdpNode (RouterGuid, "Network.Router")
                 _adaptors[_lastAdaptorId]->IsEnumerated (true);
 
                 _lastAdaptorId = -1;
+
+                // The remote end forgot our groups if it reset the link.
+                _announcedAdaptorId = AdaptorNone;
+
+                AnnounceGroups ();
             }
 
             return IdpResponseCode::OK;
         });
 
+    Manager ().RegisterCommand (
+        static_cast<uint16_t> (NodeCommand::JoinGroup),
+        [&](std::shared_ptr<IncomingTransaction> incoming,
+            std::shared_ptr<OutgoingTransaction> outgoing) {
+            auto groups = incoming->Read<uint64_t> ();
+
+            // Local nodes are asked for their groups directly, so only an
+            // announcement that came in on an adaptor is kept.
+            auto route = _routingTable.find (incoming->Source ());
+            auto adaptor = _adaptors.find (_lastAdaptorId);
+
+            if (route != _routingTable.end () &&
+                route->second == _lastAdaptorId && adaptor != _adaptors.end ())
+            {
+                adaptor->second->Groups (groups);
+            }
+
+            AnnounceGroups ();
+
+            return IdpResponseCode::OK;
+        });
+
     // Routers endpoint is themselves, routing tables will find the correct
     // adaptor.
     TransmitEndpoint (*this);
@@ -111,50 +189,323 @@ IdpRouter::~IdpRouter ()
 
 void IdpRouter::OnPollTimerTick ()
 {
+    // Before pinging, so the master hears about nodes that reset straight
+    // away.
+    if (ReclaimUnassignedNodes ())
+    {
+        OnTopologyChanged ();
+    }
+
     IdpNode::OnPollTimerTick ();
 
+    // Picks up nodes and links that went away without announcing it.
+    AnnounceGroups ();
+
+    auto currentTime = Application::GetApplicationTime ();
+
     auto it1 = _adaptors.begin ();
 
     while (it1 != _adaptors.end ())
     {
-        if (it1->second->IsEnumerated ())
+        auto adaptor = it1->second;
+
+        // A remote router that is heard from once every interval, such as
+        // by its Ping, has not gone quiet.
+        if (adaptor->IsEnumerated () && !adaptor->IsPollOutstanding () &&
+            currentTime - adaptor->LastRemoteActivity () >
+                GetPollInterval (*adaptor))
         {
-            auto outgoingTransaction = OutgoingTransaction ::Create (
-                static_cast<uint16_t> (NodeCommand::RouterPoll),
-                this->CreateTransactionId ());
+            PollAdaptor (*adaptor);
+        }
 
-            auto adaptor = it1->second;
+        DrainEgress (it1->first);
 
-            auto handler = [&, adaptor](std::shared_ptr<IdpResponse> response) {
-                if (response != nullptr &&
-                    response->ResponseCode () == IdpResponseCode::OK)
+        GrantCredits (*adaptor);
+
+        it1++;
+    }
+}
+
+uint32_t IdpRouter::GetPollInterval (IAdaptor& adaptor)
+{
+    uint32_t interval = _pollIdleInterval;
+
+    if (adaptor.IdlePolls () == 0)
+    {
+        return interval;
+    }
+
+    for (uint8_t i = 0; i < adaptor.IdlePolls () && interval < _pollMaxInterval;
+         i++)
+    {
+        interval *= 2;
+    }
+
+    if (interval > _pollMaxInterval)
+    {
+        interval = _pollMaxInterval;
+    }
+
+    // Jitter stops routers that came up together from backing off in lock
+    // step.
+    return interval - (interval / 4) * adaptor.PollJitter () / 0xFF;
+}
+
+uint8_t IdpRouter::NextPollJitter ()
+{
+    // Seeded from the address, as every router shares the same guid.
+    if (_pollRandomAddress != Address ())
+    {
+        _pollRandomAddress = Address ();
+        _pollRandom = (Address () * 2654435761u) | 1;
+    }
+
+    _pollRandom ^= _pollRandom << 13;
+    _pollRandom ^= _pollRandom >> 17;
+    _pollRandom ^= _pollRandom << 5;
+
+    return _pollRandom >> 24;
+}
+
+void IdpRouter::PollAdaptor (IAdaptor& adaptor)
+{
+    auto outgoingTransaction = OutgoingTransaction ::Create (
+        static_cast<uint16_t> (NodeCommand::RouterPoll),
+        this->CreateTransactionId ());
+
+    outgoingTransaction->Write (adaptor.Credits ().Transmitted ());
+
+    auto activityCount = adaptor.RemoteActivityCount ();
+    auto idlePolls = adaptor.IdlePolls ();
+    auto target = &adaptor;
+
+    auto handler = [&, target, activityCount,
+                    idlePolls](std::shared_ptr<IdpResponse> response) {
+        target->IsPollOutstanding (false);
+
+        if (response != nullptr &&
+            response->ResponseCode () == IdpResponseCode::OK)
+        {
+            auto source = response->Transaction ()->Source ();
+
+            if (response->Transaction ()->BytesRemaining () >=
+                sizeof (uint32_t))
+            {
+                target->Credits ().OnGranted (
+                    response->Transaction ()->Read<uint32_t> ());
+            }
+
+            if (target->RemoteAddress () != source)
+            {
+                if (target->RemoteAddress () != UnassignedAddress)
                 {
+                    OnTopologyChanged ();
                 }
-                else
+
+                target->RemoteAddress (source);
+                target->LastRemoteActivity (Application::GetApplicationTime ());
+                target->IdlePolls (0);
+            }
+            else if (activityCount == target->PolledActivityCount ())
+            {
+                // Nothing but poll responses have come from the remote router,
+                // so the link is idle and polling can back off.
+                if (idlePolls < 0xFF)
                 {
-                    adaptor->IsEnumerated (false);
+                    target->IdlePolls (idlePolls + 1);
                 }
-            };
+            }
+            else
+            {
+                target->IdlePolls (0);
+            }
 
+            target->PolledActivityCount (target->RemoteActivityCount ());
+        }
+        else
+        {
+            if (target->IsEnumerated ())
+            {
+                OnTopologyChanged ();
+            }
 
-            Manager ().RegisterOneTimeResponseHandler (
-                outgoingTransaction->TransactionId (), handler);
+            target->RemoteAddress (UnassignedAddress);
+            target->IdlePolls (0);
+            target->IsEnumerated (false);
+        }
+    };
 
-            auto result = it1->second->Transmit (
-                outgoingTransaction->ToPacket (Address (), RouterPollAddress));
+    Manager ().RegisterOneTimeResponseHandler (
+        outgoingTransaction->TransactionId (), handler);
 
-            if (!result)
-            {
-                Manager ().UnregisterOneTimeResponseHandler (
-                    outgoingTransaction->TransactionId ());
+    adaptor.IsPollOutstanding (true);
+    adaptor.PollJitter (NextPollJitter ());
 
-                it1->second->IsEnumerated (false);
+    auto result = TransmitOn (
+        adaptor, outgoingTransaction->ToPacket (Address (), RouterPollAddress));
 
-                Trace::WriteLine ("Failed to router ping");
-            }
+    if (!result)
+    {
+        Manager ().UnregisterOneTimeResponseHandler (
+            outgoingTransaction->TransactionId ());
+
+        if (adaptor.IsEnumerated ())
+        {
+            OnTopologyChanged ();
         }
-        it1++;
+
+        adaptor.IsPollOutstanding (false);
+        adaptor.RemoteAddress (UnassignedAddress);
+        adaptor.IdlePolls (0);
+        adaptor.IsEnumerated (false);
+
+        Trace::WriteLine ("Failed to router ping");
+    }
+}
+
+uint32_t IdpRouter::PollIdleInterval ()
+{
+    return _pollIdleInterval;
+}
+
+void IdpRouter::PollIdleInterval (uint32_t value)
+{
+    _pollIdleInterval = value;
+}
+
+uint32_t IdpRouter::PollMaxInterval ()
+{
+    return _pollMaxInterval;
+}
+
+void IdpRouter::PollMaxInterval (uint32_t value)
+{
+    _pollMaxInterval = value;
+}
+
+uint32_t IdpRouter::EgressQueueLimit ()
+{
+    return _egressQueueLimit;
+}
+
+void IdpRouter::EgressQueueLimit (uint32_t value)
+{
+    _egressQueueLimit = value;
+}
+
+uint32_t IdpRouter::EgressQueueLength (uint16_t adaptorId)
+{
+    auto queue = _egressQueues.find (adaptorId);
+
+    if (queue != _egressQueues.end ())
+    {
+        return queue->second.Bytes;
+    }
+
+    return 0;
+}
+
+bool IdpRouter::TransmitOn (IAdaptor& adaptor,
+                            std::shared_ptr<IdpPacket> packet)
+{
+    if (adaptor.Mtu () != 0 && packet->Length () > adaptor.Mtu ())
+    {
+        bool result = true;
+
+        for (auto& fragment :
+             adaptor.Fragmenter ().Fragment (packet, adaptor.Mtu ()))
+        {
+            adaptor.Credits ().OnTransmitted (fragment->Length ());
+
+            result = adaptor.Transmit (fragment) && result;
+        }
+
+        return result;
+    }
+
+    adaptor.Credits ().OnTransmitted (packet->Length ());
+
+    return adaptor.Transmit (packet);
+}
+
+bool IdpRouter::Egress (uint16_t adaptorId, std::shared_ptr<IdpPacket> packet,
+                        uint16_t ingressId)
+{
+    auto adaptor = _adaptors[adaptorId];
+    auto& queue = _egressQueues[adaptorId];
+
+    if (queue.Packets.empty () && adaptor->Credits ().CanTransmit ())
+    {
+        return TransmitOn (*adaptor, packet);
+    }
+
+    if (queue.Bytes + packet->Length () > _egressQueueLimit)
+    {
+        Trace::WriteLine ("Packet Dropped: Egress queue full", "IdpRouter");
+        return false;
     }
+
+    queue.Packets.push_back ({packet, ingressId});
+    queue.Bytes += packet->Length ();
+
+    // Credit is only returned to the sending link once the packet leaves.
+    auto ingress = _adaptors.find (ingressId);
+
+    if (ingress != _adaptors.end ())
+    {
+        ingress->second->Credits ().OnBuffered (packet->Length ());
+    }
+
+    return true;
+}
+
+void IdpRouter::DrainEgress (uint16_t adaptorId)
+{
+    auto queue = _egressQueues.find (adaptorId);
+
+    if (queue == _egressQueues.end ())
+    {
+        return;
+    }
+
+    auto adaptor = _adaptors[adaptorId];
+
+    while (!queue->second.Packets.empty () && adaptor->Credits ().CanTransmit ())
+    {
+        auto entry = queue->second.Packets.front ();
+
+        queue->second.Packets.pop_front ();
+        queue->second.Bytes -= entry.Packet->Length ();
+
+        entry.Packet->ResetRead ();
+
+        TransmitOn (*adaptor, entry.Packet);
+
+        auto ingress = _adaptors.find (entry.IngressId);
+
+        if (ingress != _adaptors.end ())
+        {
+            ingress->second->Credits ().OnReleased (entry.Packet->Length ());
+
+            GrantCredits (*ingress->second);
+        }
+    }
+}
+
+void IdpRouter::GrantCredits (IAdaptor& adaptor)
+{
+    if (Address () == UnassignedAddress || !adaptor.IsEnumerated () ||
+        !adaptor.Credits ().ShouldGrant ())
+    {
+        return;
+    }
+
+    auto grant = OutgoingTransaction::Create (
+                     static_cast<uint16_t> (NodeCommand::LinkCredit),
+                     CreateTransactionId (), IdpCommandFlags::None)
+                     ->Write (adaptor.Credits ().Grant ());
+
+    SendRequest (adaptor, Address (), RouterPollAddress, grant);
 }
 
 void IdpRouter::OnReset ()
@@ -184,14 +535,19 @@ void IdpRouter::OnReset ()
         it1++;
     }
 
+    _announcedGroups = 0;
+    _announcedAdaptorId = AdaptorNone;
+
+    OnTopologyChanged ();
+
     IdpNode::OnReset ();
 }
 
-bool IdpRouter::SendRequest (IPacketTransmit& adaptor, uint16_t source,
+bool IdpRouter::SendRequest (IAdaptor& adaptor, uint16_t source,
                              uint16_t destination,
                              std::shared_ptr<OutgoingTransaction> request)
 {
-    return adaptor.Transmit (request->ToPacket (source, destination));
+    return TransmitOn (adaptor, request->ToPacket (source, destination));
 }
 
 IdpNode* IdpRouter::FindNode (uint16_t address)
@@ -216,6 +572,8 @@ bool IdpRouter::AddAdaptor (IAdaptor& adaptor)
 
     _nextAdaptorId++;
 
+    OnTopologyChanged ();
+
     return true;
 }
 
@@ -243,6 +601,8 @@ bool IdpRouter::AddNode (IdpNode& node)
     if (result)
     {
         node.TransmitEndpoint (*this);
+
+        OnTopologyChanged ();
     }
 
     node.Enabled (true);
@@ -267,6 +627,8 @@ void IdpRouter::RemoveNode (IdpNode& node)
     }
 
     node.Address (UnassignedAddress);
+
+    OnTopologyChanged ();
 }
 
 bool IdpRouter::MarkEnumerated (IdpNode& node)
@@ -285,6 +647,8 @@ bool IdpRouter::MarkEnumerated (IdpNode& node)
 
         _enumeratedNodes[node.Address ()] = &node;
 
+        AnnounceGroups ();
+
         result = true;
     }
 
@@ -307,10 +671,10 @@ bool IdpRouter::Transmit (std::shared_ptr<IdpPacket> packet)
     return Transmit (AdaptorNone, packet);
 }
 
-IdpResponseCode IdpRouter::HandleEnumerateNodesCommand (
-    uint16_t source, uint16_t address,
-    std::shared_ptr<OutgoingTransaction> outgoing)
+bool IdpRouter::ReclaimUnassignedNodes ()
 {
+    bool result = false;
+
     auto it = _enumeratedNodes.begin ();
 
     while (it != _enumeratedNodes.end ())
@@ -319,6 +683,8 @@ IdpResponseCode IdpRouter::HandleEnumerateNodesCommand (
         {
             MarkUnenumerated (*it->second);
             it = _enumeratedNodes.erase (it);
+
+            result = true;
         }
         else
         {
@@ -326,6 +692,35 @@ IdpResponseCode IdpRouter::HandleEnumerateNodesCommand (
         }
     }
 
+    return result;
+}
+
+void IdpRouter::OnTopologyChanged ()
+{
+    _generation++;
+}
+
+uint32_t IdpRouter::Generation ()
+{
+    return _generation;
+}
+
+std::shared_ptr<OutgoingTransaction> IdpRouter::CreatePing ()
+{
+    return IdpNode::CreatePing ()->Write (_generation);
+}
+
+void IdpRouter::OnAdaptorActiveChanged (uint16_t adaptorId)
+{
+    OnTopologyChanged ();
+}
+
+IdpResponseCode IdpRouter::HandleEnumerateNodesCommand (
+    uint16_t source, uint16_t address,
+    std::shared_ptr<OutgoingTransaction> outgoing)
+{
+    ReclaimUnassignedNodes ();
+
     if (!_unenumeratedNodes.empty ())
     {
         auto& node = *_unenumeratedNodes.back ();
@@ -436,26 +831,221 @@ IAdaptor* IdpRouter::GetNextUnenumeratedAdaptor (bool reenumeration)
     return nullptr;
 }
 
+void IdpRouter::LearnRoute (uint16_t adaptorId, uint16_t source)
+{
+    _lastAdaptorId = adaptorId;
+
+    if (!(source == 1 && _routingTable.find (source) != _routingTable.end ()))
+    {
+        _routingTable[source] = adaptorId; // replace any existing route with
+                                           // the one the packet just came from.
+    }
+}
+
 bool IdpRouter::Transmit (uint16_t adaptorId, std::shared_ptr<IdpPacket> packet)
 {
     auto source = packet->Source ();
 
     if (source != UnassignedAddress && adaptorId != 0xFFFF)
     {
-        _lastAdaptorId = adaptorId;
+        LearnRoute (adaptorId, source);
+
+        auto adaptor = _adaptors.find (adaptorId);
 
-        if (!(source == 1 &&
-              _routingTable.find (source) != _routingTable.end ()))
+        if (adaptor != _adaptors.end ())
         {
-            _routingTable[source] =
-                adaptorId; // replace any existing route with
-                           // the one the packet just came from.
+            auto result = Route (packet);
+
+            GrantCredits (*adaptor->second);
+
+            return result;
         }
     }
 
     return Route (packet);
 }
 
+IAdaptor* IdpRouter::ResolveCutThrough (uint16_t adaptorId, uint16_t source,
+                                        uint16_t destination, uint32_t length)
+{
+    if (source == UnassignedAddress || Address () == UnassignedAddress)
+    {
+        return nullptr;
+    }
+
+    LearnRoute (adaptorId, source);
+
+    // Anything this router or its nodes need to process is reassembled.
+    if (destination == 0 || destination == UnassignedAddress ||
+        destination == RouterPollAddress || destination == Address () ||
+        IsMulticastAddress (destination) || FindNode (destination) != nullptr)
+    {
+        return nullptr;
+    }
+
+    auto route = _routingTable.find (destination);
+
+    if (route == _routingTable.end () || route->second == adaptorId)
+    {
+        return nullptr;
+    }
+
+    auto egress = _adaptors.find (route->second);
+
+    // Packets waiting for credit must leave first, and packets that need
+    // fragmenting are received in full.
+    if (egress == _adaptors.end () || EgressQueueLength (egress->first) != 0 ||
+        !egress->second->Credits ().CanTransmit () ||
+        (egress->second->Mtu () != 0 && length > egress->second->Mtu ()))
+    {
+        return nullptr;
+    }
+
+    if (egress->second->BeginForward ())
+    {
+        egress->second->Credits ().OnTransmitted (length);
+
+        auto ingress = _adaptors.find (adaptorId);
+
+        if (ingress != _adaptors.end ())
+        {
+            ingress->second->Credits ().OnReceived (length);
+        }
+
+        return egress->second;
+    }
+
+    return nullptr;
+}
+
+uint64_t IdpRouter::MemberGroups (uint16_t upstreamId)
+{
+    uint64_t result = Groups ();
+
+    for (auto& node : _enumeratedNodes)
+    {
+        result |= node.second->Groups ();
+    }
+
+    for (auto& adaptor : _adaptors)
+    {
+        if (adaptor.first != upstreamId)
+        {
+            result |= adaptor.second->Groups ();
+        }
+    }
+
+    return result;
+}
+
+void IdpRouter::AnnounceGroups ()
+{
+    auto upstream = FindNode (1) == nullptr ? _routingTable.find (1)
+                                            : _routingTable.end ();
+
+    if (Address () == UnassignedAddress || upstream == _routingTable.end ())
+    {
+        return;
+    }
+
+    auto adaptor = _adaptors.find (upstream->second);
+
+    // Announced once the link is marked connected.
+    if (adaptor == _adaptors.end () || !adaptor->second->IsEnumerated ())
+    {
+        return;
+    }
+
+    auto groups = MemberGroups (adaptor->first);
+
+    // Only changes are sent, as the remote router keeps the last set.
+    if (groups == _announcedGroups && adaptor->first == _announcedAdaptorId)
+    {
+        return;
+    }
+
+    _announcedGroups = groups;
+    _announcedAdaptorId = adaptor->first;
+
+    auto announcement = OutgoingTransaction::Create (
+                            static_cast<uint16_t> (NodeCommand::JoinGroup),
+                            CreateTransactionId (), IdpCommandFlags::None)
+                            ->Write (groups);
+
+    SendRequest (*adaptor->second, Address (), RouterPollAddress,
+                 announcement);
+}
+
+bool IdpRouter::RouteMulticast (std::shared_ptr<IdpPacket> packet)
+{
+    auto source = packet->Source ();
+    auto destination = packet->Destination ();
+    auto mask = MulticastGroupMask (destination);
+
+    auto receivedOn = _routingTable.find (source);
+
+    // Group traffic always travels towards the master so that it can reach
+    // members in other branches, and otherwise only into subtrees with
+    // members.
+    auto upstream = FindNode (1) == nullptr ? _routingTable.find (1)
+                                            : _routingTable.end ();
+
+    auto ait = _adaptors.begin ();
+
+    while (ait != _adaptors.end ())
+    {
+        bool isReceivedOn =
+            receivedOn != _routingTable.end () && receivedOn->second == ait->first;
+
+        bool isUpstream =
+            upstream != _routingTable.end () && upstream->second == ait->first;
+
+        if (!isReceivedOn && (isUpstream || (ait->second->Groups () & mask)))
+        {
+            packet->ResetRead ();
+
+            TransmitOn (*ait->second, packet);
+        }
+
+        ait++;
+    }
+
+    auto it = _enumeratedNodes.begin ();
+
+    while (it != _enumeratedNodes.end ())
+    {
+        auto node = it->second;
+
+        it++;
+
+        if (node->Address () != source && node->IsGroupMember (destination))
+        {
+            packet->ResetRead ();
+
+            auto response = node->ProcessPacket (packet);
+
+            if (response != nullptr)
+            {
+                Route (response);
+            }
+        }
+    }
+
+    if (IsGroupMember (destination))
+    {
+        packet->ResetRead ();
+
+        auto response = ProcessPacket (packet);
+
+        if (response != nullptr)
+        {
+            Route (response);
+        }
+    }
+
+    return true;
+}
+
 bool IdpRouter::Route (std::shared_ptr<IdpPacket> packet)
 {
     auto source = packet->Source ();
@@ -511,7 +1101,11 @@ bool IdpRouter::Route (std::shared_ptr<IdpPacket> packet)
 
     packet->ResetRead ();
 
-    if (destination == 0)
+    if (IsMulticastAddress (destination))
+    {
+        return RouteMulticast (packet);
+    }
+    else if (destination == 0)
     {
         auto ait = _adaptors.begin ();
 
@@ -524,7 +1118,7 @@ bool IdpRouter::Route (std::shared_ptr<IdpPacket> packet)
             {
                 packet->ResetRead ();
 
-                ait->second->Transmit (packet);
+                TransmitOn (*ait->second, packet);
             }
 
             ait++;
@@ -560,14 +1154,28 @@ bool IdpRouter::Route (std::shared_ptr<IdpPacket> packet)
     else if (destination == RouterPollAddress &&
              Address () != UnassignedAddress)
     {
+        auto ingressId = _lastAdaptorId;
+
         auto response = ProcessPacket (packet);
 
-        if (response != nullptr)
+        if (response == nullptr)
         {
-            return Route (response);
+            return false;
         }
 
-        return false;
+        // Link-local answers, such as poll responses carrying credit, go
+        // straight back over the link ahead of data waiting for credit, or
+        // a busy link would stop answering its polls.
+        auto route = _routingTable.find (source);
+        auto ingress = _adaptors.find (ingressId);
+
+        if (route != _routingTable.end () && route->second == ingressId &&
+            ingress != _adaptors.end ())
+        {
+            return TransmitOn (*ingress->second, response);
+        }
+
+        return Route (response);
     }
     else
     {
@@ -603,7 +1211,10 @@ bool IdpRouter::Route (std::shared_ptr<IdpPacket> packet)
 
                 if (receivedOn != it) // not sure if this is correct.
                 {
-                    return _adaptors[it->second]->Transmit (packet);
+                    return Egress (it->second, packet,
+                                   receivedOn != _routingTable.end ()
+                                       ? receivedOn->second
+                                       : AdaptorNone);
                 }
             }
             else if (destination != UnassignedAddress)
@@ -10,6 +10,22 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/**
+ * A packet held back until its egress adaptor has credit, along with the
+ * adaptor it arrived on so that credit can be returned when it leaves.
+ */
+struct EgressEntry
+{
+    std::shared_ptr<IdpPacket> Packet;
+    uint16_t IngressId;
+};
+
+struct EgressQueue
+{
+    std::list<EgressEntry> Packets;
+    uint32_t Bytes;
+};
+
 /**
  *  IdpRouter
  */
@@ -30,11 +46,29 @@ class IdpRouter : public IdpNode,
 
     uint16_t _nextAdaptorId;
 
+    uint32_t _pollIdleInterval;
+    uint32_t _pollMaxInterval;
+
+    std::map<uint16_t, EgressQueue> _egressQueues;
+    uint32_t _egressQueueLimit;
+
+    uint32_t _generation;
+
+    uint32_t _pollRandom;
+    uint16_t _pollRandomAddress;
+
+    uint64_t _announcedGroups;
+    uint16_t _announcedAdaptorId;
+
     virtual void OnReset ();
 
 
     IdpNode* FindNode (uint16_t address);
 
+    bool ReclaimUnassignedNodes ();
+
+    void OnTopologyChanged ();
+
     IdpResponseCode HandleEnumerateNodesCommand (
         uint16_t source, uint16_t address,
         std::shared_ptr<OutgoingTransaction> outgoing);
@@ -43,12 +77,35 @@ class IdpRouter : public IdpNode,
         uint16_t source, uint16_t address, uint32_t transactionId,
         std::shared_ptr<OutgoingTransaction> outgoing);
 
-    bool SendRequest (IPacketTransmit& adaptor, uint16_t source,
+    bool SendRequest (IAdaptor& adaptor, uint16_t source,
                       uint16_t destination,
                       std::shared_ptr<OutgoingTransaction> request);
 
     IAdaptor* GetNextUnenumeratedAdaptor (bool reenumeration = false);
 
+    uint32_t GetPollInterval (IAdaptor& adaptor);
+
+    uint8_t NextPollJitter ();
+
+    void PollAdaptor (IAdaptor& adaptor);
+
+    void LearnRoute (uint16_t adaptorId, uint16_t source);
+
+    uint64_t MemberGroups (uint16_t upstreamId);
+
+    virtual void AnnounceGroups () override;
+
+    bool RouteMulticast (std::shared_ptr<IdpPacket> packet);
+
+    bool TransmitOn (IAdaptor& adaptor, std::shared_ptr<IdpPacket> packet);
+
+    bool Egress (uint16_t adaptorId, std::shared_ptr<IdpPacket> packet,
+                 uint16_t ingressId);
+
+    void DrainEgress (uint16_t adaptorId);
+
+    void GrantCredits (IAdaptor& adaptor);
+
   public:
     /**
      * Instantiates a new instance of IdpRouter
@@ -61,6 +118,9 @@ class IdpRouter : public IdpNode,
 
     bool Transmit (uint16_t adaptorId, std::shared_ptr<IdpPacket> packet);
 
+    IAdaptor* ResolveCutThrough (uint16_t adaptorId, uint16_t source,
+                                 uint16_t destination, uint32_t length);
+
     bool MarkEnumerated (IdpNode& node);
     void MarkUnenumerated (IdpNode& node);
 
@@ -72,4 +132,41 @@ class IdpRouter : public IdpNode,
     bool Route (std::shared_ptr<IdpPacket> packet);
 
     void OnPollTimerTick ();
+
+    std::shared_ptr<OutgoingTransaction> CreatePing ();
+
+    void OnAdaptorActiveChanged (uint16_t adaptorId);
+
+    /**
+     * Counts changes to the nodes and links of this router that the master
+     * did not make itself, such as a node being added or resetting or a link
+     * going down. It is sent with every Ping so the master only enumerates
+     * routers again once it has moved.
+     */
+    uint32_t Generation ();
+
+    /**
+     * Time an adaptor may go without receiving any traffic before the router
+     * explicitly polls it.
+     */
+    uint32_t PollIdleInterval ();
+    void PollIdleInterval (uint32_t value);
+
+    /**
+     * Upper bound for the poll interval of a link that stays idle.
+     */
+    uint32_t PollMaxInterval ();
+    void PollMaxInterval (uint32_t value);
+
+    /**
+     * Bytes that may be held per adaptor while it waits for credit from the
+     * remote end. Packets beyond this are dropped.
+     */
+    uint32_t EgressQueueLimit ();
+    void EgressQueueLimit (uint32_t value);
+
+    /**
+     * Bytes currently held for the adaptor.
+     */
+    uint32_t EgressQueueLength (uint16_t adaptorId);
 };
@@ -0,0 +1,150 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "IdpScheduler.h"
+#include "Application.h"
+
+IdpScheduler* IdpScheduler::s_instance = nullptr;
+
+constexpr uint32_t IdpScheduler::InvalidHandle;
+constexpr uint32_t IdpScheduler::Resolution;
+
+IdpScheduler& IdpScheduler::Instance ()
+{
+    if (s_instance == nullptr)
+    {
+        s_instance = new IdpScheduler ();
+    }
+
+    return *s_instance;
+}
+
+void IdpScheduler::Initialise ()
+{
+    auto& scheduler = Instance ();
+
+    scheduler.StopTimer ();
+
+    // Generations keep counting so ids handed out before are never reused.
+    scheduler._freeTargets.clear ();
+
+    for (uint32_t i = 0; i < scheduler._targets.size (); i++)
+    {
+        scheduler._targets[i].Target = nullptr;
+        scheduler._targets[i].Generation++;
+
+        scheduler._freeTargets.push_back ((uint16_t) i);
+    }
+
+    scheduler._wheel = TimerWheel ();
+
+    scheduler.StartTimer ();
+}
+
+IdpScheduler::IdpScheduler ()
+{
+    _timer = nullptr;
+    _timerHandler = nullptr;
+
+    StartTimer ();
+}
+
+IdpScheduler::~IdpScheduler ()
+{
+    StopTimer ();
+}
+
+void IdpScheduler::StartTimer ()
+{
+    _timer = new DispatcherTimer (Resolution);
+
+    _timerHandler =
+        &(_timer->Tick += [&](auto sender, auto& e) { this->OnTick (); });
+
+    _timer->Start ();
+}
+
+void IdpScheduler::StopTimer ()
+{
+    if (_timer != nullptr)
+    {
+        if (_timerHandler != nullptr)
+        {
+            _timer->Tick -= *_timerHandler;
+            _timerHandler = nullptr;
+        }
+
+        _timer->Stop ();
+        delete _timer;
+        _timer = nullptr;
+    }
+}
+
+uint32_t IdpScheduler::Register (ISchedulerTarget& target)
+{
+    uint16_t slot;
+
+    if (!_freeTargets.empty ())
+    {
+        slot = _freeTargets.back ();
+        _freeTargets.pop_back ();
+    }
+    else
+    {
+        slot = (uint16_t) _targets.size ();
+        _targets.push_back ({ nullptr, 0 });
+    }
+
+    _targets[slot].Target = &target;
+
+    return ((uint32_t) _targets[slot].Generation << 16) | slot;
+}
+
+void IdpScheduler::Unregister (uint32_t targetId)
+{
+    auto slot = targetId & 0xFFFF;
+
+    if (slot < _targets.size () &&
+        _targets[slot].Generation == (targetId >> 16) &&
+        _targets[slot].Target != nullptr)
+    {
+        // Bumping the generation turns pending deadlines for the old target
+        // into no-ops.
+        _targets[slot].Target = nullptr;
+        _targets[slot].Generation++;
+
+        _freeTargets.push_back ((uint16_t) slot);
+    }
+}
+
+uint32_t IdpScheduler::Schedule (uint32_t targetId, uint32_t cookie,
+                                 uint64_t expiry)
+{
+    return _wheel.Schedule (Application::GetApplicationTime (), expiry,
+                            ((uint64_t) targetId << 32) | cookie);
+}
+
+void IdpScheduler::Cancel (uint32_t handle)
+{
+    _wheel.Cancel (handle);
+}
+
+uint32_t IdpScheduler::Pending ()
+{
+    return _wheel.Count ();
+}
+
+void IdpScheduler::OnTick ()
+{
+    _wheel.Advance (Application::GetApplicationTime (), [&](uint64_t id) {
+        auto targetId = (uint32_t) (id >> 32);
+        auto slot = targetId & 0xFFFF;
+
+        if (slot < _targets.size () &&
+            _targets[slot].Generation == (targetId >> 16) &&
+            _targets[slot].Target != nullptr)
+        {
+            _targets[slot].Target->OnScheduled ((uint32_t) id);
+        }
+    });
+}
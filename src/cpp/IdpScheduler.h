@@ -0,0 +1,90 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "DispatcherTimer.h"
+#include "TimerWheel.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Receives the deadlines it scheduled with IdpScheduler.
+ */
+class ISchedulerTarget
+{
+  public:
+    virtual ~ISchedulerTarget ()
+    {
+    }
+
+    virtual void OnScheduled (uint32_t cookie) = 0;
+};
+
+/**
+ *  IdpScheduler
+ *
+ *  Process wide deadline scheduler shared by every node and command manager.
+ *  A single dispatcher timer advances one timer wheel, so every deadline due
+ *  in the same tick is handled in one batch and the cost of a tick depends on
+ *  the deadlines that fire rather than on the number of nodes.
+ */
+class IdpScheduler
+{
+  public:
+    static constexpr uint32_t InvalidHandle = TimerWheel::InvalidHandle;
+
+    /**
+     * Interval of the dispatcher timer that drives the scheduler.
+     */
+    static constexpr uint32_t Resolution = 10;
+
+    static IdpScheduler& Instance ();
+
+    /**
+     * Drops every target and deadline and restarts the dispatcher timer.
+     * Needed after the dispatcher timers have been re-initialised.
+     */
+    static void Initialise ();
+
+    /**
+     * Registers a target and returns the id used to schedule deadlines for
+     * it. Deadlines still pending when the target is unregistered are
+     * discarded when they fall due.
+     */
+    uint32_t Register (ISchedulerTarget& target);
+    void Unregister (uint32_t targetId);
+
+    uint32_t Schedule (uint32_t targetId, uint32_t cookie, uint64_t expiry);
+
+    void Cancel (uint32_t handle);
+
+    /**
+     * Number of deadlines waiting to fall due.
+     */
+    uint32_t Pending ();
+
+  private:
+    IdpScheduler ();
+    ~IdpScheduler ();
+
+    void StartTimer ();
+    void StopTimer ();
+
+    void OnTick ();
+
+    struct Registration
+    {
+        ISchedulerTarget* Target;
+        uint16_t Generation;
+    };
+
+    std::vector<Registration> _targets;
+    std::vector<uint16_t> _freeTargets;
+    TimerWheel _wheel;
+    DispatcherTimer* _timer;
+    EventHandler* _timerHandler;
+
+    static IdpScheduler* s_instance;
+};
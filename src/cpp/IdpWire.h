@@ -0,0 +1,93 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "BitConverter.h"
+#include <cstring>
+#include <stdint.h>
+
+/**
+ *  IdpWire
+ *
+ *  Network order loads and stores at fixed offsets, used by the serializers
+ *  tools/idpgen.py generates. Each one is a memcpy and a byte swap, which
+ *  the compiler reduces to an unaligned move and a bswap.
+ */
+struct IdpWire
+{
+    template <typename T>
+    static void Store (uint8_t* buffer, T value)
+    {
+        if (BitConverter::IsLittleEndian ())
+        {
+            value = BitConverter::SwapEndian (value);
+        }
+
+        memcpy (buffer, &value, sizeof (T));
+    }
+
+    template <typename T>
+    static T Load (const uint8_t* buffer)
+    {
+        T value;
+
+        memcpy (&value, buffer, sizeof (T));
+
+        if (BitConverter::IsLittleEndian ())
+        {
+            value = BitConverter::SwapEndian (value);
+        }
+
+        return value;
+    }
+
+    static void Store (uint8_t* buffer, bool value)
+    {
+        *buffer = value ? 1 : 0;
+    }
+
+    static void Store (uint8_t* buffer, float value)
+    {
+        uint32_t bits;
+
+        memcpy (&bits, &value, sizeof (bits));
+        Store (buffer, bits);
+    }
+
+    static void Store (uint8_t* buffer, double value)
+    {
+        uint64_t bits;
+
+        memcpy (&bits, &value, sizeof (bits));
+        Store (buffer, bits);
+    }
+};
+
+template <>
+inline bool IdpWire::Load<bool> (const uint8_t* buffer)
+{
+    return *buffer != 0;
+}
+
+template <>
+inline float IdpWire::Load<float> (const uint8_t* buffer)
+{
+    auto bits = Load<uint32_t> (buffer);
+    float value;
+
+    memcpy (&value, &bits, sizeof (value));
+
+    return value;
+}
+
+template <>
+inline double IdpWire::Load<double> (const uint8_t* buffer)
+{
+    auto bits = Load<uint64_t> (buffer);
+    double value;
+
+    memcpy (&value, &bits, sizeof (value));
+
+    return value;
+}
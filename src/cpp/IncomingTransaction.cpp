@@ -98,6 +98,49 @@ const char* IncomingTransaction::ReadCString ()
     return result;
 }
 
+StringView IncomingTransaction::ReadStringView ()
+{
+    StringView result;
+
+    if (!TryReadStringView (result))
+    {
+        ThrowException (-1, "Unterminated string in IDP packet");
+    }
+
+    return result;
+}
+
+bool IncomingTransaction::TryReadStringView (StringView& value)
+{
+    if (_readIndex >= _readLimit)
+    {
+        return false;
+    }
+
+    auto start = (const char*) (_data.get () + _readIndex);
+    auto terminator = static_cast<const char*> (
+        memchr (start, '\0', _readLimit - _readIndex));
+
+    if (terminator == nullptr)
+    {
+        return false;
+    }
+
+    uint32_t length = terminator - start;
+
+    _readIndex += length + 1;
+
+    value = StringView (start, length);
+
+    return true;
+}
+
+ByteView IncomingTransaction::ConsumeSpan (uint32_t length)
+{
+    return ByteView (static_cast<const uint8_t*> (ConsumeData (length)),
+                     length);
+}
+
 Guid_t IncomingTransaction::ReadGuid ()
 {
     auto data1 = Read<uint32_t> ();
@@ -125,6 +168,11 @@ void* IncomingTransaction::ConsumeData(uint32_t length)
     return data;
 }
 
+uint32_t IncomingTransaction::BytesRemaining ()
+{
+    return _readIndex > _readLimit ? 0 : _readLimit - _readIndex;
+}
+
 void IncomingTransaction::EnsureReadable (uint32_t length)
 {
     if (_readIndex > _readLimit || length > (_readLimit - _readIndex))
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "BitConverter.h"
+#include "BufferViews.h"
 #include "Exception.h"
 #include "Guid.h"
 #include "IdpPacket.h"
@@ -67,8 +68,46 @@ class IncomingTransaction
      */
     const char* ReadCString ();
 
+    /**
+     * Reads a UTF8 encoded string without copying it. The view is valid
+     * while this transaction or its packet is alive.
+     */
+    StringView ReadStringView ();
+
+    /**
+     * As ReadStringView, but returns false instead of throwing if the
+     * string is not terminated within the transaction.
+     */
+    bool TryReadStringView (StringView& value);
+
+    /**
+     * Reads count network order elements without copying them. The view is
+     * valid while this transaction or its packet is alive.
+     */
+    template <typename T>
+    ArrayView<T> ReadArrayView (uint32_t count)
+    {
+        if (count > UINT32_MAX / sizeof (T))
+        {
+            ThrowException (-1, "IDP packet read out of bounds");
+        }
+
+        return ArrayView<T> (
+            static_cast<const uint8_t*> (ConsumeData (count * sizeof (T))),
+            count);
+    }
+
+    /**
+     * Bounds checked ConsumeData returning the bytes as a view.
+     */
+    ByteView ConsumeSpan (uint32_t length);
+
     Guid_t ReadGuid ();
 
+    /**
+     * Number of payload bytes that have not been read yet.
+     */
+    uint32_t BytesRemaining ();
 
     uint16_t Source ();
     uint16_t Destination ();
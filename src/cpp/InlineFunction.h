@@ -0,0 +1,154 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename TSignature, std::size_t Capacity = 64>
+class InlineFunction;
+
+/**
+ * Move-only callable that stores its target in a fixed inline buffer. It
+ * never allocates; a target that does not fit is rejected at compile time
+ * rather than moved to the heap.
+ */
+template <typename TResult, typename... TArgs, std::size_t Capacity>
+class InlineFunction<TResult (TArgs...), Capacity>
+{
+  public:
+    InlineFunction () noexcept : _invoke (nullptr), _manage (nullptr)
+    {
+    }
+
+    InlineFunction (std::nullptr_t) noexcept : InlineFunction ()
+    {
+    }
+
+    template <typename TFunctor,
+              typename = typename std::enable_if<!std::is_same<
+                  typename std::decay<TFunctor>::type,
+                  InlineFunction>::value>::type>
+    InlineFunction (TFunctor&& functor)
+    {
+        typedef typename std::decay<TFunctor>::type TTarget;
+
+        static_assert (sizeof (TTarget) <= Capacity,
+                       "Target does not fit the inline buffer.");
+        static_assert (alignof (TTarget) <= alignof (Storage),
+                       "Target is over-aligned for the inline buffer.");
+
+        ::new (&_storage) TTarget (std::forward<TFunctor> (functor));
+
+        _invoke = &Invoke<TTarget>;
+        _manage = &Manage<TTarget>;
+    }
+
+    InlineFunction (InlineFunction&& other) noexcept
+        : _invoke (nullptr), _manage (nullptr)
+    {
+        MoveFrom (other);
+    }
+
+    InlineFunction& operator= (InlineFunction&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset ();
+            MoveFrom (other);
+        }
+
+        return *this;
+    }
+
+    InlineFunction& operator= (std::nullptr_t) noexcept
+    {
+        Reset ();
+
+        return *this;
+    }
+
+    InlineFunction (const InlineFunction&) = delete;
+    InlineFunction& operator= (const InlineFunction&) = delete;
+
+    ~InlineFunction ()
+    {
+        Reset ();
+    }
+
+    explicit operator bool () const noexcept
+    {
+        return _invoke != nullptr;
+    }
+
+    TResult operator() (TArgs... args)
+    {
+        return _invoke (&_storage, std::forward<TArgs> (args)...);
+    }
+
+    void Reset () noexcept
+    {
+        if (_manage != nullptr)
+        {
+            _manage (Operation::Destroy, &_storage, nullptr);
+
+            _invoke = nullptr;
+            _manage = nullptr;
+        }
+    }
+
+  private:
+    typedef typename std::aligned_storage<Capacity,
+                                          alignof (std::max_align_t)>::type
+        Storage;
+
+    enum class Operation
+    {
+        Move,
+        Destroy
+    };
+
+    template <typename TTarget>
+    static TResult Invoke (void* storage, TArgs... args)
+    {
+        return (*static_cast<TTarget*> (storage)) (
+            std::forward<TArgs> (args)...);
+    }
+
+    template <typename TTarget>
+    static void Manage (Operation operation, void* destination, void* source)
+    {
+        if (operation == Operation::Move)
+        {
+            auto target = static_cast<TTarget*> (source);
+
+            ::new (destination) TTarget (std::move (*target));
+            target->~TTarget ();
+        }
+        else
+        {
+            static_cast<TTarget*> (destination)->~TTarget ();
+        }
+    }
+
+    void MoveFrom (InlineFunction& other) noexcept
+    {
+        if (other._manage != nullptr)
+        {
+            other._manage (Operation::Move, &_storage, &other._storage);
+
+            _invoke = other._invoke;
+            _manage = other._manage;
+
+            other._invoke = nullptr;
+            other._manage = nullptr;
+        }
+    }
+
+    Storage _storage;
+    TResult (*_invoke) (void* storage, TArgs... args);
+    void (*_manage) (Operation operation, void* destination, void* source);
+};
@@ -0,0 +1,106 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "LinkCredits.h"
+
+LinkCredits::LinkCredits ()
+{
+    _isLimited = false;
+    _transmitted = 0;
+    _limit = 0;
+
+    _receiveWindow = 0;
+    _received = 0;
+    _buffered = 0;
+    _granted = 0;
+}
+
+LinkCredits::~LinkCredits ()
+{
+}
+
+bool LinkCredits::IsLimited ()
+{
+    return _isLimited;
+}
+
+bool LinkCredits::CanTransmit ()
+{
+    return !_isLimited || (int32_t) (_limit - _transmitted) > 0;
+}
+
+void LinkCredits::OnTransmitted (uint32_t length)
+{
+    _transmitted += length;
+}
+
+void LinkCredits::OnGranted (uint32_t limit)
+{
+    // Grants may arrive out of order, never move the limit backwards.
+    if (!_isLimited || (int32_t) (limit - _limit) > 0)
+    {
+        _limit = limit;
+    }
+
+    _isLimited = true;
+}
+
+void LinkCredits::Unlimit ()
+{
+    _isLimited = false;
+}
+
+uint32_t LinkCredits::Transmitted ()
+{
+    return _transmitted;
+}
+
+uint32_t LinkCredits::ReceiveWindow ()
+{
+    return _receiveWindow;
+}
+
+void LinkCredits::ReceiveWindow (uint32_t value)
+{
+    _receiveWindow = value;
+}
+
+void LinkCredits::OnReceived (uint32_t length)
+{
+    _received += length;
+}
+
+void LinkCredits::OnBuffered (uint32_t length)
+{
+    _buffered += length;
+}
+
+void LinkCredits::OnReleased (uint32_t length)
+{
+    _buffered = length > _buffered ? 0 : _buffered - length;
+}
+
+void LinkCredits::Resynchronise (uint32_t transmitted)
+{
+    _received = transmitted;
+}
+
+uint32_t LinkCredits::Limit ()
+{
+    auto window = _buffered > _receiveWindow ? 0 : _receiveWindow - _buffered;
+
+    return _received + window;
+}
+
+bool LinkCredits::ShouldGrant ()
+{
+    return _receiveWindow != 0 &&
+           (int32_t) (Limit () - _granted) >= (int32_t) (_receiveWindow / 4);
+}
+
+uint32_t LinkCredits::Grant ()
+{
+    _granted = Limit ();
+
+    return _granted;
+}
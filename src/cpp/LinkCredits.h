@@ -0,0 +1,87 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ *  LinkCredits
+ *
+ *  Credit based flow control state for one adaptor link. Both ends keep
+ *  cumulative byte counts, and the receiver advertises the cumulative limit
+ *  the sender may transmit up to. A lost grant is repaired by the next one,
+ *  and RouterPoll carries the sender's count so the receiver can resync after
+ *  lost packets.
+ */
+class LinkCredits
+{
+  public:
+    /**
+     * Instantiates a new instance of LinkCredits
+     */
+    LinkCredits ();
+    ~LinkCredits ();
+
+    /**
+     * True once the remote end has advertised a window.
+     */
+    bool IsLimited ();
+
+    /**
+     * Transmission is allowed while any credit remains, so a window smaller
+     * than a packet cannot stall the link. Buffering at the receiver is bound
+     * by its window plus one packet.
+     */
+    bool CanTransmit ();
+
+    void OnTransmitted (uint32_t length);
+
+    void OnGranted (uint32_t limit);
+
+    /**
+     * Stops honouring the remote window until it is advertised again, used
+     * when the link is reset.
+     */
+    void Unlimit ();
+
+    uint32_t Transmitted ();
+
+    /**
+     * Bytes this end is prepared to buffer from the link. Zero disables
+     * advertising credits.
+     */
+    uint32_t ReceiveWindow ();
+    void ReceiveWindow (uint32_t value);
+
+    void OnReceived (uint32_t length);
+
+    /**
+     * Tracks received bytes that are held in an egress queue rather than
+     * being forwarded straight away.
+     */
+    void OnBuffered (uint32_t length);
+    void OnReleased (uint32_t length);
+
+    void Resynchronise (uint32_t transmitted);
+
+    uint32_t Limit ();
+
+    bool ShouldGrant ();
+
+    /**
+     * Returns the limit to advertise and records it as granted.
+     */
+    uint32_t Grant ();
+
+  private:
+    bool _isLimited;
+    uint32_t _transmitted;
+    uint32_t _limit;
+
+    uint32_t _receiveWindow;
+    uint32_t _received;
+    uint32_t _buffered;
+    uint32_t _granted;
+};
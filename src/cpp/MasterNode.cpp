@@ -13,23 +13,23 @@ MasterNode::MasterNode ()
     _nodesChanged = false;
     _isEnumerating = false;
     _queueEnumeration = false;
-    _pollTimerHandler = nullptr;
+    _enumerationConcurrency = 1;
+    _enumerationsInFlight = 0;
+    _nodeInfoRequests = 0;
+    _verificationRequests = 0;
     _nextAddress = 2;
     _root = new NodeInfo (nullptr, MasterNodeAddress);
     _root->Guid = _guid;
     _root->Name = "Network.Master";
-    _root->NameOwned = false;
     _root->EnumerationState = NodeEnumerationState::Pending;
 
-    _currentEnumerationNode = nullptr;
-
     _nodeInfo[Address ()] = _root;
 
     Manager ().RegisterCommand (
         static_cast<uint16_t> (NodeCommand::Ping),
         [&](std::shared_ptr<IncomingTransaction> incoming,
             std::shared_ptr<OutgoingTransaction> outgoing) {
-            if (this->HandlePollResponse (incoming->Source ()))
+            if (this->HandlePollResponse (*incoming))
             {
                 return IdpResponseCode::OK;
             }
@@ -57,12 +57,10 @@ MasterNode::MasterNode ()
             return IdpResponseCode::OK;
         });
 
-    _pollTimer = new DispatcherTimer (500);
-
-    _pollTimerHandler = &(_pollTimer->Tick += [&](auto sender, auto& e) {
+    _pollTimer = new ScheduledTimer (500, [&] {
         _pollTimer->Stop ();
 
-        this->EnumerateNetwork ();
+        this->EnumerateChanges ();
     });
 }
 
@@ -70,13 +68,6 @@ MasterNode::~MasterNode ()
 {
     if (_pollTimer != nullptr)
     {
-        if (_pollTimerHandler != nullptr)
-        {
-            _pollTimer->Tick -= *_pollTimerHandler;
-            _pollTimerHandler = nullptr;
-        }
-
-        _pollTimer->Stop ();
         delete _pollTimer;
         _pollTimer = nullptr;
     }
@@ -115,6 +106,12 @@ NodeInfo* MasterNode::GetNextEnumerationNode ()
     NodeInfo* result = nullptr;
 
     VisitNodes (_root, [&](NodeInfo& node) {
+        // Routers below one that is being enumerated can go ahead.
+        if (node.EnumerationInFlight)
+        {
+            return true;
+        }
+
         if (node.EnumerationState != NodeEnumerationState::Idle)
         {
             result = &node;
@@ -127,8 +124,10 @@ NodeInfo* MasterNode::GetNextEnumerationNode ()
     return result;
 }
 
-bool MasterNode::HandlePollResponse (uint16_t address)
+bool MasterNode::HandlePollResponse (IncomingTransaction& incoming)
 {
+    auto address = incoming.Source ();
+
     if (address != Address ())
     {
         auto node = FindNode (address);
@@ -137,6 +136,13 @@ bool MasterNode::HandlePollResponse (uint16_t address)
         {
             node->LastSeen = Application::GetApplicationTime ();
 
+            // Routers send their topology generation.
+            if (incoming.BytesRemaining () >= sizeof (uint32_t))
+            {
+                node->Generation = incoming.Read<uint32_t> ();
+                node->ReportsGeneration = true;
+            }
+
             return true;
         }
     }
@@ -187,49 +193,31 @@ bool MasterNode::IsEnumerating ()
     return _isEnumerating;
 }
 
-void MasterNode::OnEnumerate ()
+uint8_t MasterNode::EnumerationConcurrency ()
 {
-    auto node = GetNextEnumerationNode ();
+    return _enumerationConcurrency;
+}
 
-    if (node != nullptr)
-    {
-        _currentEnumerationNode = node;
+void MasterNode::EnumerationConcurrency (uint8_t value)
+{
+    _enumerationConcurrency = value == 0 ? 1 : value;
+}
 
-        if (node == _root)
-        {
-            _currentEnumerationNode->EnumerationState =
-                NodeEnumerationState::DetectingRouter;
+void MasterNode::OnEnumerate ()
+{
+    while (_enumerationsInFlight < _enumerationConcurrency)
+    {
+        auto node = GetNextEnumerationNode ();
 
-            DetectRouter ();
-        }
-        else if (node->IsRouter ())
+        if (node == nullptr || !BeginEnumerationStep (*node))
         {
-            switch (node->EnumerationState)
-            {
-                case NodeEnumerationState::Pending:
-                case NodeEnumerationState::EnumeratingNodes:
-                    _currentEnumerationNode->EnumerationState =
-                        NodeEnumerationState::EnumeratingNodes;
-                    EnumerateRouterNode (node->Address);
-                    break;
-
-                case NodeEnumerationState::StartEnumeratingAdaptors:
-                    StartEnumerateRouterAdaptors (node->Address);
-                    break;
-
-                case NodeEnumerationState::EnumeratingAdaptors:
-                    EnumerateRouterAdaptor (node->Address);
-                    break;
-
-                default:
-                    break;
-            }
+            break;
         }
     }
-    else if (_currentEnumerationNode != nullptr)
-    {
-        _currentEnumerationNode = nullptr;
 
+    if (_isEnumerating && _enumerationsInFlight == 0 &&
+        _nodeInfoRequests == 0 && GetNextEnumerationNode () == nullptr)
+    {
         _isEnumerating = false;
 
         PollNetwork ();
@@ -254,6 +242,83 @@ void MasterNode::OnEnumerate ()
     }
 }
 
+bool MasterNode::BeginEnumerationStep (NodeInfo& node)
+{
+    auto state = node.EnumerationState;
+
+    if (&node == _root)
+    {
+        state = NodeEnumerationState::DetectingRouter;
+    }
+    else if (!node.IsRouter () || state == NodeEnumerationState::Idle ||
+             state == NodeEnumerationState::DetectingRouter)
+    {
+        return false;
+    }
+
+    node.EnumerationInFlight = true;
+    _enumerationsInFlight++;
+
+    // The step may complete before the request returns, node must not be
+    // used after it.
+    switch (state)
+    {
+        case NodeEnumerationState::DetectingRouter:
+            node.EnumerationState = NodeEnumerationState::DetectingRouter;
+            DetectRouter ();
+            break;
+
+        case NodeEnumerationState::Pending:
+        case NodeEnumerationState::EnumeratingNodes:
+            node.EnumerationState = NodeEnumerationState::EnumeratingNodes;
+            EnumerateRouterNode (node.Address);
+            break;
+
+        case NodeEnumerationState::StartEnumeratingAdaptors:
+            StartEnumerateRouterAdaptors (node.Address);
+            break;
+
+        case NodeEnumerationState::EnumeratingAdaptors:
+            EnumerateRouterAdaptor (node.Address);
+            break;
+
+        default:
+            break;
+    }
+
+    return true;
+}
+
+void MasterNode::EndEnumerationStep (uint16_t routerAddress)
+{
+    auto node = FindNode (routerAddress);
+
+    if (node != nullptr)
+    {
+        node->EnumerationInFlight = false;
+    }
+
+    // Steps started before a reset still end once, whether or not their
+    // router is still known.
+    if (_enumerationsInFlight > 0)
+    {
+        _enumerationsInFlight--;
+    }
+
+    OnEnumerate ();
+}
+
+void MasterNode::SetEnumerationState (uint16_t routerAddress,
+                                      NodeEnumerationState state)
+{
+    auto node = FindNode (routerAddress);
+
+    if (node != nullptr)
+    {
+        node->EnumerationState = state;
+    }
+}
+
 void MasterNode::ResetNetwork ()
 {
     OnReset ();
@@ -265,7 +330,6 @@ void MasterNode::ResetNetwork ()
 void MasterNode::OnReset ()
 {
     ClearDiscoveredNodes ();
-    _currentEnumerationNode = nullptr;
     _isEnumerating = false;
     _queueEnumeration = false;
 }
@@ -301,6 +365,16 @@ void MasterNode::DeleteDiscoveredSubtree (NodeInfo* node)
 }
 
 void MasterNode::EnumerateNetwork ()
+{
+    StartEnumeration (false);
+}
+
+void MasterNode::EnumerateChanges ()
+{
+    StartEnumeration (true);
+}
+
+void MasterNode::StartEnumeration (bool changedOnly)
 {
     if (Connected () && !_isEnumerating)
     {
@@ -309,7 +383,18 @@ void MasterNode::EnumerateNetwork ()
         VisitNodes (_root, [&](NodeInfo& node) {
             if (node.IsRouter ())
             {
-                node.EnumerationState = NodeEnumerationState::Pending;
+                if (changedOnly && node.ReportsGeneration &&
+                    node.Generation == node.EnumeratedGeneration)
+                {
+                    node.EnumerationState = NodeEnumerationState::Idle;
+                }
+                else
+                {
+                    // Changes after the last Ping move the generation
+                    // again, so none are missed.
+                    node.EnumeratedGeneration = node.Generation;
+                    node.EnumerationState = NodeEnumerationState::Pending;
+                }
             }
             else
             {
@@ -353,7 +438,7 @@ void MasterNode::DetectRouter ()
 
                               if (nodeEnumerated)
                               {
-                                  _currentEnumerationNode->EnumerationState =
+                                  _root->EnumerationState =
                                       NodeEnumerationState::Idle;
 
                                   this->OnNodeAdded (this->Address (), address);
@@ -364,12 +449,12 @@ void MasterNode::DetectRouter ()
 
                           _freeAddresses.push (address);
 
-                          this->OnEnumerate ();
+                          this->EndEnumerationStep (this->Address ());
                       }))
     {
-        _currentEnumerationNode->EnumerationState = NodeEnumerationState::Idle;
+        _root->EnumerationState = NodeEnumerationState::Idle;
 
-        this->OnEnumerate ();
+        this->EndEnumerationStep (Address ());
     }
 }
 
@@ -399,15 +484,12 @@ void MasterNode::EnumerateRouterNode (uint16_t routerAddress)
                 }
             }
 
-            if (_currentEnumerationNode != nullptr)
-            {
-                _currentEnumerationNode->EnumerationState =
-                    NodeEnumerationState::StartEnumeratingAdaptors;
-            }
+            SetEnumerationState (
+                routerAddress, NodeEnumerationState::StartEnumeratingAdaptors);
 
             _freeAddresses.push (address);
 
-            this->OnEnumerate ();
+            this->EndEnumerationStep (routerAddress);
         });
 
     if (!sent)
@@ -424,7 +506,7 @@ void MasterNode::EnumerateRouterNode (uint16_t routerAddress)
 
         InvalidateNodes ();
 
-        this->OnEnumerate ();
+        this->EndEnumerationStep (routerAddress);
     }
 }
 
@@ -434,29 +516,22 @@ void MasterNode::StartEnumerateRouterAdaptors (uint16_t routerAddress)
         static_cast<uint16_t> (NodeCommand::RouterPrepareToEnumerateAdaptors),
         CreateTransactionId ());
 
-    bool sent =
-        SendRequest (routerAddress, outgoingTransaction,
-                     [&](std::shared_ptr<IdpResponse> response) {
-                         if (response != nullptr &&
-                             response->ResponseCode () == IdpResponseCode::OK)
-                         {
-                             if (_currentEnumerationNode != nullptr)
-                             {
-                                 _currentEnumerationNode->EnumerationState =
-                                     NodeEnumerationState::EnumeratingAdaptors;
-                             }
-                         }
-                         else
-                         {
-                             if (_currentEnumerationNode != nullptr)
-                             {
-                                 _currentEnumerationNode->EnumerationState =
-                                     NodeEnumerationState::Idle;
-                             }
-                         }
-
-                         this->OnEnumerate ();
-                     });
+    bool sent = SendRequest (
+        routerAddress, outgoingTransaction,
+        [&, routerAddress](std::shared_ptr<IdpResponse> response) {
+            if (response != nullptr &&
+                response->ResponseCode () == IdpResponseCode::OK)
+            {
+                SetEnumerationState (
+                    routerAddress, NodeEnumerationState::EnumeratingAdaptors);
+            }
+            else
+            {
+                SetEnumerationState (routerAddress, NodeEnumerationState::Idle);
+            }
+
+            this->EndEnumerationStep (routerAddress);
+        });
 
     if (!sent)
     {
@@ -472,7 +547,7 @@ void MasterNode::StartEnumerateRouterAdaptors (uint16_t routerAddress)
 
         InvalidateNodes ();
 
-        this->OnEnumerate ();
+        this->EndEnumerationStep (routerAddress);
     }
 }
 
@@ -499,8 +574,6 @@ void MasterNode::EnumerateRouterAdaptor (uint16_t routerAddress)
 
                 if (nodeEnumerated)
                 {
-                    this->OnNodeAdded (routerAddress, address);
-
                     auto markParentAdaptorConnected = OutgoingTransaction::Create (
                         static_cast<uint16_t> (
                             NodeCommand::MarkAdaptorConnected),
@@ -514,27 +587,29 @@ void MasterNode::EnumerateRouterAdaptor (uint16_t routerAddress)
                     this->SendRequest (routerAddress,
                                        markParentAdaptorConnected);
                     this->SendRequest (address, markAdaptorConnected);
+
+                    // Adding the node ends the step, so the router must
+                    // have marked the adaptor before it is asked for the
+                    // next one.
+                    this->OnNodeAdded (routerAddress, address);
                     return;
                 }
                 else
                 {
-                    if (_currentEnumerationNode != nullptr)
-                    {
-                        _currentEnumerationNode->EnumerationState =
-                            NodeEnumerationState::Idle;
-                    }
+                    SetEnumerationState (routerAddress,
+                                         NodeEnumerationState::Idle);
                 }
             }
 
             _freeAddresses.push (address);
 
-            this->OnEnumerate ();
+            this->EndEnumerationStep (routerAddress);
         });
 
 
     bool sent = SendRequest (
         routerAddress, outgoingTransaction,
-        [&, address,
+        [&, address, routerAddress,
          routerDetectTransactionId](std::shared_ptr<IdpResponse> response) {
             if (response != nullptr &&
                 response->ResponseCode () == IdpResponseCode::OK)
@@ -569,11 +644,8 @@ void MasterNode::EnumerateRouterAdaptor (uint16_t routerAddress)
                     this->Manager ().UnregisterOneTimeResponseHandler (
                         routerDetectTransactionId);
 
-                    if (_currentEnumerationNode != nullptr)
-                    {
-                        _currentEnumerationNode->EnumerationState =
-                            NodeEnumerationState::Idle;
-                    }
+                    SetEnumerationState (routerAddress,
+                                         NodeEnumerationState::Idle);
                 }
             }
             else
@@ -581,15 +653,12 @@ void MasterNode::EnumerateRouterAdaptor (uint16_t routerAddress)
                 this->Manager ().UnregisterOneTimeResponseHandler (
                     routerDetectTransactionId);
 
-                if (_currentEnumerationNode != nullptr)
-                {
-                    _currentEnumerationNode->EnumerationState =
-                        NodeEnumerationState::Idle;
-                }
+                SetEnumerationState (routerAddress,
+                                     NodeEnumerationState::Idle);
             }
 
             _freeAddresses.push (address);
-            this->OnEnumerate ();
+            this->EndEnumerationStep (routerAddress);
         });
 
     if (!sent)
@@ -609,68 +678,89 @@ void MasterNode::EnumerateRouterAdaptor (uint16_t routerAddress)
 
         InvalidateNodes ();
 
-        this->OnEnumerate ();
+        this->EndEnumerationStep (routerAddress);
     }
 }
 
 void MasterNode::OnNodeAdded (uint16_t parentAddress, uint16_t address)
 {
+    auto parent = FindNode (parentAddress);
+
+    // The parent may have been invalidated while its response was in flight.
+    if (parent == nullptr)
+    {
+        _freeAddresses.push (address);
+
+        EndEnumerationStep (parentAddress);
+
+        return;
+    }
+
     _nodesChanged = true;
 
-    _nodeInfo[address] = new NodeInfo (_nodeInfo[parentAddress], address);
+    _nodeInfo[address] = new NodeInfo (parent, address);
 
-    _nodeInfo[parentAddress]->Children.push_back (_nodeInfo[address]);
+    parent->Children.push_back (_nodeInfo[address]);
+
+    // The node stays Idle, and so is not walked, until its info shows it is
+    // a router. Enumeration of the parent carries on in the meantime.
+    _nodeInfoRequests++;
 
     auto nodeInfoTransaction = OutgoingTransaction::Create (
         static_cast<uint16_t> (NodeCommand::GetNodeInfo),
         CreateTransactionId ());
 
-    SendRequest (address, nodeInfoTransaction,
-                 [&, address](std::shared_ptr<IdpResponse> response) {
-                     auto node = FindNode (address);
-
-                     if (node == nullptr)
-                     {
-                         this->OnEnumerate ();
-                         return;
-                     }
-
-                     if (response != nullptr &&
-                         response->ResponseCode () == IdpResponseCode::OK)
-                     {
-                         node->Guid = response->Transaction ()->ReadGuid ();
-
-                         if (node->NameOwned && node->Name != nullptr)
-                         {
-                             delete[] node->Name;
-                         }
-
-                         node->Name =
-                             response->Transaction ()->ReadCString ();
-                         node->NameOwned = true;
-
-                         node->Timeout =
-                             response->Transaction ()->Read<uint32_t> ();
-
-                         if (node->IsRouter ())
-                         {
-                             node->EnumerationState =
-                                 NodeEnumerationState::Pending;
-                         }
-                         else
-                         {
-                             node->EnumerationState =
-                                 NodeEnumerationState::Idle;
-                         }
-                     }
-                     else
-                     {
-                         node->LastSeen = 0xFFFFFFFFFFFFFFFF;
-                         InvalidateNodes ();
-                     }
-
-                     this->OnEnumerate ();
-                 });
+    if (!SendRequest (address, nodeInfoTransaction,
+                      [&, address](std::shared_ptr<IdpResponse> response) {
+                          this->OnNodeInfo (address, response);
+                      }))
+    {
+        OnNodeInfo (address, nullptr);
+    }
+
+    EndEnumerationStep (parentAddress);
+}
+
+void MasterNode::OnNodeInfo (uint16_t address,
+                             std::shared_ptr<IdpResponse> response)
+{
+    if (_nodeInfoRequests > 0)
+    {
+        _nodeInfoRequests--;
+    }
+
+    auto node = FindNode (address);
+
+    if (node != nullptr)
+    {
+        if (response != nullptr &&
+            response->ResponseCode () == IdpResponseCode::OK)
+        {
+            node->Guid = response->Transaction ()->ReadGuid ();
+
+            // Keep the response rather than copying the name.
+            node->Name = response->Transaction ()->ReadStringView ().Data ();
+            node->NamePacket = response->Transaction ()->Packet ();
+
+            node->Timeout = response->Transaction ()->Read<uint32_t> ();
+
+            if (node->IsRouter ())
+            {
+                node->EnumerationState = NodeEnumerationState::Pending;
+            }
+            else
+            {
+                node->EnumerationState = NodeEnumerationState::Idle;
+            }
+        }
+        else
+        {
+            node->LastSeen = 0xFFFFFFFFFFFFFFFF;
+            InvalidateNodes ();
+        }
+    }
+
+    OnEnumerate ();
 }
 
 void MasterNode::InvalidateNodes ()
@@ -721,6 +811,155 @@ void MasterNode::PollNetwork ()
     InvalidateNodes ();
 }
 
+bool MasterNode::SaveTopology (IStream& stream)
+{
+    return TopologySnapshot::Write (stream, *_root);
+}
+
+bool MasterNode::LoadTopology (IStream& stream)
+{
+    if (_isEnumerating)
+    {
+        return false;
+    }
+
+    auto snapshot = TopologySnapshot::Read (stream);
+
+    if (snapshot == nullptr)
+    {
+        return false;
+    }
+
+    // Only addresses the master could have assigned, so a corrupt snapshot
+    // cannot place nodes at the broadcast, poll or multicast addresses.
+    for (auto& entry : snapshot->Nodes ())
+    {
+        if (entry.Address < 2 || entry.Address >= MulticastAddressBase)
+        {
+            return false;
+        }
+    }
+
+    ClearDiscoveredNodes ();
+
+    // Names point into the snapshot.
+    _snapshot = snapshot;
+
+    for (auto& entry : snapshot->Nodes ())
+    {
+        auto parent = FindNode (entry.Parent);
+
+        if (parent == nullptr || HasNode (entry.Address))
+        {
+            continue;
+        }
+
+        auto node = new NodeInfo (parent, entry.Address);
+        node->Guid = entry.Guid;
+        node->Name = entry.Name;
+        node->Timeout = entry.Timeout;
+        node->Generation = entry.Generation;
+        node->EnumeratedGeneration = entry.Generation;
+        node->ReportsGeneration = entry.ReportsGeneration;
+
+        _nodeInfo[entry.Address] = node;
+        parent->Children.push_back (node);
+
+        if (entry.Address >= _nextAddress)
+        {
+            _nextAddress = entry.Address + 1;
+        }
+    }
+
+    for (uint16_t address = _nextAddress - 1; address >= 2; address--)
+    {
+        if (!HasNode (address))
+        {
+            _freeAddresses.push (address);
+        }
+    }
+
+    _root->EnumerationState = _root->Children.empty ()
+                                  ? NodeEnumerationState::Pending
+                                  : NodeEnumerationState::Idle;
+
+    _pollTimer->Stop ();
+
+    VerifyTopology ();
+
+    return true;
+}
+
+void MasterNode::VerifyTopology ()
+{
+    // Holds off enumeration until every node has been heard from.
+    _isEnumerating = true;
+
+    std::vector<uint16_t> addresses;
+
+    for (auto& entry : _nodeInfo)
+    {
+        if (entry.second != _root)
+        {
+            addresses.push_back (entry.first);
+        }
+    }
+
+    _verificationRequests += addresses.size () + 1;
+
+    for (auto address : addresses)
+    {
+        auto ping = OutgoingTransaction::Create (
+            static_cast<uint16_t> (NodeCommand::Ping), CreateTransactionId ());
+
+        if (!SendRequest (address, ping,
+                          [&, address](std::shared_ptr<IdpResponse> response) {
+                              this->OnVerified (address, response);
+                          }))
+        {
+            OnVerified (address, nullptr);
+        }
+    }
+
+    // Completes the sweep if every node answered straight away.
+    OnVerified (UnassignedAddress, nullptr);
+}
+
+void MasterNode::OnVerified (uint16_t address,
+                             std::shared_ptr<IdpResponse> response)
+{
+    auto node = FindNode (address);
+
+    if (node != nullptr)
+    {
+        if (response != nullptr &&
+            response->ResponseCode () == IdpResponseCode::OK)
+        {
+            node->LastSeen = Application::GetApplicationTime ();
+        }
+        else
+        {
+            node->LastSeen = 0xFFFFFFFFFFFFFFFF;
+
+            // The router is walked again, as its generation is no longer
+            // known, to find the node if it has reset.
+            if (node->Parent != nullptr)
+            {
+                node->Parent->ReportsGeneration = false;
+            }
+        }
+    }
+
+    if (_verificationRequests > 0 && --_verificationRequests == 0)
+    {
+        InvalidateNodes ();
+
+        _isEnumerating = false;
+
+        EnumerateChanges ();
+    }
+}
+
 void MasterNode::TraceNetworkTree (NodeInfo* node, uint32_t level)
 {
     if (node == nullptr)
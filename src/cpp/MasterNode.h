@@ -4,9 +4,9 @@
 #pragma once
 
 #include "Application.h"
-#include "DispatcherTimer.h"
 #include "Guid.h"
 #include "IdpNode.h"
+#include "TopologySnapshot.h"
 #include "Trace.h"
 #include <functional>
 #include <list>
@@ -31,29 +31,26 @@ struct NodeInfo
     {
         Address = address;
         Name = nullptr;
-        NameOwned = false;
         LastSeen = Application::GetApplicationTime ();
         Timeout = 4000;
         EnumerationState = NodeEnumerationState::Idle;
+        EnumerationInFlight = false;
+        Generation = 0;
+        EnumeratedGeneration = 0;
+        ReportsGeneration = false;
         Parent = parent;
         Name = nullptr;
     }
 
-    ~NodeInfo ()
-    {
-        if (NameOwned && Name != nullptr)
-        {
-            delete[] Name;
-        }
-    }
-
     bool IsRouter ()
     {
         return Guid == RouterGuid;
     }
 
     const char* Name;
-    bool NameOwned;
+
+    // GetNodeInfo response Name points into.
+    std::shared_ptr<IdpPacket> NamePacket;
 
     uint16_t Address;
     uint64_t LastSeen;
@@ -61,6 +58,15 @@ struct NodeInfo
     uint32_t Timeout;
     NodeEnumerationState EnumerationState;
 
+    // A request of this router's enumeration is awaiting its response.
+    bool EnumerationInFlight;
+
+    // Topology generation from the router's last Ping, and the one it had
+    // reported when its enumeration last started.
+    uint32_t Generation;
+    uint32_t EnumeratedGeneration;
+    bool ReportsGeneration;
+
     NodeInfo* Parent;
     std::list<NodeInfo*> Children;
 };
@@ -72,13 +78,16 @@ class MasterNode : public IdpNode
 {
   private:
     bool _nodesChanged;
-    DispatcherTimer* _pollTimer;
-    EventHandler* _pollTimerHandler;
+    ScheduledTimer* _pollTimer;
     uint16_t _nextAddress;
     std::stack<uint16_t> _freeAddresses;
     std::map<uint16_t, NodeInfo*> _nodeInfo;
     NodeInfo* _root;
-    NodeInfo* _currentEnumerationNode;
+    uint8_t _enumerationConcurrency;
+    uint8_t _enumerationsInFlight;
+    uint32_t _nodeInfoRequests;
+    uint32_t _verificationRequests;
+    std::shared_ptr<TopologySnapshot> _snapshot;
     bool _isEnumerating;
     bool _queueEnumeration;
 
@@ -86,20 +95,31 @@ class MasterNode : public IdpNode
 
     uint16_t GetFreeAddress ();
 
-    bool HandlePollResponse (uint16_t address);
+    bool HandlePollResponse (IncomingTransaction& incoming);
 
     void InvalidateNodes ();
     void ClearDiscoveredNodes ();
     void DeleteDiscoveredSubtree (NodeInfo* node);
 
     void OnNodeAdded (uint16_t parentAddress, uint16_t address);
+    void OnNodeInfo (uint16_t address, std::shared_ptr<IdpResponse> response);
+
+    void VerifyTopology ();
+    void OnVerified (uint16_t address, std::shared_ptr<IdpResponse> response);
 
     void VisitNodes (NodeInfo* root, std::function<bool(NodeInfo&)> visitor);
 
     NodeInfo* GetNextEnumerationNode ();
 
+    void StartEnumeration (bool changedOnly);
+
     void OnEnumerate ();
 
+    bool BeginEnumerationStep (NodeInfo& node);
+    void EndEnumerationStep (uint16_t routerAddress);
+    void SetEnumerationState (uint16_t routerAddress,
+                              NodeEnumerationState state);
+
     void DetectRouter ();
     void EnumerateRouterNode (uint16_t routerAddress);
     void StartEnumerateRouterAdaptors (uint16_t routerAddress);
@@ -115,6 +135,14 @@ class MasterNode : public IdpNode
 
     bool IsEnumerating ();
 
+    /**
+     * Number of routers that are enumerated at the same time, each waiting
+     * on its own request. The default of 1 enumerates one router after the
+     * other.
+     */
+    uint8_t EnumerationConcurrency ();
+    void EnumerationConcurrency (uint8_t value);
+
     virtual void OnReset ();
 
     NodeInfo* NetworkTree ();
@@ -124,9 +152,36 @@ class MasterNode : public IdpNode
 
     void ResetNetwork ();
 
+    /**
+     * Enumerates every router in the network again.
+     */
     void EnumerateNetwork ();
 
+    /**
+     * Enumerates only routers whose topology generation has moved since
+     * they were last enumerated, and routers that do not report one. This
+     * is what the master does periodically, so a network that does not
+     * change sees no enumeration traffic.
+     */
+    void EnumerateChanges ();
+
     void PollNetwork ();
 
+    /**
+     * Writes the enumerated network to stream, so that a master that
+     * restarts can take it over with LoadTopology.
+     */
+    bool SaveTopology (IStream& stream);
+
+    /**
+     * Replaces the known network with a snapshot written by SaveTopology
+     * and pings every node in it at once. Nodes that answer are kept as
+     * they are rather than being reset and enumerated again. Those that do
+     * not are dropped and the routers they were on enumerated again once
+     * every ping has completed. IsEnumerating is true until then. Snapshots
+     * with addresses the master would not assign are rejected.
+     */
+    bool LoadTopology (IStream& stream);
+
     void TraceNetworkTree (NodeInfo* node = nullptr, uint32_t level = 0);
 };
@@ -4,12 +4,23 @@
 #include "NotifyingStreamAdaptor.h"
 #include "Trace.h"
 
+static constexpr uint32_t DefaultHeldBytesLimit = 4096;
+
 NotifyingStreamAdaptor::NotifyingStreamAdaptor ()
 {
     _connectionHandler = nullptr;
     _parser = new IdpPacketParser ();
 
+    _cutThrough = false;
+    _cutThroughThreshold = 256;
+    _compactFrameThreshold = 0;
+    _cutThroughEgress = nullptr;
+    _isForwarding = false;
+    _heldBytes = 0;
+    _heldBytesLimit = DefaultHeldBytesLimit;
+
     Parser ().Stream (_connection.get());
+    Parser ().CutThroughSink (this);
 
     Parser ().DataReceived += [this](auto sender, auto& e) {
         auto& args = static_cast<DataReceivedEventArgs&> (e);
@@ -68,11 +79,39 @@ IdpPacketParser& NotifyingStreamAdaptor::Parser ()
 }
 
 bool NotifyingStreamAdaptor::Transmit (std::shared_ptr<IdpPacket> packet)
+{
+    if (_isForwarding)
+    {
+        if (_heldBytes + packet->Length () > _heldBytesLimit)
+        {
+            Trace::WriteLine ("Held packet dropped",
+                              "Notifying Stream Adaptor");
+
+            return false;
+        }
+
+        // Another packet is being cut through, it must not be interleaved.
+        _heldPackets.push_back (packet);
+        _heldBytes += packet->Length ();
+
+        return true;
+    }
+
+    if (packet->PayloadLength () <= _compactFrameThreshold &&
+        CompactFrame::CanEncode (*packet))
+    {
+        uint8_t frame[CompactFrame::MaxFrameLength];
+
+        return Write (frame, CompactFrame::Encode (*packet, frame));
+    }
+
+    return Write (packet->Data (), packet->Length ());
+}
+
+bool NotifyingStreamAdaptor::Write (const uint8_t* data, uint32_t length)
 {
     if (_connection != nullptr && _connection->IsValid ())
     {
-        auto data = packet->Data ();
-        auto length = packet->Length ();
         uint32_t sent = 0;
         int retries = 0;
 
@@ -112,3 +151,124 @@ bool NotifyingStreamAdaptor::Transmit (std::shared_ptr<IdpPacket> packet)
 
     return false;
 }
+
+bool NotifyingStreamAdaptor::CutThrough ()
+{
+    return _cutThrough;
+}
+
+void NotifyingStreamAdaptor::CutThrough (bool value)
+{
+    _cutThrough = value;
+}
+
+uint32_t NotifyingStreamAdaptor::CutThroughThreshold ()
+{
+    return _cutThroughThreshold;
+}
+
+void NotifyingStreamAdaptor::CutThroughThreshold (uint32_t value)
+{
+    _cutThroughThreshold = value;
+}
+
+uint32_t NotifyingStreamAdaptor::CutThroughTimeout ()
+{
+    return Parser ().CutThroughTimeout ();
+}
+
+void NotifyingStreamAdaptor::CutThroughTimeout (uint32_t value)
+{
+    Parser ().CutThroughTimeout (value);
+}
+
+uint32_t NotifyingStreamAdaptor::HeldBytesLimit ()
+{
+    return _heldBytesLimit;
+}
+
+void NotifyingStreamAdaptor::HeldBytesLimit (uint32_t value)
+{
+    _heldBytesLimit = value;
+}
+
+uint32_t NotifyingStreamAdaptor::CompactFrameThreshold ()
+{
+    return _compactFrameThreshold;
+}
+
+void NotifyingStreamAdaptor::CompactFrameThreshold (uint32_t value)
+{
+    _compactFrameThreshold = value < CompactFrame::MaxPayloadLength
+                                 ? value
+                                 : CompactFrame::MaxPayloadLength;
+}
+
+bool NotifyingStreamAdaptor::BeginForward ()
+{
+    if (_isForwarding || _connection == nullptr || !_connection->IsValid ())
+    {
+        return false;
+    }
+
+    _isForwarding = true;
+
+    return true;
+}
+
+bool NotifyingStreamAdaptor::Forward (const void* data, uint32_t length)
+{
+    return Write (static_cast<const uint8_t*> (data), length);
+}
+
+void NotifyingStreamAdaptor::EndForward ()
+{
+    _isForwarding = false;
+
+    while (!_heldPackets.empty () && !_isForwarding)
+    {
+        auto packet = _heldPackets.front ();
+        _heldPackets.pop_front ();
+        _heldBytes -= packet->Length ();
+
+        Transmit (packet);
+    }
+}
+
+bool NotifyingStreamAdaptor::BeginCutThrough (IdpFlags flags, uint16_t source,
+                                              uint16_t destination,
+                                              uint32_t length)
+{
+    if (!_cutThrough || _local == nullptr || _id == 0 ||
+        ((uint8_t) flags & (uint8_t) IdpFlags::Fragment) != 0 ||
+        length < _cutThroughThreshold)
+    {
+        return false;
+    }
+
+    _cutThroughEgress = _local->ResolveCutThrough (_id, source, destination,
+                                                   length);
+
+    return _cutThroughEgress != nullptr;
+}
+
+bool NotifyingStreamAdaptor::CutThroughData (const uint8_t* data,
+                                             uint32_t length)
+{
+    return _cutThroughEgress->Forward (data, length);
+}
+
+void NotifyingStreamAdaptor::EndCutThrough (bool valid)
+{
+    if (!valid)
+    {
+        Trace::WriteLine ("Cut through packet aborted",
+                          "Notifying Stream Adaptor");
+    }
+
+    auto egress = _cutThroughEgress;
+
+    _cutThroughEgress = nullptr;
+
+    egress->EndForward ();
+}
@@ -6,21 +6,34 @@
 #include "IAdaptor.h"
 #include "IStream.h"
 #include "IdpPacketParser.h"
+#include <list>
 #include <stdbool.h>
 #include <stdint.h>
 
 /**
  *  NotifyingStreamAdaptor
  */
-class NotifyingStreamAdaptor : public IAdaptor
+class NotifyingStreamAdaptor : public IAdaptor, public ICutThroughSink
 {
   private:
     IdpPacketParser* _parser;
     std::shared_ptr<INotifyingStream> _connection;
     EventHandler* _connectionHandler;
 
+    bool _cutThrough;
+    uint32_t _cutThroughThreshold;
+    uint32_t _compactFrameThreshold;
+    IAdaptor* _cutThroughEgress;
+
+    bool _isForwarding;
+    std::list<std::shared_ptr<IdpPacket>> _heldPackets;
+    uint32_t _heldBytes;
+    uint32_t _heldBytesLimit;
+
     IdpPacketParser& Parser ();
 
+    bool Write (const uint8_t* data, uint32_t length);
+
 
   public:
     /**
@@ -35,6 +48,54 @@ class NotifyingStreamAdaptor : public IAdaptor
 
     bool Transmit (std::shared_ptr<IdpPacket> packet);
 
+    /**
+     * When enabled, packets whose route leads out of another stream adaptor
+     * are forwarded as they arrive rather than reassembled. A packet that
+     * turns out to be bad, or stalls, is padded out with an invalid ETX so
+     * the next hop drops it. A CRC, if present, is checked by the
+     * destination node.
+     */
+    bool CutThrough ();
+    void CutThrough (bool value);
+
+    /**
+     * Minimum length for a packet to be cut through. Smaller packets
+     * gain little and may carry commands that routers inspect.
+     */
+    uint32_t CutThroughThreshold ();
+    void CutThroughThreshold (uint32_t value);
+
+    /**
+     * Time a packet being cut through may go without receiving any bytes
+     * before it is aborted and the egress released.
+     */
+    uint32_t CutThroughTimeout ();
+    void CutThroughTimeout (uint32_t value);
+
+    /**
+     * Bytes that may be held back while another packet is cut through this
+     * adaptor. Packets beyond this are dropped.
+     */
+    uint32_t HeldBytesLimit ();
+    void HeldBytesLimit (uint32_t value);
+
+    /**
+     * Packets carrying a transaction with a payload up to this length are
+     * sent as compact frames. Zero, the default, sends every packet in full
+     * for peers that cannot parse compact frames.
+     */
+    uint32_t CompactFrameThreshold ();
+    void CompactFrameThreshold (uint32_t value);
+
+    bool BeginForward ();
+    bool Forward (const void* data, uint32_t length);
+    void EndForward ();
+
+    bool BeginCutThrough (IdpFlags flags, uint16_t source,
+                          uint16_t destination, uint32_t length);
+    bool CutThroughData (const uint8_t* data, uint32_t length);
+    void EndCutThrough (bool valid);
+
     const char* Name ()
     {
         return "Stream.Adaptor";
@@ -2,6 +2,10 @@
 // Licensed under the MIT license. See licence.md file in the project root for
 // full license information.
 #include "OutgoingTransaction.h"
+#include <cstring>
+
+constexpr uint32_t OutgoingTransaction::HeaderLength;
+constexpr uint32_t OutgoingTransaction::ResponseHeaderLength;
 
 OutgoingTransaction::OutgoingTransaction (uint16_t commandId,
                                           uint32_t transactionId,
@@ -10,6 +14,9 @@ OutgoingTransaction::OutgoingTransaction (uint16_t commandId,
     _writeIndex = 0;
     _commandId = commandId;
     _transactionId = transactionId;
+    _isPendingResponse = false;
+    _responseId = 0;
+    _capacity = 0;
 }
 
 OutgoingTransaction::~OutgoingTransaction ()
@@ -18,12 +25,14 @@ OutgoingTransaction::~OutgoingTransaction ()
 
 std::shared_ptr<OutgoingTransaction>
     OutgoingTransaction::Create (uint16_t commandId, uint32_t transactionId,
-                                 IdpCommandFlags flags)
+                                 IdpCommandFlags flags, uint32_t capacity)
 {
     auto result = new OutgoingTransaction (commandId, transactionId, flags);
 
     auto ptrResult = std::shared_ptr<OutgoingTransaction> (result);
 
+    ptrResult->_data.reserve (HeaderLength + capacity);
+
     ptrResult->Write (commandId);
     ptrResult->Write (transactionId);
     ptrResult->Write ((uint8_t) flags);
@@ -31,6 +40,63 @@ std::shared_ptr<OutgoingTransaction>
     return ptrResult;
 }
 
+std::shared_ptr<OutgoingTransaction>
+    OutgoingTransaction::CreateResponse (uint32_t transactionId,
+                                         uint16_t responseId,
+                                         uint32_t capacity)
+{
+    auto result = std::allocate_shared<OutgoingTransaction> (
+        TransactionAllocator<OutgoingTransaction> (),
+        (uint16_t) 0xA000, transactionId, IdpCommandFlags::None);
+
+    result->_isPendingResponse = true;
+    result->_responseId = responseId;
+    result->_capacity = capacity;
+
+    return result;
+}
+
+std::shared_ptr<OutgoingTransaction>
+    OutgoingTransaction::Reset (uint16_t commandId, uint32_t transactionId,
+                                IdpCommandFlags flags)
+{
+    _data.clear ();
+    _writeIndex = 0;
+    _commandId = commandId;
+    _transactionId = transactionId;
+    _isPendingResponse = false;
+    _responseId = 0;
+
+    Write (commandId);
+    Write (transactionId);
+    Write ((uint8_t) flags);
+
+    return shared_from_this ();
+}
+
+uint32_t OutgoingTransaction::Length ()
+{
+    Materialise ();
+
+    return _data.size ();
+}
+
+void OutgoingTransaction::Materialise ()
+{
+    if (_isPendingResponse)
+    {
+        _isPendingResponse = false;
+
+        _data.reserve (ResponseHeaderLength + _capacity);
+
+        Write (_commandId);
+        Write (_transactionId);
+        Write ((uint8_t) IdpCommandFlags::None);
+        Write ((uint8_t) IdpResponseCode::OK);
+        Write (_responseId);
+    }
+}
+
 uint16_t OutgoingTransaction::CommandId ()
 {
     return _commandId;
@@ -41,9 +107,26 @@ uint32_t OutgoingTransaction::TransactionId ()
     return _transactionId;
 }
 
+uint16_t OutgoingTransaction::ResponseId ()
+{
+    return _responseId;
+}
+
+IdpResponseCode OutgoingTransaction::ResponseCode ()
+{
+    if (_isPendingResponse || _data.size () <= HeaderLength)
+    {
+        return IdpResponseCode::OK;
+    }
+
+    return (IdpResponseCode) _data[HeaderLength];
+}
+
 std::shared_ptr<IdpPacket> OutgoingTransaction::ToPacket (uint16_t source,
                                                           uint16_t destination)
 {
+    Materialise ();
+
     auto result = std::shared_ptr<IdpPacket> (
         new IdpPacket (_data.size (), IdpFlags::None, source, destination));
 
@@ -57,7 +140,7 @@ std::shared_ptr<IdpPacket> OutgoingTransaction::ToPacket (uint16_t source,
 std::shared_ptr<OutgoingTransaction>
     OutgoingTransaction::WithResponseCode (IdpResponseCode responseCode)
 {
-    WriteAt ((uint8_t) responseCode, 7);
+    WriteAt ((uint8_t) responseCode, HeaderLength);
 
     return shared_from_this ();
 }
@@ -65,25 +148,27 @@ std::shared_ptr<OutgoingTransaction>
 std::shared_ptr<OutgoingTransaction>
     OutgoingTransaction::WriteAt (void* data, uint32_t length, uint32_t index)
 {
-    uint8_t* ptr = (uint8_t*) data;
+    Materialise ();
 
-    for (uint32_t i = 0; i < length; i++)
+    if (index + length > _data.size ())
     {
-        _data[index + i] = ptr[i];
+        _data.resize (index + length);
     }
 
+    memcpy (_data.data () + index, data, length);
+
     return shared_from_this ();
 }
 
 std::shared_ptr<OutgoingTransaction>
     OutgoingTransaction::Write (void* data, uint32_t length)
 {
-    uint8_t* ptr = (uint8_t*) data;
+    Materialise ();
 
-    for (uint32_t i = 0; i < length; i++)
-    {
-        _data.push_back (ptr[i]);
-    }
+    auto ptr = static_cast<const uint8_t*> (data);
+
+    // Grows the buffer at most once and copies the block with memcpy.
+    _data.insert (_data.end (), ptr, ptr + length);
 
     _writeIndex += length;
 
@@ -100,3 +185,13 @@ std::shared_ptr<OutgoingTransaction>
 
     return shared_from_this ();
 }
+
+std::shared_ptr<OutgoingTransaction> OutgoingTransaction::WriteTransaction (
+    std::shared_ptr<OutgoingTransaction> transaction)
+{
+    transaction->Materialise ();
+
+    Write ((uint16_t) transaction->_data.size ());
+
+    return Write (transaction->_data.data (), transaction->_data.size ());
+}
@@ -6,6 +6,7 @@
 #include "Guid.h"
 #include "IdpPacket.h"
 #include "IdpTransaction.h"
+#include "TransactionAllocator.h"
 #include <memory>
 #include <stdint.h>
 #include <vector>
@@ -17,6 +18,9 @@ class OutgoingTransaction
     : public std::enable_shared_from_this<OutgoingTransaction>
 {
   private:
+    template <typename T>
+    friend class TransactionAllocator;
+
     /**
      * Instantiates a new instance of IdpRequest
      */
@@ -25,17 +29,67 @@ class OutgoingTransaction
         IdpCommandFlags flags = IdpCommandFlags::ResponseExpected);
 
   public:
+    /**
+     * Command id, transaction id and flags.
+     */
+    static constexpr uint32_t HeaderLength = 7;
+
+    /**
+     * Header followed by the response code and the id of the command being
+     * responded to.
+     */
+    static constexpr uint32_t ResponseHeaderLength = HeaderLength + 3;
+
     ~OutgoingTransaction ();
 
     uint16_t CommandId ();
 
     uint32_t TransactionId ();
 
+    /**
+     * Id of the command responded to, for transactions from CreateResponse.
+     */
+    uint16_t ResponseId ();
+
+    /**
+     * Code set by WithResponseCode, for transactions from CreateResponse.
+     */
+    IdpResponseCode ResponseCode ();
+
     std::shared_ptr<IdpPacket> ToPacket (uint16_t source, uint16_t destination);
 
+    /**
+     * Creates a transaction with room for capacity payload bytes, so writing
+     * that much never reallocates.
+     */
     static std::shared_ptr<OutgoingTransaction>
         Create (uint16_t commandId, uint32_t transactionId,
-                IdpCommandFlags flags = IdpCommandFlags::ResponseExpected);
+                IdpCommandFlags flags = IdpCommandFlags::ResponseExpected,
+                uint32_t capacity = 0);
+
+    /**
+     * Creates a response to responseId from the transaction pool. Nothing is
+     * written until the transaction is first written to or packetised, so a
+     * response that is never sent costs no allocations. Room for capacity
+     * payload bytes is reserved once it is.
+     */
+    static std::shared_ptr<OutgoingTransaction>
+        CreateResponse (uint32_t transactionId, uint16_t responseId,
+                        uint32_t capacity = 0);
+
+    /**
+     * Starts a new transaction in place, keeping the buffer that has
+     * already been allocated. A transaction can be reused as a builder
+     * once it has been sent, unless it is still held for retransmission.
+     */
+    std::shared_ptr<OutgoingTransaction>
+        Reset (uint16_t commandId, uint32_t transactionId,
+               IdpCommandFlags flags = IdpCommandFlags::ResponseExpected);
+
+    /**
+     * Bytes written, including the header.
+     */
+    uint32_t Length ();
 
     std::shared_ptr<OutgoingTransaction>
         WithResponseCode (IdpResponseCode responseCode);
@@ -47,6 +101,13 @@ class OutgoingTransaction
 
     std::shared_ptr<OutgoingTransaction> WriteGuid (Guid_t& guid);
 
+    /**
+     * Appends a complete transaction, prefixed with its length, so several
+     * commands can travel in one Batch transaction.
+     */
+    std::shared_ptr<OutgoingTransaction>
+        WriteTransaction (std::shared_ptr<OutgoingTransaction> transaction);
+
     template<typename T>
     std::shared_ptr<OutgoingTransaction> Write (T data)
     {
@@ -71,7 +132,12 @@ class OutgoingTransaction
 
 
   private:
+    void Materialise ();
+
     std::vector<uint8_t> _data;
+    bool _isPendingResponse;
+    uint16_t _responseId;
+    uint32_t _capacity;
     uint32_t _writeIndex;
     uint16_t _commandId;
     uint32_t _transactionId;
@@ -0,0 +1,76 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "PacketFragmenter.h"
+
+constexpr uint32_t PacketFragmenter::HeaderLength;
+constexpr uint32_t PacketFragmenter::MinimumMtu;
+
+PacketFragmenter::PacketFragmenter ()
+{
+    _nextFragmentId = 0;
+}
+
+PacketFragmenter::~PacketFragmenter ()
+{
+}
+
+uint32_t PacketFragmenter::FragmentPayload (IdpFlags flags, uint32_t mtu)
+{
+    // STX, length, flags, source, destination and ETX.
+    uint32_t overhead = 11 + HeaderLength;
+
+    if (((uint8_t) flags & (uint8_t) IdpFlags::CRC) == (uint8_t) IdpFlags::CRC)
+    {
+        overhead += 4;
+    }
+
+    return mtu > overhead ? mtu - overhead : 0;
+}
+
+std::vector<std::shared_ptr<IdpPacket>>
+    PacketFragmenter::Fragment (std::shared_ptr<IdpPacket> packet,
+                                uint32_t mtu)
+{
+    std::vector<std::shared_ptr<IdpPacket>> result;
+
+    auto chunk = FragmentPayload (packet->Flags (), mtu);
+
+    if (packet->Length () <= mtu || chunk == 0)
+    {
+        result.push_back (packet);
+        return result;
+    }
+
+    auto flags = (uint8_t) packet->Flags ();
+    auto fragmentFlags = (IdpFlags) ((flags & (uint8_t) IdpFlags::CRC) |
+                                     (uint8_t) IdpFlags::Fragment);
+
+    auto source = packet->Source ();
+    auto destination = packet->Destination ();
+    auto payload = packet->Payload ();
+    auto total = packet->PayloadLength ();
+
+    auto fragmentId = _nextFragmentId++;
+
+    result.reserve ((total + chunk - 1) / chunk);
+
+    for (uint32_t offset = 0; offset < total; offset += chunk)
+    {
+        auto length = total - offset < chunk ? total - offset : chunk;
+
+        auto fragment = std::shared_ptr<IdpPacket> (new IdpPacket (
+            HeaderLength + length, fragmentFlags, source, destination));
+
+        fragment->Write (fragmentId);
+        fragment->Write (flags);
+        fragment->Write (total);
+        fragment->Write (offset);
+        fragment->Write (payload + offset, length);
+        fragment->Seal ();
+
+        result.push_back (fragment);
+    }
+
+    return result;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "IdpPacket.h"
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+/**
+ *  PacketFragmenter
+ *
+ *  Splits packets that are longer than a link's MTU into fragment packets.
+ *  Each fragment keeps the source and destination of the original and
+ *  carries, ahead of its share of the payload, a fragment header:
+ *
+ *      fragment id (u16), original flags (u8), total length (u32),
+ *      offset (u32)
+ *
+ *  The total length and offset refer to the payload of the original packet,
+ *  so the receiver can allocate it once and place fragments in any order.
+ */
+class PacketFragmenter
+{
+  public:
+    static constexpr uint32_t HeaderLength = 11;
+
+    /**
+     * Smallest usable MTU, leaving room for the packet framing, a CRC, the
+     * fragment header and some payload.
+     */
+    static constexpr uint32_t MinimumMtu = 32;
+
+    /**
+     * Instantiates a new instance of PacketFragmenter
+     */
+    PacketFragmenter ();
+    ~PacketFragmenter ();
+
+    /**
+     * Splits packet into fragments no longer than mtu. A packet that
+     * already fits is returned as it is.
+     */
+    std::vector<std::shared_ptr<IdpPacket>>
+        Fragment (std::shared_ptr<IdpPacket> packet, uint32_t mtu);
+
+    /**
+     * Payload bytes each fragment can carry for a given MTU.
+     */
+    static uint32_t FragmentPayload (IdpFlags flags, uint32_t mtu);
+
+  private:
+    uint16_t _nextFragmentId;
+};
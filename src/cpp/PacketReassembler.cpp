@@ -0,0 +1,188 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "PacketReassembler.h"
+#include "Application.h"
+#include "PacketFragmenter.h"
+#include <algorithm>
+
+constexpr uint32_t PacketReassembler::DefaultTimeout;
+constexpr uint32_t PacketReassembler::DefaultMaximumLength;
+constexpr uint32_t PacketReassembler::MaximumPending;
+
+PacketReassembler::PacketReassembler ()
+{
+    _timeout = DefaultTimeout;
+    _maximumLength = DefaultMaximumLength;
+    _expired = 0;
+}
+
+PacketReassembler::~PacketReassembler ()
+{
+}
+
+std::shared_ptr<IdpPacket>
+    PacketReassembler::Add (std::shared_ptr<IdpPacket> fragment)
+{
+    auto length = fragment->PayloadLength ();
+
+    if (length <= PacketFragmenter::HeaderLength)
+    {
+        return nullptr;
+    }
+
+    length -= PacketFragmenter::HeaderLength;
+
+    fragment->ResetReadToPayload ();
+
+    auto fragmentId = fragment->Read<uint16_t> ();
+    auto flags = fragment->Read<uint8_t> ();
+    auto total = fragment->Read<uint32_t> ();
+    auto offset = fragment->Read<uint32_t> ();
+
+    fragment->ResetRead ();
+
+    if (total > _maximumLength || offset >= total || length > total - offset)
+    {
+        return nullptr;
+    }
+
+    auto source = fragment->Source ();
+
+    auto reassembly =
+        std::find_if (_pending.begin (), _pending.end (),
+                      [&](const Reassembly& entry) {
+                          return entry.Source == source &&
+                                 entry.FragmentId == fragmentId;
+                      });
+
+    if (reassembly == _pending.end ())
+    {
+        if (_pending.size () >= MaximumPending)
+        {
+            _pending.erase (_pending.begin ());
+        }
+
+        Reassembly entry;
+        entry.Source = source;
+        entry.FragmentId = fragmentId;
+        entry.Packet = std::shared_ptr<IdpPacket> (
+            new IdpPacket (total,
+                           (IdpFlags) (flags & ~(uint8_t) IdpFlags::Fragment),
+                           source, fragment->Destination ()));
+        entry.Received = 0;
+        entry.Started = Application::GetApplicationTime ();
+
+        _pending.push_back (std::move (entry));
+
+        reassembly = _pending.end () - 1;
+
+        if (_expiryTimer == nullptr)
+        {
+            _expiryTimer.reset (new ScheduledTimer (
+                std::max (IdpScheduler::Resolution, _timeout / 4),
+                [&]() { Expire (); }));
+        }
+
+        if (!_expiryTimer->IsEnabled ())
+        {
+            _expiryTimer->Start ();
+        }
+    }
+    else if (reassembly->Packet->PayloadLength () != total ||
+             std::any_of (reassembly->Extents.begin (),
+                          reassembly->Extents.end (),
+                          [&](const FragmentExtent& extent) {
+                              return offset < extent.Offset + extent.Length &&
+                                     extent.Offset < offset + length;
+                          }))
+    {
+        // Inconsistent, duplicated or overlapping.
+        return nullptr;
+    }
+
+    memcpy (reassembly->Packet->Payload () + offset,
+            fragment->Payload () + PacketFragmenter::HeaderLength, length);
+
+    reassembly->Extents.push_back ({ offset, length });
+    reassembly->Received += length;
+
+    if (reassembly->Received < total)
+    {
+        return nullptr;
+    }
+
+    auto result = reassembly->Packet;
+
+    _pending.erase (reassembly);
+
+    result->IncrementWritePointer (total);
+    result->Seal ();
+
+    return result;
+}
+
+void PacketReassembler::Expire ()
+{
+    auto now = Application::GetApplicationTime ();
+
+    auto count = _pending.size ();
+
+    _pending.erase (std::remove_if (_pending.begin (), _pending.end (),
+                                    [&](const Reassembly& entry) {
+                                        return now - entry.Started >= _timeout;
+                                    }),
+                    _pending.end ());
+
+    _expired += count - _pending.size ();
+
+    if (_pending.empty ())
+    {
+        _expiryTimer->Stop ();
+    }
+}
+
+uint32_t PacketReassembler::Timeout ()
+{
+    return _timeout;
+}
+
+void PacketReassembler::Timeout (uint32_t value)
+{
+    _timeout = value;
+
+    if (_expiryTimer != nullptr)
+    {
+        _expiryTimer->Interval (std::max (IdpScheduler::Resolution, value / 4));
+    }
+}
+
+uint32_t PacketReassembler::MaximumLength ()
+{
+    return _maximumLength;
+}
+
+void PacketReassembler::MaximumLength (uint32_t value)
+{
+    _maximumLength = value;
+}
+
+uint32_t PacketReassembler::Pending ()
+{
+    return _pending.size ();
+}
+
+uint32_t PacketReassembler::Expired ()
+{
+    return _expired;
+}
+
+void PacketReassembler::Clear ()
+{
+    _pending.clear ();
+
+    if (_expiryTimer != nullptr)
+    {
+        _expiryTimer->Stop ();
+    }
+}
@@ -0,0 +1,100 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "IdpPacket.h"
+#include "ScheduledTimer.h"
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * The part of a packet's payload carried by one fragment.
+ */
+struct FragmentExtent
+{
+    uint32_t Offset;
+    uint32_t Length;
+};
+
+/**
+ * A packet being rebuilt from its fragments. The extents received never
+ * overlap, so the packet is complete once they add up to its length.
+ */
+struct Reassembly
+{
+    uint16_t Source;
+    uint16_t FragmentId;
+    std::shared_ptr<IdpPacket> Packet;
+    uint32_t Received;
+    std::vector<FragmentExtent> Extents;
+    uint64_t Started;
+};
+
+/**
+ *  PacketReassembler
+ *
+ *  Rebuilds packets split by a PacketFragmenter. The payload of each packet
+ *  is allocated once, when its first fragment arrives, and fragments are
+ *  copied straight into place so they may arrive in any order. Packets that
+ *  are not complete within the timeout are discarded.
+ */
+class PacketReassembler
+{
+  public:
+    static constexpr uint32_t DefaultTimeout = 1000;
+
+    static constexpr uint32_t DefaultMaximumLength = 0x10000;
+
+    /**
+     * Packets that may be reassembled at the same time. When another one
+     * starts, the oldest is discarded.
+     */
+    static constexpr uint32_t MaximumPending = 8;
+
+    /**
+     * Instantiates a new instance of PacketReassembler
+     */
+    PacketReassembler ();
+    ~PacketReassembler ();
+
+    /**
+     * Adds a fragment, returning the original packet once every byte of it
+     * has arrived, or nullptr until then. Fragments that overlap one already
+     * received, duplicates included, are dropped.
+     */
+    std::shared_ptr<IdpPacket> Add (std::shared_ptr<IdpPacket> fragment);
+
+    /**
+     * Time a packet may take to be reassembled.
+     */
+    uint32_t Timeout ();
+    void Timeout (uint32_t value);
+
+    /**
+     * Largest payload that will be reassembled, so a corrupt or hostile
+     * fragment cannot force a huge allocation.
+     */
+    uint32_t MaximumLength ();
+    void MaximumLength (uint32_t value);
+
+    uint32_t Pending ();
+
+    /**
+     * Packets discarded because they were not complete in time.
+     */
+    uint32_t Expired ();
+
+    void Clear ();
+
+  private:
+    void Expire ();
+
+    std::vector<Reassembly> _pending;
+    uint32_t _timeout;
+    uint32_t _maximumLength;
+    uint32_t _expired;
+
+    std::unique_ptr<ScheduledTimer> _expiryTimer;
+};
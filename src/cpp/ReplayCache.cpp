@@ -0,0 +1,189 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "ReplayCache.h"
+#include "Application.h"
+#include <algorithm>
+
+constexpr uint32_t ReplayCache::DefaultCapacity;
+constexpr uint32_t ReplayCache::DefaultPendingTimeout;
+
+ReplayCache::ReplayCache ()
+{
+    _capacity = DefaultCapacity;
+    _pendingTimeout = DefaultPendingTimeout;
+    _useCounter = 0;
+    _hits = 0;
+    _misses = 0;
+}
+
+const std::vector<uint8_t>* ReplayCache::Find (uint16_t source,
+                                               uint32_t transactionId,
+                                               uint16_t commandId)
+{
+    for (auto& entry : _entries)
+    {
+        if (entry.TransactionId == transactionId && entry.Source == source &&
+            entry.CommandId == commandId)
+        {
+            entry.LastUsed = ++_useCounter;
+            _hits++;
+
+            return &entry.Payload;
+        }
+    }
+
+    _misses++;
+
+    return nullptr;
+}
+
+void ReplayCache::Store (uint16_t source, uint32_t transactionId,
+                         uint16_t commandId, const uint8_t* payload,
+                         uint32_t length)
+{
+    if (_capacity == 0)
+    {
+        return;
+    }
+
+    Entry* target = nullptr;
+
+    if (_entries.size () < _capacity)
+    {
+        _entries.push_back (Entry ());
+        target = &_entries.back ();
+    }
+    else
+    {
+        // Small enough that a scan beats keeping a separate recency list.
+        target = &*std::min_element (
+            _entries.begin (), _entries.end (),
+            [](const Entry& a, const Entry& b) {
+                return a.LastUsed < b.LastUsed;
+            });
+    }
+
+    target->Source = source;
+    target->TransactionId = transactionId;
+    target->CommandId = commandId;
+    target->LastUsed = ++_useCounter;
+    target->Payload.assign (payload, payload + length);
+
+    EndPending (source, transactionId, commandId);
+}
+
+void ReplayCache::BeginPending (uint16_t source, uint32_t transactionId,
+                                uint16_t commandId)
+{
+    if (_capacity == 0 || IsPending (source, transactionId, commandId))
+    {
+        return;
+    }
+
+    // A handler that never responds must not hold its slot forever, the
+    // oldest request is forgotten first.
+    if (_pending.size () >= _capacity)
+    {
+        _pending.erase (_pending.begin ());
+    }
+
+    _pending.push_back ({ source, transactionId, commandId,
+                          Application::GetApplicationTime () });
+}
+
+void ReplayCache::EndPending (uint16_t source, uint32_t transactionId,
+                              uint16_t commandId)
+{
+    for (auto it = _pending.begin (); it != _pending.end (); it++)
+    {
+        if (it->TransactionId == transactionId && it->Source == source &&
+            it->CommandId == commandId)
+        {
+            _pending.erase (it);
+
+            return;
+        }
+    }
+}
+
+bool ReplayCache::IsPending (uint16_t source, uint32_t transactionId,
+                             uint16_t commandId)
+{
+    for (auto it = _pending.begin (); it != _pending.end (); it++)
+    {
+        if (it->TransactionId == transactionId && it->Source == source &&
+            it->CommandId == commandId)
+        {
+            if (Application::GetApplicationTime () - it->Started <
+                _pendingTimeout)
+            {
+                return true;
+            }
+
+            _pending.erase (it);
+
+            return false;
+        }
+    }
+
+    return false;
+}
+
+uint32_t ReplayCache::PendingTimeout ()
+{
+    return _pendingTimeout;
+}
+
+void ReplayCache::PendingTimeout (uint32_t value)
+{
+    _pendingTimeout = value;
+}
+
+void ReplayCache::Clear ()
+{
+    _entries.clear ();
+    _pending.clear ();
+}
+
+uint32_t ReplayCache::Capacity ()
+{
+    return _capacity;
+}
+
+void ReplayCache::Capacity (uint32_t value)
+{
+    _capacity = value;
+
+    while (_entries.size () > _capacity)
+    {
+        auto oldest = std::min_element (
+            _entries.begin (), _entries.end (),
+            [](const Entry& a, const Entry& b) {
+                return a.LastUsed < b.LastUsed;
+            });
+
+        _entries.erase (oldest);
+    }
+
+    if (_pending.size () > _capacity)
+    {
+        _pending.erase (_pending.begin (),
+                        _pending.begin () + (_pending.size () - _capacity));
+    }
+}
+
+uint32_t ReplayCache::Count ()
+{
+    return _entries.size ();
+}
+
+uint32_t ReplayCache::Hits ()
+{
+    return _hits;
+}
+
+uint32_t ReplayCache::Misses ()
+{
+    return _misses;
+}
@@ -0,0 +1,110 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ *  ReplayCache
+ *
+ *  Bounded least recently used store of serialized responses keyed by the
+ *  requesting node and transaction id. A retried request whose response was
+ *  lost is answered from here instead of running its handler again.
+ */
+class ReplayCache
+{
+  public:
+    static constexpr uint32_t DefaultCapacity = 16;
+
+    /**
+     * How long a request stays pending without a response, the time a
+     * requester waits for one by default.
+     */
+    static constexpr uint32_t DefaultPendingTimeout = 1750;
+
+    /**
+     * Instantiates a new instance of ReplayCache
+     */
+    ReplayCache ();
+
+    /**
+     * Returns the response payload stored for the request, or nullptr. The
+     * pointer is only valid until the cache is next modified.
+     */
+    const std::vector<uint8_t>* Find (uint16_t source, uint32_t transactionId,
+                                      uint16_t commandId);
+
+    /**
+     * Stores a response payload, evicting the least recently used entry if
+     * the cache is full.
+     */
+    void Store (uint16_t source, uint32_t transactionId, uint16_t commandId,
+                const uint8_t* payload, uint32_t length);
+
+    /**
+     * Records that the request is being handled, so retries that arrive
+     * before its response is stored can be dropped. Storing the response or
+     * calling EndPending ends it.
+     */
+    void BeginPending (uint16_t source, uint32_t transactionId,
+                       uint16_t commandId);
+
+    void EndPending (uint16_t source, uint32_t transactionId,
+                     uint16_t commandId);
+
+    /**
+     * Returns true if the request has been begun and has no response yet,
+     * unless that was longer ago than the pending timeout. A handler that
+     * answers some other way, or not at all, then stops holding up retries.
+     */
+    bool IsPending (uint16_t source, uint32_t transactionId,
+                    uint16_t commandId);
+
+    uint32_t PendingTimeout ();
+    void PendingTimeout (uint32_t value);
+
+    void Clear ();
+
+    uint32_t Capacity ();
+    void Capacity (uint32_t value);
+
+    uint32_t Count ();
+
+    /**
+     * Requests answered from the cache.
+     */
+    uint32_t Hits ();
+
+    /**
+     * Requests for cached commands that had to run their handler.
+     */
+    uint32_t Misses ();
+
+  private:
+    struct Entry
+    {
+        uint16_t Source;
+        uint32_t TransactionId;
+        uint16_t CommandId;
+        uint32_t LastUsed;
+        std::vector<uint8_t> Payload;
+    };
+
+    struct Key
+    {
+        uint16_t Source;
+        uint32_t TransactionId;
+        uint16_t CommandId;
+        uint64_t Started;
+    };
+
+    std::vector<Entry> _entries;
+    std::vector<Key> _pending;
+    uint32_t _capacity;
+    uint32_t _pendingTimeout;
+    uint32_t _useCounter;
+    uint32_t _hits;
+    uint32_t _misses;
+};
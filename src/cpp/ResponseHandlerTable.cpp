@@ -0,0 +1,138 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "ResponseHandlerTable.h"
+
+static constexpr uint32_t InitialBits = 4;
+
+ResponseHandlerTable::ResponseHandlerTable ()
+    : _slots (1u << InitialBits), _count (0), _shift (32 - InitialBits)
+{
+}
+
+uint32_t ResponseHandlerTable::Home (uint32_t transactionId)
+{
+    // Fibonacci hashing spreads the sequential ids nodes hand out.
+    return (transactionId * 2654435769u) >> _shift;
+}
+
+int32_t ResponseHandlerTable::IndexOf (uint32_t transactionId)
+{
+    uint32_t mask = _slots.size () - 1;
+
+    for (uint32_t i = Home (transactionId);; i = (i + 1) & mask)
+    {
+        auto& slot = _slots[i];
+
+        if (!slot.IsUsed)
+        {
+            return -1;
+        }
+
+        if (slot.TransactionId == transactionId)
+        {
+            return i;
+        }
+    }
+}
+
+ResponseHandlerTimeout* ResponseHandlerTable::Find (uint32_t transactionId)
+{
+    auto index = IndexOf (transactionId);
+
+    if (index < 0)
+    {
+        return nullptr;
+    }
+
+    return &_slots[index].Entry;
+}
+
+ResponseHandlerTimeout& ResponseHandlerTable::Insert (uint32_t transactionId)
+{
+    // Keep at most half the slots in use so probe sequences stay short.
+    if ((_count + 1) * 2 > _slots.size ())
+    {
+        Grow ();
+    }
+
+    uint32_t mask = _slots.size () - 1;
+    uint32_t i = Home (transactionId);
+
+    while (_slots[i].IsUsed)
+    {
+        i = (i + 1) & mask;
+    }
+
+    auto& slot = _slots[i];
+
+    slot.TransactionId = transactionId;
+    slot.IsUsed = true;
+
+    _count++;
+
+    return slot.Entry;
+}
+
+bool ResponseHandlerTable::Remove (uint32_t transactionId,
+                                   ResponseHandlerTimeout& removed)
+{
+    auto index = IndexOf (transactionId);
+
+    if (index < 0)
+    {
+        return false;
+    }
+
+    uint32_t mask = _slots.size () - 1;
+    uint32_t hole = index;
+
+    removed = std::move (_slots[hole].Entry);
+
+    // Shift later members of the probe run back into the hole so lookups
+    // never need tombstones.
+    for (uint32_t i = (hole + 1) & mask; _slots[i].IsUsed; i = (i + 1) & mask)
+    {
+        uint32_t home = Home (_slots[i].TransactionId);
+
+        bool inPlace = hole <= i ? (hole < home && home <= i)
+                                 : (hole < home || home <= i);
+
+        if (!inPlace)
+        {
+            _slots[hole].TransactionId = _slots[i].TransactionId;
+            _slots[hole].Entry = std::move (_slots[i].Entry);
+            hole = i;
+        }
+    }
+
+    _slots[hole].IsUsed = false;
+    _slots[hole].Entry.handler = nullptr;
+
+    _count--;
+
+    return true;
+}
+
+uint32_t ResponseHandlerTable::Count ()
+{
+    return _count;
+}
+
+void ResponseHandlerTable::Grow ()
+{
+    std::vector<Slot> slots (_slots.size () * 2);
+
+    std::swap (slots, _slots);
+
+    _shift--;
+    _count = 0;
+
+    for (auto& slot : slots)
+    {
+        if (slot.IsUsed)
+        {
+            Insert (slot.TransactionId) = std::move (slot.Entry);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "IdpResponse.h"
+#include "InlineFunction.h"
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+typedef InlineFunction<void(std::shared_ptr<IdpResponse> response)>
+    OneTimeResponseHandler;
+
+typedef struct
+{
+    OneTimeResponseHandler handler;
+    uint64_t expiry;
+    uint32_t timer;
+} ResponseHandlerTimeout;
+
+/**
+ * Open addressed table of one-time response handlers keyed by transaction
+ * id. Entries live in one contiguous array that only grows, so registering
+ * and completing handlers does not allocate once it has reached the number
+ * of requests in flight.
+ */
+class ResponseHandlerTable
+{
+  public:
+    ResponseHandlerTable ();
+
+    /**
+     * Returns the handler for transactionId, or nullptr. The pointer is
+     * only valid until the table is next modified.
+     */
+    ResponseHandlerTimeout* Find (uint32_t transactionId);
+
+    /**
+     * Adds an empty entry for transactionId, which must not be present.
+     */
+    ResponseHandlerTimeout& Insert (uint32_t transactionId);
+
+    /**
+     * Removes the entry for transactionId, moving its handler into
+     * removed. Returns false if there was no entry.
+     */
+    bool Remove (uint32_t transactionId, ResponseHandlerTimeout& removed);
+
+    uint32_t Count ();
+
+    template <typename TCallback>
+    void ForEach (TCallback callback)
+    {
+        for (auto& slot : _slots)
+        {
+            if (slot.IsUsed)
+            {
+                callback (slot.Entry);
+            }
+        }
+    }
+
+  private:
+    struct Slot
+    {
+        uint32_t TransactionId;
+        bool IsUsed;
+        ResponseHandlerTimeout Entry;
+    };
+
+    uint32_t Home (uint32_t transactionId);
+    int32_t IndexOf (uint32_t transactionId);
+    void Grow ();
+
+    std::vector<Slot> _slots;
+    uint32_t _count;
+    uint32_t _shift;
+};
@@ -0,0 +1,107 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "RttEstimator.h"
+#include "IdpCommandManager.h"
+#include "IdpScheduler.h"
+#include <algorithm>
+
+constexpr uint32_t RttEstimator::MinTimeout;
+constexpr uint32_t RttEstimator::MaxTimeout;
+
+RttEstimator::RttEstimator ()
+{
+    _initialTimeout = IdpCommandManager::DefaultTimeout;
+}
+
+RttStatistics& RttEstimator::Entry (uint16_t destination)
+{
+    auto it = _destinations.find (destination);
+
+    if (it == _destinations.end ())
+    {
+        auto statistics = RttStatistics ();
+        statistics.RetransmitTimeout = _initialTimeout;
+
+        it = _destinations.insert (std::make_pair (destination, statistics))
+                 .first;
+    }
+
+    return it->second;
+}
+
+uint32_t RttEstimator::Timeout (uint16_t destination, uint8_t attempt)
+{
+    uint64_t timeout = Entry (destination).RetransmitTimeout;
+
+    for (uint8_t i = 0; i < attempt && timeout < MaxTimeout; i++)
+    {
+        timeout *= 2;
+    }
+
+    return std::min<uint64_t> (timeout, MaxTimeout);
+}
+
+void RttEstimator::OnSample (uint16_t destination, uint32_t rtt)
+{
+    auto& statistics = Entry (destination);
+
+    if (statistics.Samples == 0)
+    {
+        statistics.SmoothedRtt = rtt;
+        statistics.RttVariance = rtt / 2;
+    }
+    else
+    {
+        uint32_t deviation = statistics.SmoothedRtt > rtt
+                                 ? statistics.SmoothedRtt - rtt
+                                 : rtt - statistics.SmoothedRtt;
+
+        statistics.RttVariance =
+            (3 * statistics.RttVariance + deviation) / 4;
+        statistics.SmoothedRtt = (7 * statistics.SmoothedRtt + rtt) / 8;
+    }
+
+    statistics.Samples++;
+
+    // Timeouts are only noticed at the scheduler's resolution.
+    uint32_t timeout =
+        statistics.SmoothedRtt +
+        std::max<uint32_t> (IdpScheduler::Resolution,
+                            4 * statistics.RttVariance);
+
+    statistics.RetransmitTimeout =
+        std::min (std::max (timeout, MinTimeout), MaxTimeout);
+}
+
+void RttEstimator::OnRetransmit (uint16_t destination)
+{
+    Entry (destination).Retransmissions++;
+}
+
+const RttStatistics* RttEstimator::Statistics (uint16_t destination)
+{
+    auto it = _destinations.find (destination);
+
+    if (it == _destinations.end ())
+    {
+        return nullptr;
+    }
+
+    return &it->second;
+}
+
+uint32_t RttEstimator::InitialTimeout ()
+{
+    return _initialTimeout;
+}
+
+void RttEstimator::InitialTimeout (uint32_t value)
+{
+    _initialTimeout = value;
+}
+
+void RttEstimator::Clear ()
+{
+    _destinations.clear ();
+}
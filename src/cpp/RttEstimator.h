@@ -0,0 +1,67 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include <map>
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t SmoothedRtt;
+    uint32_t RttVariance;
+    uint32_t RetransmitTimeout;
+    uint32_t Samples;
+    uint32_t Retransmissions;
+} RttStatistics;
+
+/**
+ *  RttEstimator
+ *
+ *  Round trip time estimates per destination, following Jacobson/Karels.
+ *  Each sample updates the smoothed RTT and its mean deviation, and the
+ *  retransmission timeout is the smoothed RTT plus four deviations. Only
+ *  requests answered on their first transmission are sampled, so an answer
+ *  to a retransmission is never credited to the wrong send (Karn).
+ */
+class RttEstimator
+{
+  public:
+    static constexpr uint32_t MinTimeout = 50;
+    static constexpr uint32_t MaxTimeout = 8000;
+
+    /**
+     * Instantiates a new instance of RttEstimator
+     */
+    RttEstimator ();
+
+    /**
+     * Timeout for the given transmission of a request, doubled for every
+     * retransmission up to MaxTimeout.
+     */
+    uint32_t Timeout (uint16_t destination, uint8_t attempt);
+
+    void OnSample (uint16_t destination, uint32_t rtt);
+
+    void OnRetransmit (uint16_t destination);
+
+    /**
+     * Returns the statistics for destination, or nullptr if no request has
+     * been sent there.
+     */
+    const RttStatistics* Statistics (uint16_t destination);
+
+    /**
+     * Timeout used towards destinations without samples.
+     */
+    uint32_t InitialTimeout ();
+    void InitialTimeout (uint32_t value);
+
+    void Clear ();
+
+  private:
+    RttStatistics& Entry (uint16_t destination);
+
+    std::map<uint16_t, RttStatistics> _destinations;
+    uint32_t _initialTimeout;
+};
@@ -0,0 +1,62 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "ScheduledTimer.h"
+#include "Application.h"
+
+ScheduledTimer::ScheduledTimer (uint32_t interval, std::function<void()> tick)
+{
+    _tick = tick;
+    _interval = interval;
+    _handle = IdpScheduler::InvalidHandle;
+    _targetId = IdpScheduler::Instance ().Register (*this);
+}
+
+ScheduledTimer::~ScheduledTimer ()
+{
+    Stop ();
+
+    IdpScheduler::Instance ().Unregister (_targetId);
+}
+
+void ScheduledTimer::Start ()
+{
+    Stop ();
+
+    _handle = IdpScheduler::Instance ().Schedule (
+        _targetId, 0, Application::GetApplicationTime () + _interval);
+}
+
+void ScheduledTimer::Stop ()
+{
+    if (_handle != IdpScheduler::InvalidHandle)
+    {
+        IdpScheduler::Instance ().Cancel (_handle);
+
+        _handle = IdpScheduler::InvalidHandle;
+    }
+}
+
+bool ScheduledTimer::IsEnabled ()
+{
+    return _handle != IdpScheduler::InvalidHandle;
+}
+
+uint32_t ScheduledTimer::Interval ()
+{
+    return _interval;
+}
+
+void ScheduledTimer::Interval (uint32_t value)
+{
+    _interval = value;
+}
+
+void ScheduledTimer::OnScheduled (uint32_t cookie)
+{
+    // Rearm first so the tick is free to stop the timer.
+    _handle = IdpScheduler::Instance ().Schedule (
+        _targetId, 0, Application::GetApplicationTime () + _interval);
+
+    _tick ();
+}
@@ -0,0 +1,41 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "IdpScheduler.h"
+#include <functional>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ *  ScheduledTimer
+ *
+ *  A repeating timer driven by the shared IdpScheduler rather than its own
+ *  dispatcher timer.
+ */
+class ScheduledTimer : public ISchedulerTarget
+{
+  public:
+    /**
+     * Instantiates a new instance of ScheduledTimer
+     */
+    ScheduledTimer (uint32_t interval, std::function<void()> tick);
+    ~ScheduledTimer ();
+
+    void Start ();
+    void Stop ();
+
+    bool IsEnabled ();
+
+    uint32_t Interval ();
+    void Interval (uint32_t value);
+
+    void OnScheduled (uint32_t cookie);
+
+  private:
+    std::function<void()> _tick;
+    uint32_t _interval;
+    uint32_t _targetId;
+    uint32_t _handle;
+};
@@ -0,0 +1,103 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "IdpResponse.h"
+#include "IncomingTransaction.h"
+#include "OutgoingTransaction.h"
+#include <memory>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef bool (*StaticCommandDispatcher) (
+    void* context, uint16_t commandId,
+    std::shared_ptr<IncomingTransaction> incomingTransaction,
+    std::shared_ptr<OutgoingTransaction> outgoingTransaction,
+    IdpResponseCode& responseCode);
+
+/**
+ *  StaticCommand
+ *
+ *  Binds a command id to a member function of TNode at compile time.
+ */
+template <typename TNode, uint16_t Id,
+          IdpResponseCode (TNode::*Handler) (
+              std::shared_ptr<IncomingTransaction> incomingTransaction,
+              std::shared_ptr<OutgoingTransaction> outgoingTransaction)>
+struct StaticCommand
+{
+    static constexpr uint16_t CommandId = Id;
+
+    static IdpResponseCode
+        Invoke (void* context,
+                std::shared_ptr<IncomingTransaction> incomingTransaction,
+                std::shared_ptr<OutgoingTransaction> outgoingTransaction)
+    {
+        return (static_cast<TNode*> (context)->*Handler) (incomingTransaction,
+                                                           outgoingTransaction);
+    }
+};
+
+/**
+ *  StaticCommandTable
+ *
+ *  A command table fixed at compile time for nodes whose command set never
+ *  changes. Dispatch compares against constant ids only, which the compiler
+ *  reduces to a switch, so no table is searched at runtime.
+ *
+ *  typedef StaticCommandTable<
+ *      StaticCommand<MyNode, 0xB000, &MyNode::HandleStart>,
+ *      StaticCommand<MyNode, 0xB001, &MyNode::HandleStop>> MyCommands;
+ *
+ *  Manager ().RegisterStaticCommands<MyCommands> (this);
+ */
+template <typename... TCommands>
+struct StaticCommandTable;
+
+template <>
+struct StaticCommandTable<>
+{
+    static constexpr bool Contains (uint16_t commandId)
+    {
+        return false;
+    }
+
+    static bool Dispatch (void* context, uint16_t commandId,
+                          std::shared_ptr<IncomingTransaction> incoming,
+                          std::shared_ptr<OutgoingTransaction> outgoing,
+                          IdpResponseCode& responseCode)
+    {
+        return false;
+    }
+};
+
+template <typename TCommand, typename... TRest>
+struct StaticCommandTable<TCommand, TRest...>
+{
+    static_assert (!StaticCommandTable<TRest...>::Contains (
+                       TCommand::CommandId),
+                   "Command id appears twice in a static command table.");
+
+    static constexpr bool Contains (uint16_t commandId)
+    {
+        return commandId == TCommand::CommandId ||
+               StaticCommandTable<TRest...>::Contains (commandId);
+    }
+
+    static bool Dispatch (void* context, uint16_t commandId,
+                          std::shared_ptr<IncomingTransaction> incoming,
+                          std::shared_ptr<OutgoingTransaction> outgoing,
+                          IdpResponseCode& responseCode)
+    {
+        if (commandId == TCommand::CommandId)
+        {
+            responseCode = TCommand::Invoke (context, incoming, outgoing);
+
+            return true;
+        }
+
+        return StaticCommandTable<TRest...>::Dispatch (
+            context, commandId, incoming, outgoing, responseCode);
+    }
+};
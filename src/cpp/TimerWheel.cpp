@@ -0,0 +1,192 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "TimerWheel.h"
+
+constexpr uint32_t TimerWheel::InvalidHandle;
+
+TimerWheel::TimerWheel ()
+{
+    for (uint32_t i = 0; i < SlotCount; i++)
+    {
+        _slots[i] = -1;
+    }
+
+    _free = -1;
+    _count = 0;
+    _current = 0;
+}
+
+TimerWheel::~TimerWheel ()
+{
+}
+
+uint32_t TimerWheel::Count ()
+{
+    return _count;
+}
+
+uint32_t TimerWheel::Schedule (uint64_t now, uint64_t expiry, uint64_t id)
+{
+    if (_count == 0)
+    {
+        _current = now;
+    }
+
+    // The slot for the current tick has already been processed.
+    if (expiry <= _current)
+    {
+        expiry = _current + 1;
+    }
+
+    int32_t index;
+
+    if (_free != -1)
+    {
+        index = _free;
+        _free = _entries[index].Next;
+    }
+    else
+    {
+        index = (int32_t) _entries.size ();
+        _entries.push_back (Entry ());
+    }
+
+    auto& entry = _entries[index];
+    entry.Expiry = expiry;
+    entry.Id = id;
+
+    Insert (index);
+
+    _count++;
+
+    return (uint32_t) index;
+}
+
+void TimerWheel::Cancel (uint32_t handle)
+{
+    if (handle >= _entries.size () || _entries[handle].Slot == -1)
+    {
+        return;
+    }
+
+    Unlink ((int32_t) handle);
+
+    _entries[handle].Next = _free;
+    _free = (int32_t) handle;
+
+    _count--;
+}
+
+void TimerWheel::Insert (int32_t index)
+{
+    auto& entry = _entries[index];
+
+    if (entry.Expiry < _current)
+    {
+        entry.Expiry = _current;
+    }
+
+    if (entry.Expiry - _current >= Range)
+    {
+        entry.Expiry = _current + Range - 1;
+    }
+
+    auto delta = entry.Expiry - _current;
+    int32_t slot;
+
+    if (delta < Level0Size)
+    {
+        slot = (int32_t) (entry.Expiry & Level0Mask);
+    }
+    else
+    {
+        uint32_t level = 1;
+        uint32_t shift = Level0Bits;
+
+        while (level < UpperLevels &&
+               delta >= ((uint64_t) 1 << (shift + LevelBits)))
+        {
+            level++;
+            shift += LevelBits;
+        }
+
+        slot = (int32_t) (Level0Size + (level - 1) * LevelSize +
+                          ((entry.Expiry >> shift) & LevelMask));
+    }
+
+    entry.Slot = slot;
+    entry.Previous = -1;
+    entry.Next = _slots[slot];
+
+    if (entry.Next != -1)
+    {
+        _entries[entry.Next].Previous = index;
+    }
+
+    _slots[slot] = index;
+}
+
+void TimerWheel::Unlink (int32_t index)
+{
+    auto& entry = _entries[index];
+
+    if (entry.Previous != -1)
+    {
+        _entries[entry.Previous].Next = entry.Next;
+    }
+    else
+    {
+        _slots[entry.Slot] = entry.Next;
+    }
+
+    if (entry.Next != -1)
+    {
+        _entries[entry.Next].Previous = entry.Previous;
+    }
+
+    entry.Slot = -1;
+}
+
+void TimerWheel::Cascade ()
+{
+    uint32_t shift = Level0Bits;
+
+    // Each time a level wraps, the next slot of the level above is spread
+    // over the levels below it, highest level first.
+    for (uint32_t level = 1; level <= UpperLevels; level++)
+    {
+        if ((_current & (((uint64_t) 1 << shift) - 1)) != 0)
+        {
+            break;
+        }
+
+        shift += LevelBits;
+    }
+
+    while (shift > Level0Bits)
+    {
+        shift -= LevelBits;
+
+        auto level = (shift - Level0Bits) / LevelBits + 1;
+
+        CascadeSlot ((int32_t) (Level0Size + (level - 1) * LevelSize +
+                                ((_current >> shift) & LevelMask)));
+    }
+}
+
+void TimerWheel::CascadeSlot (int32_t slot)
+{
+    auto index = _slots[slot];
+
+    _slots[slot] = -1;
+
+    while (index != -1)
+    {
+        auto next = _entries[index].Next;
+
+        Insert (index);
+
+        index = next;
+    }
+}
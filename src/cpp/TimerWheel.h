@@ -0,0 +1,110 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ *  TimerWheel
+ *
+ *  Hierarchical timing wheel with a 1 ms resolution. Scheduling and
+ *  cancelling are O(1), and advancing the wheel only touches entries that are
+ *  due or that cascade down a level. The first level covers 256 ms and each
+ *  of the three levels above it is 64 times coarser, giving a range of about
+ *  18 hours. Later expiries are clamped to the end of the range.
+ */
+class TimerWheel
+{
+  public:
+    static constexpr uint32_t InvalidHandle = 0xFFFFFFFF;
+
+    /**
+     * Instantiates a new instance of TimerWheel
+     */
+    TimerWheel ();
+    ~TimerWheel ();
+
+    /**
+     * Schedules id to expire at expiry. The returned handle stays valid
+     * until the entry expires or is cancelled.
+     */
+    uint32_t Schedule (uint64_t now, uint64_t expiry, uint64_t id);
+
+    void Cancel (uint32_t handle);
+
+    uint32_t Count ();
+
+    /**
+     * Moves the wheel forward to now, calling onExpired with the id of each
+     * entry that has become due. The callback may schedule and cancel
+     * entries.
+     */
+    template <typename TCallback>
+    void Advance (uint64_t now, TCallback onExpired)
+    {
+        if (_count == 0)
+        {
+            _current = now;
+            return;
+        }
+
+        while (_current < now && _count != 0)
+        {
+            _current++;
+
+            Cascade ();
+
+            auto slot = _current & Level0Mask;
+
+            while (_slots[slot] != -1)
+            {
+                auto index = _slots[slot];
+                auto id = _entries[index].Id;
+
+                Cancel ((uint32_t) index);
+
+                onExpired (id);
+            }
+        }
+
+        if (_current < now)
+        {
+            _current = now;
+        }
+    }
+
+  private:
+    static constexpr uint32_t Level0Bits = 8;
+    static constexpr uint32_t LevelBits = 6;
+    static constexpr uint32_t Level0Size = 1 << Level0Bits;
+    static constexpr uint32_t LevelSize = 1 << LevelBits;
+    static constexpr uint32_t Level0Mask = Level0Size - 1;
+    static constexpr uint32_t LevelMask = LevelSize - 1;
+    static constexpr uint32_t UpperLevels = 3;
+    static constexpr uint32_t SlotCount = Level0Size + UpperLevels * LevelSize;
+    static constexpr uint64_t Range =
+        (uint64_t) 1 << (Level0Bits + UpperLevels * LevelBits);
+
+    struct Entry
+    {
+        uint64_t Expiry;
+        uint64_t Id;
+        int32_t Next;
+        int32_t Previous;
+        int32_t Slot;
+    };
+
+    void Insert (int32_t index);
+    void Unlink (int32_t index);
+    void Cascade ();
+    void CascadeSlot (int32_t slot);
+
+    std::vector<Entry> _entries;
+    int32_t _slots[SlotCount];
+    int32_t _free;
+    uint32_t _count;
+    uint64_t _current;
+};
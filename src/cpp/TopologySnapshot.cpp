@@ -0,0 +1,158 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "TopologySnapshot.h"
+#include "IdpWire.h"
+#include "MasterNode.h"
+
+constexpr uint32_t TopologySnapshot::Magic;
+constexpr uint8_t TopologySnapshot::Version;
+constexpr uint32_t TopologySnapshot::HeaderLength;
+constexpr uint32_t TopologySnapshot::RecordLength;
+constexpr uint8_t TopologySnapshot::ReportsGenerationFlag;
+
+bool TopologySnapshot::Write (IStream& stream, NodeInfo& root)
+{
+    std::vector<uint8_t> buffer (HeaderLength);
+
+    uint16_t count = 0;
+
+    std::vector<NodeInfo*> pending (root.Children.begin (),
+                                    root.Children.end ());
+
+    // Breadth first, so every parent is read before its children.
+    for (uint32_t i = 0; i < pending.size (); i++)
+    {
+        auto& node = *pending[i];
+
+        Append (buffer, node);
+        count++;
+
+        pending.insert (pending.end (), node.Children.begin (),
+                        node.Children.end ());
+    }
+
+    IdpWire::Store (&buffer[0], Magic);
+    buffer[4] = Version;
+    IdpWire::Store (&buffer[5], count);
+    IdpWire::Store (&buffer[7], (uint32_t) (buffer.size () - HeaderLength));
+
+    return stream.Write (buffer.data (), buffer.size ()) ==
+           (int32_t) buffer.size ();
+}
+
+void TopologySnapshot::Append (std::vector<uint8_t>& buffer, NodeInfo& node)
+{
+    uint32_t nameLength = node.Name == nullptr ? 0 : strlen (node.Name);
+
+    if (nameLength > 0xFF)
+    {
+        nameLength = 0xFF;
+    }
+
+    auto offset = buffer.size ();
+
+    buffer.resize (offset + RecordLength + nameLength);
+
+    auto record = &buffer[offset];
+
+    IdpWire::Store (&record[0], node.Address);
+    IdpWire::Store (&record[2],
+                    node.Parent == nullptr ? UnassignedAddress
+                                           : node.Parent->Address);
+    IdpWire::Store (&record[4], node.Timeout);
+    IdpWire::Store (&record[8], node.EnumeratedGeneration);
+    record[12] = node.ReportsGeneration ? ReportsGenerationFlag : 0;
+    IdpWire::Store (&record[13], node.Guid.Data1);
+    IdpWire::Store (&record[17], node.Guid.Data2);
+    IdpWire::Store (&record[19], node.Guid.Data3);
+    memcpy (&record[21], node.Guid.Data4, 8);
+    record[29] = nameLength;
+
+    if (nameLength > 0)
+    {
+        memcpy (&record[30], node.Name, nameLength);
+    }
+
+    record[30 + nameLength] = 0;
+}
+
+std::shared_ptr<TopologySnapshot> TopologySnapshot::Read (IStream& stream)
+{
+    uint8_t header[HeaderLength];
+
+    if (!stream.TryRead (header, HeaderLength) ||
+        IdpWire::Load<uint32_t> (&header[0]) != Magic ||
+        header[4] != Version)
+    {
+        return nullptr;
+    }
+
+    auto count = IdpWire::Load<uint16_t> (&header[5]);
+    auto length = IdpWire::Load<uint32_t> (&header[7]);
+
+    if (length > (uint32_t) count * (RecordLength + 0xFF))
+    {
+        return nullptr;
+    }
+
+    auto result = std::shared_ptr<TopologySnapshot> (new TopologySnapshot ());
+
+    result->_data.resize (length);
+
+    if (!stream.TryRead (result->_data.data (), length) ||
+        !result->Parse (count))
+    {
+        return nullptr;
+    }
+
+    return result;
+}
+
+bool TopologySnapshot::Parse (uint16_t count)
+{
+    uint32_t offset = 0;
+
+    _nodes.reserve (count);
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (_data.size () - offset < RecordLength)
+        {
+            return false;
+        }
+
+        auto record = &_data[offset];
+
+        uint32_t nameLength = record[29];
+
+        if (_data.size () - offset < RecordLength + nameLength ||
+            record[30 + nameLength] != 0)
+        {
+            return false;
+        }
+
+        Node node;
+        node.Address = IdpWire::Load<uint16_t> (&record[0]);
+        node.Parent = IdpWire::Load<uint16_t> (&record[2]);
+        node.Timeout = IdpWire::Load<uint32_t> (&record[4]);
+        node.Generation = IdpWire::Load<uint32_t> (&record[8]);
+        node.ReportsGeneration = (record[12] & ReportsGenerationFlag) != 0;
+        node.Guid.Data1 = IdpWire::Load<uint32_t> (&record[13]);
+        node.Guid.Data2 = IdpWire::Load<uint16_t> (&record[17]);
+        node.Guid.Data3 = IdpWire::Load<uint16_t> (&record[19]);
+        memcpy (node.Guid.Data4, &record[21], 8);
+        node.Name = reinterpret_cast<const char*> (&record[30]);
+
+        _nodes.push_back (node);
+
+        offset += RecordLength + nameLength;
+    }
+
+    return offset == _data.size ();
+}
+
+const std::vector<TopologySnapshot::Node>& TopologySnapshot::Nodes ()
+{
+    return _nodes;
+}
@@ -0,0 +1,70 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "Guid.h"
+#include "IStream.h"
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+struct NodeInfo;
+
+/**
+ *  TopologySnapshot
+ *
+ *  Binary image of the network a master has enumerated, so that after a
+ *  restart it can take the network over instead of resetting it. Written in
+ *  network order as a header followed by one record per node, parents
+ *  before their children:
+ *
+ *      magic u32, version u8, count u16, length u32
+ *      address u16, parent u16, timeout u32, generation u32, flags u8,
+ *      guid, name length u8, name, 0
+ *
+ *  Names are read in place, so they stay valid as long as the snapshot.
+ */
+class TopologySnapshot
+{
+  public:
+    static constexpr uint32_t Magic = 0x49445054;
+    static constexpr uint8_t Version = 1;
+
+    static constexpr uint32_t HeaderLength = 11;
+    static constexpr uint32_t RecordLength = 31;
+
+    static constexpr uint8_t ReportsGenerationFlag = 0x01;
+
+    struct Node
+    {
+        uint16_t Address;
+        uint16_t Parent;
+        uint32_t Timeout;
+        uint32_t Generation;
+        bool ReportsGeneration;
+        Guid_t Guid;
+        const char* Name;
+    };
+
+    /**
+     * Writes every node below root, not root itself.
+     */
+    static bool Write (IStream& stream, NodeInfo& root);
+
+    /**
+     * Reads a snapshot, or returns nullptr if the stream does not hold a
+     * complete one.
+     */
+    static std::shared_ptr<TopologySnapshot> Read (IStream& stream);
+
+    const std::vector<Node>& Nodes ();
+
+  private:
+    static void Append (std::vector<uint8_t>& buffer, NodeInfo& node);
+
+    bool Parse (uint16_t count);
+
+    std::vector<uint8_t> _data;
+    std::vector<Node> _nodes;
+};
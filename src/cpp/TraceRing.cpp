@@ -0,0 +1,78 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "TraceRing.h"
+
+constexpr uint32_t TraceRing::DefaultCapacity;
+
+TraceRing::TraceRing (uint32_t capacity) : _head (0), _tail (0), _dropped (0)
+{
+    uint32_t size = 1;
+
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    _spans.reset (new TransactionSpan[size]);
+    _mask = size - 1;
+}
+
+TraceRing::~TraceRing ()
+{
+}
+
+bool TraceRing::Push (const TransactionSpan& span)
+{
+    auto head = _head.load (std::memory_order_relaxed);
+
+    if (head - _tail.load (std::memory_order_acquire) > _mask)
+    {
+        _dropped.fetch_add (1, std::memory_order_relaxed);
+
+        return false;
+    }
+
+    _spans[head & _mask] = span;
+
+    _head.store (head + 1, std::memory_order_release);
+
+    return true;
+}
+
+uint32_t TraceRing::Drain (ITraceSink& sink)
+{
+    auto tail = _tail.load (std::memory_order_relaxed);
+    auto head = _head.load (std::memory_order_acquire);
+
+    uint32_t count = 0;
+
+    while (tail != head)
+    {
+        sink.Write (_spans[tail & _mask]);
+
+        tail++;
+        count++;
+
+        // Free each slot once it has been written out.
+        _tail.store (tail, std::memory_order_release);
+    }
+
+    return count;
+}
+
+uint32_t TraceRing::Capacity ()
+{
+    return _mask + 1;
+}
+
+uint32_t TraceRing::Count ()
+{
+    return _head.load (std::memory_order_acquire) -
+           _tail.load (std::memory_order_acquire);
+}
+
+uint32_t TraceRing::Dropped ()
+{
+    return _dropped.load (std::memory_order_relaxed);
+}
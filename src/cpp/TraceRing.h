@@ -0,0 +1,81 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "IdpTransaction.h"
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+/**
+ * One request, from the first time it was sent until its response arrived
+ * or it was given up on. Times are application time in milliseconds.
+ */
+struct TransactionSpan
+{
+    uint32_t TransactionId;
+    uint16_t Source;
+    uint16_t Destination;
+    uint16_t CommandId;
+    uint8_t Attempts;
+    bool TimedOut;
+    IdpResponseCode ResponseCode;
+    uint64_t SentAt;
+    uint64_t CompletedAt;
+};
+
+/**
+ * Receives spans drained from a TraceRing.
+ */
+class ITraceSink
+{
+  public:
+    virtual ~ITraceSink ()
+    {
+    }
+
+    virtual void Write (const TransactionSpan& span) = 0;
+};
+
+/**
+ *  TraceRing
+ *
+ *  Fixed size, lock-free ring of completed spans. Spans are pushed by the
+ *  dispatcher and may be drained into a sink from one other thread, such as
+ *  a logging task, without blocking it. When the ring is full new spans are
+ *  dropped and counted rather than overwriting ones being read.
+ */
+class TraceRing
+{
+  public:
+    static constexpr uint32_t DefaultCapacity = 256;
+
+    /**
+     * Instantiates a new instance of TraceRing. The capacity is rounded up
+     * to a power of two.
+     */
+    TraceRing (uint32_t capacity = DefaultCapacity);
+    ~TraceRing ();
+
+    bool Push (const TransactionSpan& span);
+
+    /**
+     * Passes every span recorded so far to sink, returning how many.
+     */
+    uint32_t Drain (ITraceSink& sink);
+
+    uint32_t Capacity ();
+
+    uint32_t Count ();
+
+    uint32_t Dropped ();
+
+  private:
+    std::unique_ptr<TransactionSpan[]> _spans;
+    uint32_t _mask;
+
+    std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _tail;
+    std::atomic<uint32_t> _dropped;
+};
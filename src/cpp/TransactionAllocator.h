@@ -0,0 +1,103 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ *  TransactionAllocator
+ *
+ *  Allocator for std::allocate_shared that recycles blocks through a small
+ *  free list, so transactions created for every received packet stop hitting
+ *  the heap once the pool has warmed up. Like the dispatcher it is not thread
+ *  safe.
+ */
+template <typename T>
+class TransactionAllocator
+{
+  public:
+    typedef T value_type;
+
+    static constexpr std::size_t MaxPooledBlocks = 32;
+
+    TransactionAllocator ()
+    {
+    }
+
+    template <typename U>
+    TransactionAllocator (const TransactionAllocator<U>& other)
+    {
+    }
+
+    T* allocate (std::size_t count)
+    {
+        auto& blocks = FreeBlocks ();
+
+        if (count == 1 && !blocks.empty ())
+        {
+            auto block = blocks.back ();
+            blocks.pop_back ();
+
+            return static_cast<T*> (block);
+        }
+
+        return static_cast<T*> (::operator new (count * sizeof (T)));
+    }
+
+    void deallocate (T* block, std::size_t count)
+    {
+        auto& blocks = FreeBlocks ();
+
+        if (count == 1 && blocks.size () < MaxPooledBlocks)
+        {
+            blocks.push_back (block);
+        }
+        else
+        {
+            ::operator delete (block);
+        }
+    }
+
+    template <typename U, typename... TArgs>
+    void construct (U* pointer, TArgs&&... args)
+    {
+        ::new ((void*) pointer) U (std::forward<TArgs> (args)...);
+    }
+
+    template <typename U>
+    void destroy (U* pointer)
+    {
+        pointer->~U ();
+    }
+
+  private:
+    static std::vector<void*>& FreeBlocks ()
+    {
+        // Reserved up front so returning a block never allocates.
+        static std::vector<void*>* blocks = [] {
+            auto result = new std::vector<void*> ();
+            result->reserve (MaxPooledBlocks);
+            return result;
+        }();
+
+        return *blocks;
+    }
+};
+
+template <typename T, typename U>
+bool operator== (const TransactionAllocator<T>& a,
+                 const TransactionAllocator<U>& b)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!= (const TransactionAllocator<T>& a,
+                 const TransactionAllocator<U>& b)
+{
+    return false;
+}
@@ -0,0 +1,100 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "TransactionTracer.h"
+#include "Application.h"
+
+TransactionTracer::TransactionTracer (TraceRing& ring) : _ring (ring)
+{
+}
+
+TransactionTracer::~TransactionTracer ()
+{
+}
+
+int32_t TransactionTracer::Find (uint32_t transactionId)
+{
+    for (uint32_t i = 0; i < _open.size (); i++)
+    {
+        if (_open[i].TransactionId == transactionId)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void TransactionTracer::OnSent (uint32_t transactionId, uint16_t source,
+                                uint16_t destination, uint16_t commandId)
+{
+    auto index = Find (transactionId);
+
+    if (index >= 0)
+    {
+        _open[index].Attempts++;
+
+        return;
+    }
+
+    TransactionSpan span;
+    span.TransactionId = transactionId;
+    span.Source = source;
+    span.Destination = destination;
+    span.CommandId = commandId;
+    span.Attempts = 1;
+    span.TimedOut = false;
+    span.ResponseCode = IdpResponseCode::UnknownError;
+    span.SentAt = Application::GetApplicationTime ();
+    span.CompletedAt = 0;
+
+    _open.push_back (span);
+}
+
+void TransactionTracer::OnCompleted (uint32_t transactionId,
+                                     std::shared_ptr<IdpResponse> response)
+{
+    auto index = Find (transactionId);
+
+    if (index < 0)
+    {
+        return;
+    }
+
+    auto& span = _open[index];
+
+    span.CompletedAt = Application::GetApplicationTime ();
+    span.TimedOut = response == nullptr;
+
+    if (response != nullptr)
+    {
+        span.ResponseCode = response->ResponseCode ();
+    }
+
+    _ring.Push (span);
+
+    // Order does not matter, so fill the gap from the end.
+    _open[index] = _open.back ();
+    _open.pop_back ();
+}
+
+void TransactionTracer::Discard (uint32_t transactionId)
+{
+    auto index = Find (transactionId);
+
+    if (index >= 0)
+    {
+        _open[index] = _open.back ();
+        _open.pop_back ();
+    }
+}
+
+TraceRing& TransactionTracer::Ring ()
+{
+    return _ring;
+}
+
+uint32_t TransactionTracer::Open ()
+{
+    return _open.size ();
+}
@@ -0,0 +1,58 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "IdpResponse.h"
+#include "TraceRing.h"
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+/**
+ *  TransactionTracer
+ *
+ *  Tracks the requests a node has sent with a response handler and pushes a
+ *  span for each one into a TraceRing once it completes. Spans are opened by
+ *  IdpNode and completed by its IdpCommandManager, so a request that is
+ *  retransmitted is one span with several attempts.
+ */
+class TransactionTracer
+{
+  public:
+    /**
+     * Instantiates a new instance of TransactionTracer
+     */
+    TransactionTracer (TraceRing& ring);
+    ~TransactionTracer ();
+
+    /**
+     * Opens a span, or counts another attempt if it is already open.
+     */
+    void OnSent (uint32_t transactionId, uint16_t source,
+                 uint16_t destination, uint16_t commandId);
+
+    /**
+     * Closes the span, with the response or nullptr if it timed out.
+     */
+    void OnCompleted (uint32_t transactionId,
+                      std::shared_ptr<IdpResponse> response);
+
+    /**
+     * Forgets a span for a request that could not be sent.
+     */
+    void Discard (uint32_t transactionId);
+
+    TraceRing& Ring ();
+
+    /**
+     * Spans opened but not yet completed.
+     */
+    uint32_t Open ();
+
+  private:
+    int32_t Find (uint32_t transactionId);
+
+    TraceRing& _ring;
+    std::vector<TransactionSpan> _open;
+};
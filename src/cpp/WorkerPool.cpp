@@ -0,0 +1,150 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#include "WorkerPool.h"
+#include <chrono>
+
+WorkerPool::WorkerPool (uint32_t threadCount, uint32_t queueLimit)
+{
+    _stopping = false;
+    _queueLimit = queueLimit;
+    _outstanding = 0;
+    _metrics = WorkerPoolMetrics ();
+
+    _completionTimer = new ScheduledTimer (IdpScheduler::Resolution,
+                                           [&]() { ProcessCompletions (); });
+
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        _threads.push_back (std::thread ([&]() { Run (); }));
+    }
+}
+
+WorkerPool::~WorkerPool ()
+{
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+
+        _stopping = true;
+    }
+
+    _available.notify_all ();
+
+    for (auto& thread : _threads)
+    {
+        thread.join ();
+    }
+
+    delete _completionTimer;
+}
+
+bool WorkerPool::Post (std::function<void()> work,
+                       std::function<void()> completion)
+{
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+
+        if (_queue.size () >= _queueLimit)
+        {
+            _metrics.Rejected++;
+
+            return false;
+        }
+
+        _queue.push_back (Job{ std::move (work), std::move (completion) });
+
+        _metrics.QueueDepth = _queue.size ();
+
+        if (_metrics.QueueDepth > _metrics.PeakQueueDepth)
+        {
+            _metrics.PeakQueueDepth = _metrics.QueueDepth;
+        }
+    }
+
+    _available.notify_one ();
+
+    if (_outstanding++ == 0)
+    {
+        _completionTimer->Start ();
+    }
+
+    return true;
+}
+
+void WorkerPool::ProcessCompletions ()
+{
+    std::deque<Job> completed;
+
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+
+        std::swap (completed, _completed);
+    }
+
+    // Jobs are released here too, so whatever their work captured is freed
+    // on the dispatcher.
+    for (auto& job : completed)
+    {
+        _outstanding--;
+
+        job.Completion ();
+    }
+
+    if (_outstanding == 0)
+    {
+        _completionTimer->Stop ();
+    }
+}
+
+WorkerPoolMetrics WorkerPool::Metrics ()
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+
+    return _metrics;
+}
+
+void WorkerPool::Run ()
+{
+    std::unique_lock<std::mutex> lock (_mutex);
+
+    while (true)
+    {
+        _available.wait (lock,
+                         [&]() { return _stopping || !_queue.empty (); });
+
+        if (_queue.empty ())
+        {
+            return;
+        }
+
+        auto job = std::move (_queue.front ());
+        _queue.pop_front ();
+
+        _metrics.QueueDepth = _queue.size ();
+        _metrics.Running++;
+
+        lock.unlock ();
+
+        auto begin = std::chrono::steady_clock::now ();
+
+        job.Work ();
+
+        uint64_t elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds> (
+                std::chrono::steady_clock::now () - begin)
+                .count ();
+
+        lock.lock ();
+
+        _metrics.Running--;
+        _metrics.Completed++;
+        _metrics.TotalExecutionUs += elapsed;
+
+        if (elapsed > _metrics.MaxExecutionUs)
+        {
+            _metrics.MaxExecutionUs = elapsed;
+        }
+
+        _completed.push_back (std::move (job));
+    }
+}
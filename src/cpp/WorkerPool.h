@@ -0,0 +1,84 @@
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+#pragma once
+
+#include "ScheduledTimer.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+typedef struct
+{
+    uint32_t QueueDepth;
+    uint32_t PeakQueueDepth;
+    uint32_t Running;
+    uint64_t Completed;
+    uint64_t Rejected;
+    uint64_t TotalExecutionUs;
+    uint32_t MaxExecutionUs;
+} WorkerPoolMetrics;
+
+/**
+ *  WorkerPool
+ *
+ *  Bounded pool of threads for work that would otherwise block the
+ *  dispatcher. Work runs on a worker thread and its completion is posted
+ *  back to run on the dispatcher, where it is safe to touch nodes and
+ *  transmit.
+ */
+class WorkerPool
+{
+  public:
+    /**
+     * Instantiates a new instance of WorkerPool
+     */
+    WorkerPool (uint32_t threadCount, uint32_t queueLimit);
+
+    /**
+     * Waits for queued and running work to finish. Completions that have
+     * not run yet are dropped.
+     */
+    ~WorkerPool ();
+
+    /**
+     * Queues work for a worker thread, then runs completion on the
+     * dispatcher. Returns false, running neither, if the queue is full.
+     * Must be called from the dispatcher.
+     */
+    bool Post (std::function<void()> work, std::function<void()> completion);
+
+    /**
+     * Runs the completions of finished work. Called periodically while work
+     * is outstanding.
+     */
+    void ProcessCompletions ();
+
+    WorkerPoolMetrics Metrics ();
+
+  private:
+    struct Job
+    {
+        std::function<void()> Work;
+        std::function<void()> Completion;
+    };
+
+    void Run ();
+
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _available;
+    std::deque<Job> _queue;
+    std::deque<Job> _completed;
+    bool _stopping;
+
+    uint32_t _queueLimit;
+    uint32_t _outstanding;
+    WorkerPoolMetrics _metrics;
+
+    ScheduledTimer* _completionTimer;
+};
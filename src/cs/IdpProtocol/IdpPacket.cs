@@ -55,14 +55,39 @@ namespace IdpProtocol
 
                 if (Flags.HasFlag(IdpFlags.CRC))
                 {
-                    //todo implement crc generation.
-                    Write((UInt32)0xAA55AA55);
+                    Write(Crc32(Data, _writeIndex));
                 }
             }
 
             _isSealed = true;
         }
 
+        /// <summary>
+        /// CRC-32 (IEEE 802.3) of the packet up to and including the ETX, as
+        /// checked by the C++ parser.
+        /// </summary>
+        public static UInt32 Crc32(byte[] data, UInt32 length)
+        {
+            UInt32 crc = 0xFFFFFFFF;
+
+            for (UInt32 i = 0; i < length; i++)
+            {
+                crc ^= data[i];
+                crc = (crc >> 4) ^ Crc32NibbleTable[crc & 0x0F];
+                crc = (crc >> 4) ^ Crc32NibbleTable[crc & 0x0F];
+            }
+
+            return ~crc;
+        }
+
+        private static readonly UInt32[] Crc32NibbleTable =
+        {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+            0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+            0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+        };
+
         public void ResetRead()
         {
             _readIndex = 0;
@@ -0,0 +1,558 @@
+#!/usr/bin/env python3
+# Copyright (c) VitalElement. All rights reserved.
+# Licensed under the MIT license. See licence.md file in the project root for
+# full license information.
+"""Generates C++ IDP command stubs from an interface description.
+
+    idpgen.py Sensor.idl [-o SensorInterface.h]
+
+An interface description lists the commands of one interface:
+
+    // Comments run to the end of the line.
+    interface Sensor
+    {
+        command SetRate = 0xB100 (uint32 rateHz, uint8 channel);
+        command GetReading = 0xB101 (uint8 channel)
+            returns (int32 value, uint16 status, uint64 timestamp);
+        command Describe = 0xB102 () returns (string name, uint32 serial);
+        oneway command Blink = 0xB103 (uint16 durationMs);
+    }
+
+Field types are bool, int8 to int64, uint8 to uint64, float, double and
+string. Strings are null terminated UTF8 and are read as views into the
+packet, so they are only valid while the transaction is.
+
+For each interface the generated header contains:
+
+  * <Interface>Command, an enum of the command ids.
+  * <Interface><Command>Request and ...Response structs. Consecutive fixed
+    size fields are packed into a single buffer with IdpWire and written
+    with one Write, or read from one ConsumeData, so a fixed layout message
+    is a single run of loads and stores.
+  * <Interface>Server, with a pure virtual method per command and
+    RegisterCommands, which registers the dispatch glue with an
+    IdpCommandManager.
+  * <Interface>Client, which serializes requests, sends them through an
+    IdpNode and deserializes the responses.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+FIXED_TYPES = {
+    "bool": ("bool", 1),
+    "int8": ("int8_t", 1),
+    "uint8": ("uint8_t", 1),
+    "int16": ("int16_t", 2),
+    "uint16": ("uint16_t", 2),
+    "int32": ("int32_t", 4),
+    "uint32": ("uint32_t", 4),
+    "int64": ("int64_t", 8),
+    "uint64": ("uint64_t", 8),
+    "float": ("float", 4),
+    "double": ("double", 8),
+}
+
+VARIABLE_TYPES = {
+    "string": "StringView",
+}
+
+HEADER = """\
+// Copyright (c) VitalElement. All rights reserved.
+// Licensed under the MIT license. See licence.md file in the project root for
+// full license information.
+//
+// Generated by tools/idpgen.py from {source}. Do not edit.
+#pragma once
+
+#include "IdpNode.h"
+#include "IdpWire.h"
+#include <functional>
+#include <memory>
+#include <stdint.h>
+"""
+
+
+class IdlError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, idl_type, name):
+        if idl_type not in FIXED_TYPES and idl_type not in VARIABLE_TYPES:
+            raise IdlError("unknown type '{}'".format(idl_type))
+
+        self.idl_type = idl_type
+        self.name = name[0].upper() + name[1:]
+
+    @property
+    def is_fixed(self):
+        return self.idl_type in FIXED_TYPES
+
+    @property
+    def cpp_type(self):
+        if self.is_fixed:
+            return FIXED_TYPES[self.idl_type][0]
+
+        return VARIABLE_TYPES[self.idl_type]
+
+    @property
+    def size(self):
+        return FIXED_TYPES[self.idl_type][1]
+
+
+class Command:
+    def __init__(self, name, command_id, oneway, parameters, results):
+        self.name = name
+        self.command_id = command_id
+        self.oneway = oneway
+        self.parameters = parameters
+        self.results = results
+
+
+class Interface:
+    def __init__(self, name):
+        self.name = name
+        self.commands = []
+
+
+def parse_fields(text):
+    fields = []
+    text = text.strip()
+
+    if not text:
+        return fields
+
+    for declaration in text.split(","):
+        parts = declaration.split()
+
+        if len(parts) != 2:
+            raise IdlError("bad field '{}'".format(declaration.strip()))
+
+        fields.append(Field(parts[0], parts[1]))
+
+    names = [field.name for field in fields]
+
+    if len(names) != len(set(names)):
+        raise IdlError("duplicate field in '{}'".format(text))
+
+    return fields
+
+
+COMMAND_PATTERN = re.compile(
+    r"(oneway\s+)?command\s+(\w+)\s*=\s*(0x[0-9A-Fa-f]+|\d+)\s*"
+    r"\(([^)]*)\)\s*(?:returns\s*\(([^)]*)\))?\s*;")
+
+INTERFACE_PATTERN = re.compile(r"interface\s+(\w+)\s*\{([^}]*)\}")
+
+
+def parse(text):
+    text = re.sub(r"//[^\n]*", "", text)
+
+    interfaces = []
+
+    for match in INTERFACE_PATTERN.finditer(text):
+        interface = Interface(match.group(1))
+        body = match.group(2)
+        position = 0
+
+        for command in COMMAND_PATTERN.finditer(body):
+            if body[position:command.start()].strip():
+                raise IdlError("cannot parse '{}'".format(
+                    body[position:command.start()].strip()))
+
+            position = command.end()
+
+            oneway = command.group(1) is not None
+            results = parse_fields(command.group(5) or "")
+
+            if oneway and results:
+                raise IdlError("oneway command {} cannot return values".format(
+                    command.group(2)))
+
+            interface.commands.append(
+                Command(command.group(2), int(command.group(3), 0), oneway,
+                        parse_fields(command.group(4)), results))
+
+        if body[position:].strip():
+            raise IdlError("cannot parse '{}'".format(body[position:].strip()))
+
+        ids = [command.command_id for command in interface.commands]
+
+        if len(ids) != len(set(ids)):
+            raise IdlError("duplicate command id in {}".format(interface.name))
+
+        interfaces.append(interface)
+
+    if not interfaces:
+        raise IdlError("no interface found")
+
+    return interfaces
+
+
+def runs(fields):
+    """Splits fields into runs of consecutive fixed size fields and single
+    variable size fields."""
+    run = []
+
+    for field in fields:
+        if field.is_fixed:
+            run.append(field)
+        else:
+            if run:
+                yield run
+                run = []
+
+            yield [field]
+
+    if run:
+        yield run
+
+
+def emit_struct(out, name, fields):
+    out.append("struct {}".format(name))
+    out.append("{")
+
+    for field in fields:
+        out.append("    {} {} = {{}};".format(field.cpp_type, field.name))
+
+    if fields:
+        out.append("")
+
+    minimum = sum(field.size if field.is_fixed else 1 for field in fields)
+
+    if fields and all(field.is_fixed for field in fields):
+        out.append("    static constexpr uint32_t FixedSize = {};".format(
+            minimum))
+
+    # Reserved up front when the message is created.
+    out.append("    static constexpr uint32_t MinimumSize = {};".format(minimum))
+    out.append("")
+
+    out.append("    void WriteTo (OutgoingTransaction& transaction) const")
+    out.append("    {")
+
+    body = []
+
+    for run in runs(fields):
+        if run[0].is_fixed:
+            size = sum(field.size for field in run)
+            offset = 0
+
+            if body:
+                body.append("")
+
+            body.append("{")
+            body.append("    uint8_t buffer[{}];".format(size))
+            body.append("")
+
+            for field in run:
+                body.append("    IdpWire::Store (buffer + {}, {});".format(
+                    offset, field.name))
+                offset += field.size
+
+            body.append("")
+            body.append("    transaction.Write (buffer, sizeof (buffer));")
+            body.append("}")
+        else:
+            body.append(
+                "transaction.Write ((void*) {0}.Data (), {0}.Length () + 1);"
+                .format(run[0].name))
+
+    # A single run does not need its own scope.
+    if len(body) > 1 and body[0] == "{" and body[-1] == "}" and \
+            body.count("{") == 1:
+        body = [line[4:] for line in body[1:-1]]
+
+    for line in body:
+        out.append(("        " + line).rstrip())
+
+    out.append("    }")
+    out.append("")
+    out.append("    bool ReadFrom (IncomingTransaction& transaction)")
+    out.append("    {")
+
+    for run in runs(fields):
+        if run[0].is_fixed:
+            size = sum(field.size for field in run)
+            offset = 0
+
+            out.append("        if (transaction.BytesRemaining () < {})".format(
+                size))
+            out.append("        {")
+            out.append("            return false;")
+            out.append("        }")
+            out.append("")
+            out.append("        {")
+            out.append("            auto buffer = static_cast<const uint8_t*> (")
+            out.append("                transaction.ConsumeData ({}));".format(
+                size))
+            out.append("")
+
+            for field in run:
+                out.append(
+                    "            {} = IdpWire::Load<{}> (buffer + {});".format(
+                        field.name, field.cpp_type, offset))
+                offset += field.size
+
+            out.append("        }")
+            out.append("")
+        else:
+            field = run[0]
+            out.append(
+                "        if (!transaction.TryReadStringView ({}))".format(
+                    field.name))
+            out.append("        {")
+            out.append("            return false;")
+            out.append("        }")
+            out.append("")
+
+    out.append("        return true;")
+    out.append("    }")
+    out.append("};")
+    out.append("")
+
+
+
+
+def emit_interface(out, interface):
+    name = interface.name
+
+    out.append("enum class {}Command : uint16_t".format(name))
+    out.append("{")
+
+    for index, command in enumerate(interface.commands):
+        separator = "," if index < len(interface.commands) - 1 else ""
+        out.append("    {} = 0x{:04X}{}".format(command.name, command.command_id,
+                                               separator))
+
+    out.append("};")
+    out.append("")
+
+    for command in interface.commands:
+        emit_struct(out, "{}{}Request".format(name, command.name),
+                    command.parameters)
+
+        if not command.oneway:
+            emit_struct(out, "{}{}Response".format(name, command.name),
+                        command.results)
+
+    # Server
+    out.append("/**")
+    out.append(" *  {}Server".format(name))
+    out.append(" *")
+    out.append(" *  Implement the handlers and call RegisterCommands with the node's")
+    out.append(" *  command manager. Requests that do not deserialize are answered with")
+    out.append(" *  InvalidParameters without calling the handler.")
+    out.append(" */")
+    out.append("class {}Server".format(name))
+    out.append("{")
+    out.append("  public:")
+    out.append("    virtual ~{}Server ()".format(name))
+    out.append("    {")
+    out.append("    }")
+    out.append("")
+
+    for command in interface.commands:
+        request = "{}{}Request".format(name, command.name)
+
+        if command.oneway:
+            out.append("    virtual void {} (const {}& request) = 0;".format(
+                command.name, request))
+        else:
+            prefix = "    virtual IdpResponseCode {} (".format(command.name)
+            out.append("{}const {}& request,".format(prefix, request))
+            out.append("{}{}{}Response& response) = 0;".format(
+                " " * len(prefix), name, command.name))
+
+        out.append("")
+
+    out.append("    void RegisterCommands (IdpCommandManager& manager)")
+    out.append("    {")
+
+    for index, command in enumerate(interface.commands):
+        request = "{}{}Request".format(name, command.name)
+
+        if index > 0:
+            out.append("")
+
+        out.append("        manager.RegisterCommand (")
+        out.append("            static_cast<uint16_t> ({}Command::{}),".format(
+            name, command.name))
+        out.append("            [this](std::shared_ptr<IncomingTransaction> incoming,")
+        out.append("                   std::shared_ptr<OutgoingTransaction> outgoing) {")
+        out.append("                {} request = {{}};".format(request))
+        out.append("")
+        out.append("                if (!request.ReadFrom (*incoming))")
+        out.append("                {")
+        out.append("                    return IdpResponseCode::InvalidParameters;")
+        out.append("                }")
+        out.append("")
+
+        if command.oneway:
+            out.append("                {} (request);".format(command.name))
+            out.append("")
+            out.append("                return IdpResponseCode::OK;")
+            out.append("            });")
+        else:
+            out.append("                {}{}Response response = {{}};".format(
+                name, command.name))
+            out.append("")
+            out.append("                auto responseCode = {} (request, response);".format(
+                command.name))
+            out.append("")
+            out.append("                if (responseCode == IdpResponseCode::OK)")
+            out.append("                {")
+            out.append("                    response.WriteTo (*outgoing);")
+            out.append("                }")
+            out.append("")
+            out.append("                return responseCode;")
+            out.append("            },")
+            out.append("            {}{}Response::MinimumSize);".format(
+                name, command.name))
+
+    out.append("    }")
+    out.append("};")
+    out.append("")
+
+    # Client
+    out.append("/**")
+    out.append(" *  {}Client".format(name))
+    out.append(" *")
+    out.append(" *  Sends {} requests from a node. Response handlers get UnknownError".format(
+        name))
+    out.append(" *  if the request times out, and any string views in the response are")
+    out.append(" *  only valid during the handler.")
+    out.append(" */")
+    out.append("class {}Client".format(name))
+    out.append("{")
+    out.append("  public:")
+    out.append("    {}Client (IdpNode& node, uint16_t address)".format(name))
+    out.append("        : _node (node), _address (address)")
+    out.append("    {")
+    out.append("    }")
+    out.append("")
+    out.append("    uint16_t Address ()")
+    out.append("    {")
+    out.append("        return _address;")
+    out.append("    }")
+    out.append("")
+    out.append("    void Address (uint16_t value)")
+    out.append("    {")
+    out.append("        _address = value;")
+    out.append("    }")
+    out.append("")
+
+    for command in interface.commands:
+        request = "{}{}Request".format(name, command.name)
+        command_id = "static_cast<uint16_t> ({}Command::{})".format(
+            name, command.name)
+
+        if command.oneway:
+            out.append("    bool {} (const {}& request)".format(command.name,
+                                                               request))
+            out.append("    {")
+            out.append("        auto transaction = OutgoingTransaction::Create (")
+            out.append("            {},".format(command_id))
+            out.append("            _node.CreateTransactionId (), IdpCommandFlags::None,")
+            out.append("            {}::MinimumSize);".format(request))
+            out.append("")
+            out.append("        request.WriteTo (*transaction);")
+            out.append("")
+            out.append("        return _node.SendRequest (_address, transaction);")
+            out.append("    }")
+        else:
+            response = "{}{}Response".format(name, command.name)
+
+            out.append("    typedef std::function<void(IdpResponseCode responseCode,")
+            out.append("                               const {}& response)>".format(
+                response))
+            out.append("        {}Handler;".format(command.name))
+            out.append("")
+            prefix = "    bool {} (".format(command.name)
+            out.append("{}const {}& request,".format(prefix, request))
+            out.append("{}{}Handler handler)".format(" " * len(prefix),
+                                                     command.name))
+            out.append("    {")
+            out.append("        auto transaction = OutgoingTransaction::Create (")
+            out.append("            {},".format(command_id))
+            out.append("            _node.CreateTransactionId (),")
+            out.append("            IdpCommandFlags::ResponseExpected,")
+            out.append("            {}::MinimumSize);".format(request))
+            out.append("")
+            out.append("        request.WriteTo (*transaction);")
+            out.append("")
+            out.append("        return _node.SendRequest (")
+            out.append("            _address, transaction,")
+            out.append("            [handler](std::shared_ptr<IdpResponse> response) {")
+            out.append("                {} result = {{}};".format(response))
+            out.append("")
+            out.append("                if (response == nullptr)")
+            out.append("                {")
+            out.append("                    handler (IdpResponseCode::UnknownError, result);")
+            out.append("                    return;")
+            out.append("                }")
+            out.append("")
+            out.append("                auto responseCode = response->ResponseCode ();")
+            out.append("")
+            out.append("                if (responseCode == IdpResponseCode::OK &&")
+            out.append("                    !result.ReadFrom (*response->Transaction ()))")
+            out.append("                {")
+            out.append("                    responseCode = IdpResponseCode::InvalidParameters;")
+            out.append("                }")
+            out.append("")
+            out.append("                handler (responseCode, result);")
+            out.append("            });")
+            out.append("    }")
+
+        out.append("")
+
+    out.append("  private:")
+    out.append("    IdpNode& _node;")
+    out.append("    uint16_t _address;")
+    out.append("};")
+    out.append("")
+
+
+def generate(text, source):
+    out = [HEADER.format(source=source)]
+
+    for interface in parse(text):
+        emit_interface(out, interface)
+
+    return "\n".join(out).rstrip() + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generates C++ IDP command stubs from an interface "
+                    "description.")
+    parser.add_argument("idl")
+    parser.add_argument("-o", "--output",
+                        help="header to write, defaults to <idl>Interface.h")
+    arguments = parser.parse_args()
+
+    with open(arguments.idl) as source:
+        text = source.read()
+
+    output = arguments.output
+
+    if output is None:
+        output = os.path.splitext(arguments.idl)[0] + "Interface.h"
+
+    try:
+        header = generate(text, os.path.basename(arguments.idl))
+    except IdlError as error:
+        sys.stderr.write("{}: {}\n".format(arguments.idl, error))
+        return 1
+
+    with open(output, "w") as target:
+        target.write(header)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())